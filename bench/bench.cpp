@@ -0,0 +1,570 @@
+// Microbenchmarks for the rendering hot paths: pixel and line primitives, dot stamps,
+// circle outlines, flood fill, terminal frames, whole turtle shapes, clears, image and SVG
+// export, image loading and comparison, downscaling and supersampling, layer compositing,
+// the sparse tiled canvas and the window framebuffer conversion.
+//
+//   projectcode_bench [--filter TEXT] [--min-time SECONDS] [--simd scalar|sse2|ssse3|avx2]
+//                     [--json [FILE]]
+//
+// Each benchmark repeats its body until one timed batch lasts at least --min-time and
+// reports that batch as operations, pixels and megabytes per second. --json writes the
+// same numbers as JSON (to stdout when no file is given) for tracking over time.
+
+#include "canvas.hpp"
+#include "canvas_rgb.hpp"
+#include "display_list.hpp"
+#include "framebuffer.hpp"
+#include "image_compare.hpp"
+#include "layer_stack.hpp"
+#include "pixel_kernels.hpp"
+#include "raster.hpp"
+#include "shapes.hpp"
+#include "sparse_canvas.hpp"
+#include "supersample.hpp"
+#include "svg_writer.hpp"
+#include "terminal.hpp"
+#include "turtle_rgb.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace projectcode;
+
+namespace {
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations = 0;
+    double seconds = 0.0;
+    double pixels = 0.0; // per iteration
+    double bytes = 0.0;  // per iteration
+
+    double ns_per_op() const { return seconds * 1e9 / static_cast<double>(iterations); }
+    double ops_per_s() const { return static_cast<double>(iterations) / seconds; }
+    double pixels_per_s() const { return pixels * ops_per_s(); }
+    double mb_per_s() const { return bytes * ops_per_s() / 1e6; }
+};
+
+const char *simd_name(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::scalar: return "scalar";
+    case SimdLevel::sse2: return "sse2";
+    case SimdLevel::ssse3: return "ssse3";
+    case SimdLevel::avx2: return "avx2";
+    }
+    return "unknown";
+}
+
+volatile std::uint8_t g_sink; // keeps results observable
+
+class Runner {
+public:
+    Runner(std::string filter, double min_time, std::FILE *log)
+        : filter_(std::move(filter)), min_time_(min_time), log_(log) {}
+
+    // Time fn(), which performs one operation touching `pixels` pixels and `bytes` bytes.
+    template <class Fn>
+    void run(const std::string &name, double pixels, double bytes, Fn fn) {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos) return;
+        fn(); // warm caches and lazily built tables
+        std::uint64_t iterations = 1;
+        for (;;) {
+            const auto start = std::chrono::steady_clock::now();
+            for (std::uint64_t i = 0; i < iterations; ++i) fn();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds >= min_time_ || iterations >= (std::uint64_t{1} << 40)) {
+                Result r{name, iterations, seconds, pixels, bytes};
+                std::fprintf(log_, "%-34s %12.1f ns/op %12.3f Mpx/s %10.1f MB/s\n", name.c_str(), r.ns_per_op(),
+                            r.pixels_per_s() / 1e6, r.mb_per_s());
+                results_.push_back(r);
+                return;
+            }
+            // Aim past the target so the next batch is (usually) the last.
+            const double scale = seconds > 0.0 ? min_time_ * 1.4 / seconds : 100.0;
+            iterations = static_cast<std::uint64_t>(static_cast<double>(iterations) * std::min(100.0, std::max(2.0, scale)));
+        }
+    }
+
+    const std::vector<Result> &results() const { return results_; }
+
+private:
+    std::string filter_;
+    double min_time_;
+    std::FILE *log_;
+    std::vector<Result> results_;
+};
+
+// Pixels a line plots on a canvas with the given bounds.
+double line_pixels(const Rect &bounds, int x0, int y0, int x1, int y1) {
+    const raster::LineWalk w = raster::clip_line(bounds, x0, y0, x1, y1);
+    return w.empty() ? 0.0 : static_cast<double>(w.last - w.first + 1);
+}
+
+// Pixels plotted by the line commands of a recorded turtle program.
+double recorded_pixels(const DisplayList &list, const Rect &bounds) {
+    double n = 0.0;
+    for (const auto &c : list.commands()) {
+        if (c.op == DisplayList::Op::line) n += line_pixels(bounds, c.a, c.b, c.c, c.d);
+        if (c.op == DisplayList::Op::fill) {
+            raster::scan_polygon(bounds, list.vertices().data() + c.a, static_cast<std::size_t>(c.b), c.rule,
+                                 [&](int, int x0, int x1) { n += x1 - x0; });
+        }
+    }
+    return n;
+}
+
+void write_json(std::ostream &os, const std::vector<Result> &results, double min_time) {
+    os << "{\n  \"context\": {\n";
+#if defined(__VERSION__)
+    os << "    \"compiler\": \"" << __VERSION__ << "\",\n";
+#elif defined(_MSC_VER)
+    os << "    \"compiler\": \"MSVC " << _MSC_VER << "\",\n";
+#endif
+    os << "    \"simd\": \"" << simd_name(kernels::active_level()) << "\",\n";
+    os << "    \"simd_detected\": \"" << simd_name(kernels::detected_level()) << "\",\n";
+    os << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    os << "    \"min_time\": " << min_time << "\n  },\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        os << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations << ", \"seconds\": " << r.seconds
+           << ", \"ns_per_op\": " << r.ns_per_op() << ", \"ops_per_s\": " << r.ops_per_s()
+           << ", \"pixels_per_s\": " << r.pixels_per_s() << ", \"mb_per_s\": " << r.mb_per_s() << "}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+void bench_pixels(Runner &runner) {
+    CanvasRGB canvas(1024, 1024);
+    const Color red{255, 0, 0};
+    // Scattered writes: consecutive pixels land on different rows and tiles.
+    runner.run("set_pixel/scattered", 65536, 65536 * 3, [&] {
+        for (unsigned i = 0; i < 65536; ++i) canvas.set_pixel(static_cast<int>((i * 37u) & 1023u), static_cast<int>((i * 101u) & 1023u), red);
+        g_sink = canvas.data()->r;
+    });
+    runner.run("set_pixel/row_order", 65536, 65536 * 3, [&] {
+        for (int y = 0; y < 64; ++y) {
+            for (int x = 0; x < 1024; ++x) canvas.set_pixel(x, y, red);
+        }
+        g_sink = canvas.data()->r;
+    });
+}
+
+void bench_lines(Runner &runner) {
+    CanvasRGB canvas(1024, 1024);
+    const Rect b = canvas.bounds();
+    const Color blue{0, 0, 255};
+    struct Case {
+        const char *name;
+        int x0, y0, x1, y1;
+    };
+    const Case cases[] = {
+        {"horizontal", 0, 512, 1023, 512},
+        {"vertical", 512, 0, 512, 1023},
+        {"diagonal", 0, 0, 1023, 1023},
+        {"shallow", 0, 100, 1023, 246},
+        {"steep", 100, 0, 246, 1023},
+        {"clip_both_ends", -2000, -300, 3000, 1400},
+        {"clip_one_end", 512, 512, 5000, -900},
+        {"clip_rejected", -500, -500, 2000, -10},
+        {"clip_far_outside", -1000000, -1000000, 1000000, 1000000},
+    };
+    for (const Case &c : cases) {
+        const double px = line_pixels(b, c.x0, c.y0, c.x1, c.y1);
+        runner.run(std::string("draw_line/") + c.name, px, px * 3, [&] {
+            canvas.draw_line(c.x0, c.y0, c.x1, c.y1, blue);
+            g_sink = canvas.data()->r;
+        });
+    }
+    const double diag = line_pixels(b, 0, 0, 1023, 1023);
+    runner.run("draw_line/diagonal_alpha", diag, diag * 3, [&] {
+        canvas.draw_line(0, 0, 1023, 1023, blue, 128);
+        g_sink = canvas.data()->r;
+    });
+    runner.run("draw_line_aa/diagonal", 2 * diag, 2 * diag * 3, [&] {
+        canvas.draw_line_aa(0.25, 0.5, 1022.75, 1000.5, blue);
+        g_sink = canvas.data()->r;
+    });
+}
+
+void bench_dots(Runner &runner) {
+    CanvasRGB canvas(1024, 1024);
+    TurtleRGB turtle(canvas, 512, 512);
+    for (int radius : {3, 10, 50}) {
+        CanvasRGB probe(1024, 1024, Color{0, 0, 0});
+        probe.fill_circle(512, 512, radius, Color{255, 255, 255});
+        double px = 0.0;
+        for (std::size_t y = 0; y < probe.height(); ++y) {
+            for (std::size_t x = 0; x < probe.width(); ++x) px += probe.row(y)[x].r != 0 ? 1.0 : 0.0;
+        }
+        runner.run("stamp_dot/r" + std::to_string(radius), px, px * 3, [&] {
+            turtle.stamp_dot(radius, Color{0, 0, 0});
+            g_sink = canvas.data()->r;
+        });
+    }
+}
+
+void bench_circles(Runner &runner) {
+    CanvasRGB canvas(1024, 1024);
+    for (int radius : {10, 100, 500}) {
+        std::size_t px = 0;
+        raster::visit_circle(canvas.bounds(), 512, 512, radius, [&](int, int) { ++px; });
+        runner.run("draw_circle/r" + std::to_string(radius), static_cast<double>(px), px * 3.0, [&] {
+            canvas.draw_circle(512, 512, radius, Color{0, 0, 0});
+            g_sink = canvas.data()->r;
+        });
+    }
+}
+
+void bench_flood(Runner &runner) {
+    CanvasRGB canvas(3840, 2160);
+    const double px = 3840.0 * 2160.0;
+    bool dark = false;
+    runner.run("flood_fill/4k", px, px * 3 * 2, [&] {
+        dark = !dark;
+        canvas.flood_fill(1920, 1080, dark ? Color{0, 0, 0} : Color{255, 255, 255});
+        g_sink = canvas.data()->r;
+    });
+}
+
+// Discards terminal output so only building the frame is timed.
+struct NullBuffer : std::streambuf {
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+    int overflow(int c) override { return c; }
+};
+
+void bench_terminal(Runner &runner) {
+    NullBuffer sink;
+    std::ostream os(&sink);
+    AnsiTerminal term(os);
+    Canvas canvas(200, 60);
+    const double cells = 200.0 * 60.0;
+    term.present(canvas);
+    // MB/s counts the escape-coded bytes sent, measured on the first frame.
+    std::size_t step = 0;
+    std::size_t sent = 0;
+    auto crawl = [&] { // one cell moves per frame, as a turtle crawling over a finished picture
+        canvas.set_pixel(static_cast<int>(step % 200), 30, ' ');
+        ++step;
+        canvas.set_pixel(static_cast<int>(step % 200), 30, '*');
+        sent = term.present(canvas);
+        g_sink = static_cast<std::uint8_t>(sent);
+    };
+    crawl();
+    runner.run("terminal_present/1cell", cells, static_cast<double>(sent), crawl);
+    bool dark = false;
+    auto repaint = [&] {
+        dark = !dark;
+        canvas.clear(dark ? '#' : '.');
+        sent = term.present(canvas);
+        g_sink = static_cast<std::uint8_t>(sent);
+    };
+    repaint();
+    runner.run("terminal_present/full", cells, static_cast<double>(sent), repaint);
+}
+
+void bench_shapes(Runner &runner) {
+    CanvasRGB canvas(1024, 1024);
+    const Rect b = canvas.bounds();
+
+    auto polygon = [](TurtleRGB &t) {
+        t.move_to(362, 800);
+        t.set_heading(0);
+        draw_polygon(t, 6, 300, Color{255, 69, 0});
+    };
+    auto spiral = [](TurtleRGB &t) {
+        t.move_to(512, 512);
+        t.set_heading(0);
+        draw_spiral(t, 120, 4.0, Color{34, 139, 34});
+    };
+
+    auto shape = [&](const std::string &name, auto program, bool fixed_point, bool antialias, double width = 1.0) {
+        DisplayList list;
+        TurtleRGB recorder(canvas, 0, 0);
+        recorder.record_to(&list, false);
+        recorder.set_fixed_point(fixed_point);
+        recorder.set_pen_width(width);
+        program(recorder);
+        recorder.finish_path();
+        const double px = antialias ? 2 * recorded_pixels(list, b) : recorded_pixels(list, b);
+
+        TurtleRGB t(canvas, 0, 0);
+        t.set_fixed_point(fixed_point);
+        t.set_antialias(antialias);
+        t.set_pen_width(width);
+        runner.run(name, px, px * 3, [&] {
+            program(t);
+            g_sink = canvas.data()->r;
+        });
+    };
+    shape("draw_polygon/hexagon", polygon, false, false);
+    shape("draw_spiral/120_steps", spiral, false, false);
+    shape("draw_spiral/fixed_point", spiral, true, false);
+    shape("draw_spiral/antialias", spiral, false, true);
+    for (double width : {4.0, 16.0, 64.0}) {
+        shape("draw_spiral/width" + std::to_string(static_cast<int>(width)), spiral, false, false, width);
+    }
+}
+
+template <class Pixel>
+void bench_clear(Runner &runner, const char *name) {
+    BasicCanvas<Pixel> canvas(1920, 1080);
+    const double px = 1920.0 * 1080.0;
+    const double bytes = static_cast<double>(canvas.stride() * canvas.height() * sizeof(Pixel));
+    runner.run(std::string("clear/") + name, px, bytes, [&] {
+        canvas.clear();
+        g_sink = static_cast<std::uint8_t>(sizeof(*canvas.data()));
+    });
+}
+
+void bench_export(Runner &runner) {
+    CanvasRGB canvas(1920, 1080, Color{240, 248, 255});
+    DisplayList list;
+    {
+        TurtleRGB t(canvas, 960, 540);
+        t.record_to(&list);
+        draw_spiral(t, 200, 4.0, Color{34, 139, 34});
+    }
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string ppm = (dir / "projectcode_bench.ppm").string();
+    const std::string bmp = (dir / "projectcode_bench.bmp").string();
+    const std::string svg = (dir / "projectcode_bench.svg").string();
+    const double px = 1920.0 * 1080.0;
+
+    canvas.save_ppm(ppm);
+    canvas.save_bmp(bmp);
+    const double ppm_bytes = static_cast<double>(std::filesystem::file_size(ppm));
+    const double bmp_bytes = static_cast<double>(std::filesystem::file_size(bmp));
+    save_svg(svg, list, 1920, 1080, Color{240, 248, 255});
+    const double svg_bytes = static_cast<double>(std::filesystem::file_size(svg));
+
+    runner.run("save_ppm/buffered", px, ppm_bytes, [&] { g_sink = canvas.save_ppm(ppm); });
+    runner.run("save_ppm/mapped", px, ppm_bytes, [&] { g_sink = canvas.save_ppm(ppm, WriteMode::mapped); });
+    runner.run("save_bmp/buffered", px, bmp_bytes, [&] { g_sink = canvas.save_bmp(bmp); });
+    runner.run("save_bmp/mapped", px, bmp_bytes, [&] { g_sink = canvas.save_bmp(bmp, WriteMode::mapped); });
+    runner.run("save_svg/spiral", px, svg_bytes,
+               [&] { g_sink = save_svg(svg, list, 1920, 1080, Color{240, 248, 255}); });
+
+    CanvasRGB loaded(1, 1);
+    runner.run("load_ppm/buffered", px, ppm_bytes, [&] { g_sink = loaded.load_ppm(ppm, ReadMode::buffered); });
+    runner.run("load_ppm/mapped", px, ppm_bytes, [&] { g_sink = loaded.load_ppm(ppm); });
+    runner.run("load_bmp/mapped", px, bmp_bytes, [&] { g_sink = loaded.load_bmp(bmp); });
+
+    // Golden-image checks: a passing run against the mapped file, and one where every row
+    // has a few slightly different pixels, compared in full rather than stopping at the
+    // first.
+    runner.run("compare/identical_ppm", px, ppm_bytes * 2, [&] {
+        const ImageFile golden = ImageFile::open(ppm);
+        g_sink = compare_images(canvas.view(), golden.view()).passed();
+    });
+    CanvasRGB noisy = canvas;
+    for (std::size_t y = 0; y < 1080; ++y) {
+        for (std::size_t x = y % 7; x < 1920; x += 97) noisy.row(y)[x].g ^= 1;
+    }
+    CompareOptions full;
+    full.max_differing = std::numeric_limits<std::size_t>::max();
+    CompareOptions tolerant;
+    tolerant.tolerance = 1;
+    runner.run("compare/noisy", px, px * 6,
+               [&] { g_sink = compare_images(canvas.view(), noisy.view(), full).passed(); });
+    runner.run("compare/noisy_tolerance1", px, px * 6,
+               [&] { g_sink = compare_images(canvas.view(), noisy.view(), tolerant).passed(); });
+
+    std::error_code ec;
+    std::filesystem::remove(ppm, ec);
+    std::filesystem::remove(bmp, ec);
+    std::filesystem::remove(svg, ec);
+}
+
+// A 4K canvas reduced to a thumbnail, and the export spiral rendered at 4x and filtered
+// back down to 1920x1080.
+void bench_resample(Runner &runner) {
+    CanvasRGB big(3840, 2160, Color{240, 248, 255});
+    DisplayList list;
+    {
+        TurtleRGB t(big, 1920, 1080);
+        t.record_to(&list);
+        draw_spiral(t, 200, 8.0, Color{34, 139, 34});
+    }
+    const double big_px = 3840.0 * 2160.0;
+    runner.run("downscale/4k_by4", big_px, big_px * 3, [&] { g_sink = big.downscale(4).row(0)[0].g; });
+    runner.run("downscale/4k_by16", big_px, big_px * 3, [&] { g_sink = big.downscale(16).row(0)[0].g; });
+
+    DisplayList small;
+    {
+        CanvasRGB canvas(1920, 1080);
+        TurtleRGB t(canvas, 960, 540);
+        t.record_to(&small);
+        draw_spiral(t, 200, 4.0, Color{34, 139, 34});
+    }
+    runner.run("render_supersampled/x4", 1920.0 * 1080.0, 1920.0 * 1080.0 * 3, [&] {
+        g_sink = render_supersampled(small, 1920, 1080, 4, Color{240, 248, 255}).row(540)[960].g;
+    });
+}
+
+// A 1920x1080 scene under a cursor layer: a full recomposite, and a frame where only the
+// cursor moved.
+void bench_layers(Runner &runner) {
+    LayerStack stack(1920, 1080, Color{240, 248, 255});
+    const std::size_t scene = stack.add_layer();
+    const std::size_t cursor = stack.add_layer();
+    {
+        TurtleRGBA32 t(stack.layer(scene), 960, 540);
+        draw_spiral(t, 200, 4.0, RGBA32{34, 139, 34, 255});
+    }
+    stack.composite();
+    const double px = 1920.0 * 1080.0;
+    runner.run("layers/full_composite", px, px * 4 * 2, [&] {
+        stack.invalidate();
+        g_sink = static_cast<std::uint8_t>(stack.composite().size());
+    });
+    int x = 0;
+    std::size_t composited = 0;
+    auto move = [&] {
+        stack.clear_layer(cursor);
+        x = (x + 7) % 1920;
+        stack.layer(cursor).fill_circle(x, 540, 5, RGBA32{0, 0, 0, 255});
+        composited = 0;
+        for (const Rect &r : stack.composite()) composited += static_cast<std::size_t>(r.w) * r.h;
+        g_sink = static_cast<std::uint8_t>(composited);
+    };
+    move();
+    // Pixels and MB/s are the full frame's, for comparison with a full recomposite.
+    runner.run("layers/cursor_move", px, px * 4 * 2, move);
+}
+
+// The dense benchmarks' spiral and PPM export on a sparse canvas of the same size, plus
+// the spiral on a 200000x200000 one.
+void bench_sparse(Runner &runner) {
+    auto spiral = [](SparseTurtleRGB &t, double x, double y) {
+        t.move_to(x, y);
+        t.set_heading(0);
+        draw_spiral(t, 120, 4.0, Color{34, 139, 34});
+    };
+    auto run_spiral = [&](const std::string &name, std::size_t size) {
+        SparseCanvasRGB canvas(size, size);
+        const double c = static_cast<double>(size / 2);
+        DisplayList list;
+        SparseTurtleRGB recorder(canvas, 0, 0);
+        recorder.record_to(&list, false);
+        spiral(recorder, c, c);
+        const double px = recorded_pixels(list, canvas.bounds());
+
+        SparseTurtleRGB t(canvas, 0, 0);
+        runner.run(name, px, px * 3, [&] {
+            spiral(t, c, c);
+            g_sink = static_cast<std::uint8_t>(canvas.tile_count());
+        });
+    };
+    run_spiral("sparse/draw_spiral", 1024);
+    run_spiral("sparse/draw_spiral_200k", 200000);
+
+    SparseCanvasRGB canvas(1920, 1080, Color{240, 248, 255});
+    {
+        SparseTurtleRGB t(canvas, 960, 540);
+        draw_spiral(t, 200, 4.0, Color{34, 139, 34});
+    }
+    const std::string ppm = (std::filesystem::temp_directory_path() / "projectcode_bench_sparse.ppm").string();
+    canvas.save_ppm(ppm);
+    const double px = 1920.0 * 1080.0;
+    const double bytes = static_cast<double>(std::filesystem::file_size(ppm));
+    runner.run("sparse/save_ppm", px, bytes, [&] { g_sink = canvas.save_ppm(ppm); });
+    std::error_code ec;
+    std::filesystem::remove(ppm, ec);
+}
+
+template <class Pixel>
+void bench_framebuffer(Runner &runner, const char *name) {
+    BasicCanvas<Pixel> canvas(1920, 1080);
+    const double px = 1920.0 * 1080.0;
+    const double bytes = static_cast<double>(detail::make_framebuffer(canvas).bytes.size());
+    runner.run(std::string("make_framebuffer/") + name, px, bytes, [&] {
+        const detail::Framebuffer fb = detail::make_framebuffer(canvas);
+        g_sink = fb.bytes[0];
+    });
+}
+
+int usage() {
+    std::cerr << "usage: projectcode_bench [--filter TEXT] [--min-time SECONDS] "
+                 "[--simd scalar|sse2|ssse3|avx2] [--json [FILE]]\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string filter;
+    double min_time = 0.2;
+    bool json = false;
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            min_time = std::atof(argv[++i]);
+            if (min_time <= 0.0) return usage();
+        } else if (arg == "--simd" && i + 1 < argc) {
+            const std::string level = argv[++i];
+            if (level == "scalar") kernels::set_level(SimdLevel::scalar);
+            else if (level == "sse2") kernels::set_level(SimdLevel::sse2);
+            else if (level == "ssse3") kernels::set_level(SimdLevel::ssse3);
+            else if (level == "avx2") kernels::set_level(SimdLevel::avx2);
+            else return usage();
+        } else if (arg == "--json") {
+            json = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') json_path = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+
+    // With JSON on stdout, the human-readable table goes to stderr.
+    std::FILE *log = json && json_path.empty() ? stderr : stdout;
+    std::fprintf(log, "simd: %s (detected %s)\n", simd_name(kernels::active_level()),
+                 simd_name(kernels::detected_level()));
+
+    Runner runner(filter, min_time, log);
+    bench_pixels(runner);
+    bench_lines(runner);
+    bench_dots(runner);
+    bench_circles(runner);
+    bench_flood(runner);
+    bench_terminal(runner);
+    bench_shapes(runner);
+    bench_clear<char>(runner, "char");
+    bench_clear<Color>(runner, "rgb24");
+    bench_clear<RGBA32>(runner, "rgba32");
+    bench_export(runner);
+    bench_resample(runner);
+    bench_layers(runner);
+    bench_sparse(runner);
+    bench_framebuffer<Color>(runner, "rgb24");
+    bench_framebuffer<RGBA32>(runner, "rgba32");
+    bench_framebuffer<BGRA32>(runner, "bgra32");
+
+    if (json) {
+        if (json_path.empty()) {
+            write_json(std::cout, runner.results(), min_time);
+        } else {
+            std::ofstream out(json_path);
+            write_json(out, runner.results(), min_time);
+            if (!out) {
+                std::cerr << "could not write " << json_path << "\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "../src/turtle_rgb.hpp"
 #include "../src/shapes.hpp"
+#include "../src/supersample.hpp"
+#include "../src/svg_writer.hpp"
 #include <iostream>
 
 using namespace projectcode;
@@ -7,6 +9,8 @@ using namespace projectcode;
 int main() {
     CanvasRGB canvas(800, 600, rgb(240, 248, 255)); // light background
     TurtleRGB t(canvas, 150, 300);
+    DisplayList strokes; // also kept as vectors for color_output.svg
+    t.record_to(&strokes);
     t.set_delay_ms(10); // slow down to visualize drawing
 
     draw_polygon(t, 4, 120, rgb(255, 69, 0));      // square in orange-red
@@ -33,12 +37,17 @@ int main() {
 
     bool ok_ppm = canvas.save_ppm("color_output.ppm");
     bool ok_bmp = canvas.save_bmp("color_output.bmp");
+    bool ok_svg = save_svg("color_output.svg", strokes, canvas.width(), canvas.height(), rgb(240, 248, 255));
+    // The same strokes drawn at 4x and filtered back down, with smooth edges throughout.
+    bool ok_smooth = render_supersampled(strokes, canvas.width(), canvas.height(), 4, rgb(240, 248, 255))
+                         .save_png("color_output_smooth.png");
 
-    if (!ok_ppm || !ok_bmp) {
+    if (!ok_ppm || !ok_bmp || !ok_svg || !ok_smooth) {
         std::cerr << "Failed to write output images\n";
         return 1;
     }
 
-    std::cout << "Wrote color_output.ppm (PPM P6) and color_output.bmp (24-bit BMP)." << std::endl;
+    std::cout << "Wrote color_output.ppm (PPM P6), color_output.bmp (24-bit BMP), color_output.svg\n"
+              << "and color_output_smooth.png (4x supersampled)." << std::endl;
     return 0;
 }
@@ -16,6 +16,8 @@ int APIENTRY wWinMain(HINSTANCE, HINSTANCE, LPWSTR, int) {
         // Use a variable for side length to teach variable usage
         int side = 200;
         t.move_to(100, 300); // starting position
+        t.set_fill(rgb(255, 215, 0));
+        t.begin_fill();
         // Draw the square outline with a for loop
         for (int i = 0; i < 4; ++i) {
             t.set_delay_ms(500);
@@ -23,6 +25,8 @@ int APIENTRY wWinMain(HINSTANCE, HINSTANCE, LPWSTR, int) {
             t.turn_left(90);
             if (!flush()) return;
         }
+        t.end_fill(); // fill the square we just walked around
+        if (!flush()) return;
 
         // Mark turtle head
         t.stamp_dot(4, rgb(0, 0, 0));
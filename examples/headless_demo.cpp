@@ -0,0 +1,54 @@
+#include "../src/frame_capture.hpp"
+#include "../src/shapes.hpp"
+#include <iostream>
+
+using namespace projectcode;
+
+// The window_demo scene rendered without a window: the 50 ms turtle delays advance a
+// virtual clock, and every 30 fps frame tick is captured to a video and a delta file.
+int main() {
+    HeadlessOptions opts;
+    opts.fps = 30;
+
+    auto draw = [&](CanvasRGB &, TurtleRGB &t, std::function<bool()> flush) {
+        t.set_delay_ms(50);
+
+        t.move_to(150, 300);
+        flush();
+        draw_polygon(t, 4, 120, rgb(255, 69, 0), flush);
+        t.pen_up();
+        t.move_to(420, 200);
+        t.pen_down();
+        flush();
+        draw_polygon(t, 3, 140, rgb(0, 128, 255), flush);
+        t.pen_up();
+        t.move_to(500, 400);
+        t.pen_down();
+        flush();
+        draw_spiral(t, 60, 3.0, rgb(34, 139, 34), 18.0, flush);
+        t.pen_up();
+        t.move_to(100, 100);
+        t.pen_down();
+        flush();
+        t.set_pen(rgb(128, 0, 128));
+        t.turn_left(90);
+        t.forward(180);
+        flush();
+        t.stamp_dot(5, rgb(0, 0, 0));
+        flush();
+    };
+
+    Y4MWriter video("headless_demo.y4m", opts.fps);
+    const std::uint64_t frames = run_headless(opts, video, draw);
+
+    DeltaRawWriter delta("headless_demo.pcdelta", opts.fps);
+    run_headless(opts, delta, draw);
+
+    if (!video.is_open() || !delta.is_open()) {
+        std::cerr << "Failed to write capture files\n";
+        return 1;
+    }
+    std::cout << "Captured " << frames << " frames (" << frames / opts.fps << " s at " << opts.fps
+              << " fps) to headless_demo.y4m and headless_demo.pcdelta\n";
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "../src/render_pipeline.hpp"
+#include "../src/shapes.hpp"
+#include <chrono>
+#include <iostream>
+
+using namespace projectcode;
+
+// Load test for the pipelined renderer without a window: thousands of spirals are drawn
+// on a worker thread while this thread rasterizes and presents at 60 fps.
+int main() {
+    CanvasRGB canvas(800, 600, rgb(240, 248, 255));
+    HeadlessPresenter presenter(canvas);
+    RenderPipeline pipeline(canvas, presenter);
+
+    const auto start = std::chrono::steady_clock::now();
+    const PipelineStats stats = pipeline.run([](CanvasRGB &, TurtleRGB &t, std::function<bool()> flush) {
+        for (int i = 0; i < 3000; ++i) {
+            t.pen_up();
+            t.move_to(100 + (i * 37) % 600, 100 + (i * 53) % 400);
+            t.pen_down();
+            if (!draw_spiral(t, 60, 1.5, rgb(i % 256, 128, 255 - i % 256), 18.0, flush)) return;
+        }
+    });
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << stats.commands << " commands in " << stats.frames << " frames, " << ms << " ms (up to "
+              << stats.max_commands_per_frame << " per frame, " << stats.producer_stalls << " producer stalls, "
+              << presenter.presented_pixels() << " pixels presented)\n";
+    canvas.save_png("pipeline_output.png");
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "../src/shapes.hpp"
+#include "../src/sparse_canvas.hpp"
+#include <cstring>
+#include <iostream>
+
+using namespace projectcode;
+
+// A dragon curve, a spiral and scattered dots on a 200000x200000 canvas, which would
+// take 120 GB as a CanvasRGB. Prints how many tiles were actually allocated and saves
+// sparse_demo_overview.png, one pixel per 64x64 tile, visited with for_each_tile.
+// Pass --mapped to keep the tiles in sparse_demo.tiles instead of on the heap.
+int main(int argc, char **argv) {
+    const std::size_t size = 200000;
+    SparseCanvasRGB canvas(size, size, Color{240, 248, 255});
+    if (argc > 1 && std::strcmp(argv[1], "--mapped") == 0 && !canvas.map_tiles_to("sparse_demo.tiles")) {
+        std::cerr << "Failed to create sparse_demo.tiles\n";
+        return 1;
+    }
+    SparseTurtleRGB t(canvas, 100000, 100000);
+
+    // Dragon curve: turn left or right by the bit above the lowest set bit of the step.
+    t.set_pen(rgb(200, 30, 30));
+    for (unsigned i = 1; i <= 1024; ++i) {
+        t.forward(200);
+        if ((((i & (0u - i)) << 1) & i) != 0) {
+            t.turn_right(90);
+        } else {
+            t.turn_left(90);
+        }
+    }
+
+    t.pen_up();
+    t.move_to(20000, 180000);
+    t.pen_down();
+    draw_spiral(t, 30, 600.0, rgb(34, 139, 34), 75.0);
+
+    for (int k = 0; k < 50; ++k) {
+        t.pen_up();
+        t.move_to(4000.0 * k, 199999.0 - 3900.0 * k);
+        t.stamp_dot(40, rgb(0, 0, 255));
+    }
+
+    const std::size_t tiles = canvas.tiles_x() * canvas.tiles_y();
+    std::cout << canvas.tile_count() << " of " << tiles << " tiles drawn, " << canvas.memory_bytes() / (1 << 20)
+              << " MiB instead of " << size * size * 3 / (std::size_t{1} << 30) << " GiB\n";
+
+    // Overview: each tile becomes the first colour drawn in it, or the background.
+    const Color bg = canvas.background();
+    CanvasRGB overview(canvas.tiles_x(), canvas.tiles_y(), bg);
+    canvas.for_each_tile([&](const Rect &area, const Color *pixels, std::size_t stride, bool drawn) {
+        if (!drawn) return;
+        for (int y = 0; y < area.h; ++y) {
+            for (int x = 0; x < area.w; ++x) {
+                const Color c = pixels[static_cast<std::size_t>(y) * stride + static_cast<std::size_t>(x)];
+                if (c.r != bg.r || c.g != bg.g || c.b != bg.b) {
+                    overview.set_pixel(area.x / SparseCanvasRGB::tile_size, area.y / SparseCanvasRGB::tile_size, c);
+                    return;
+                }
+            }
+        }
+    });
+    if (!overview.save_png("sparse_demo_overview.png")) {
+        std::cerr << "Failed to write sparse_demo_overview.png\n";
+        return 1;
+    }
+    return 0;
+}
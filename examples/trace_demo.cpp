@@ -0,0 +1,53 @@
+#include "../src/instrument.hpp"
+#include "../src/shapes.hpp"
+#include <iostream>
+
+using namespace projectcode;
+
+// Draws the window_demo scene plus an off-canvas excursion, saves it, then prints the
+// work counters and per-scope timings and writes trace_demo.json for chrome://tracing
+// or Perfetto. Build with -DPROJECTCODE_INSTRUMENT=ON to get non-zero numbers.
+int main() {
+    CanvasRGB canvas(800, 600, Color{240, 248, 255});
+    TurtleRGB t(canvas, 150, 300);
+
+    draw_polygon(t, 4, 120, rgb(255, 69, 0));
+    t.pen_up();
+    t.move_to(420, 200);
+    t.pen_down();
+    t.set_fill(rgb(0, 128, 255));
+    t.begin_fill();
+    draw_polygon(t, 3, 140, rgb(0, 0, 128));
+    t.end_fill();
+    instrument::sample("turtle", t.counters());
+
+    t.pen_up();
+    t.move_to(500, 400);
+    t.pen_down();
+    t.set_antialias(true);
+    draw_spiral(t, 200, 3.0, rgb(34, 139, 34));
+    t.set_antialias(false);
+    instrument::sample("turtle", t.counters());
+
+    // Discs hanging over the edges are partly clipped.
+    for (int k = 0; k < 20; ++k) {
+        t.pen_up();
+        t.move_to(k * 40.0, k % 2 ? 0.0 : 599.0);
+        t.stamp_dot(25, rgb(128, 0, 128));
+    }
+    instrument::sample("turtle", t.counters());
+
+    canvas.save_png("trace_demo.png");
+    canvas.save_bmp("trace_demo.bmp");
+
+    instrument::write_counters(std::cout, t.counters(), "turtle");
+    instrument::write_counters(std::cout, canvas.counters(), "canvas");
+    std::cout << '\n';
+    instrument::write_summary(std::cout);
+
+    if (!instrument::write_chrome_trace("trace_demo.json")) {
+        std::cerr << "Failed to write trace_demo.json\n";
+        return 1;
+    }
+    return 0;
+}
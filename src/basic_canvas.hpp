@@ -0,0 +1,487 @@
+#pragma once
+
+#include "dirty_region.hpp"
+#include "image_reader.hpp"
+#include "image_writer.hpp"
+#include "instrument.hpp"
+#include "pixel.hpp"
+#include "pixel_kernels.hpp"
+#include "png_writer.hpp"
+#include "raster.hpp"
+#include "resample.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace projectcode {
+
+namespace detail {
+// Convert n pixels to packed RGB or BGR bytes for the exporters and presenters.
+template <class Pixel>
+void pixels_to_24(const Pixel *src, std::uint8_t *dst, std::size_t n, bool bgr) {
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(src);
+    if constexpr (std::is_same_v<Pixel, Color>) {
+        if (bgr) {
+            kernels::swap_rb24(bytes, dst, n);
+        } else {
+            std::memcpy(dst, bytes, n * 3);
+        }
+    } else if constexpr (std::is_same_v<Pixel, RGBA32>) {
+        kernels::pack24(bytes, dst, n, bgr);
+    } else if constexpr (std::is_same_v<Pixel, BGRA32>) {
+        kernels::pack24(bytes, dst, n, !bgr);
+    } else {
+        for (std::size_t i = 0; i < n; ++i) {
+            const Color c = pixel_traits<Pixel>::to_rgb(src[i]);
+            dst[i * 3 + 0] = bgr ? c.b : c.r;
+            dst[i * 3 + 1] = c.g;
+            dst[i * 3 + 2] = bgr ? c.r : c.b;
+        }
+    }
+}
+
+template <class Pixel>
+void pixels_to_rgb24(const Pixel *src, std::uint8_t *dst, std::size_t n) {
+    pixels_to_24(src, dst, n, false);
+}
+
+template <class Pixel>
+void pixels_to_bgr24(const Pixel *src, std::uint8_t *dst, std::size_t n) {
+    pixels_to_24(src, dst, n, true);
+}
+
+// Convert n pixels laid out as `layout` to the canvas format, for the image loaders.
+// The alpha of 32-bit sources is ignored: canvases loaded from files are opaque.
+template <class Pixel>
+void pixels_from(const std::uint8_t *src, PixelLayout layout, Pixel *dst, std::size_t n) {
+    auto *bytes = reinterpret_cast<std::uint8_t *>(dst);
+    const bool wide = layout_bytes(layout) == 4;
+    const bool bgr = layout == PixelLayout::bgr24 || layout == PixelLayout::bgra32;
+    if constexpr (std::is_same_v<Pixel, Color>) {
+        if (wide) {
+            kernels::pack24(src, bytes, n, bgr);
+        } else if (bgr) {
+            kernels::swap_rb24(src, bytes, n);
+        } else {
+            std::memcpy(bytes, src, n * 3);
+        }
+    } else if constexpr (std::is_same_v<Pixel, RGBA32> || std::is_same_v<Pixel, BGRA32>) {
+        if (!wide) {
+            kernels::expand32(src, bytes, n, bgr == std::is_same_v<Pixel, RGBA32>);
+            return;
+        }
+        for (std::size_t i = 0; i < n; ++i, src += 4) {
+            dst[i] = pixel_traits<Pixel>::from_rgb(bgr ? Color{src[2], src[1], src[0]} : Color{src[0], src[1], src[2]});
+        }
+    } else {
+        const std::size_t step = layout_bytes(layout);
+        for (std::size_t i = 0; i < n; ++i, src += step) {
+            dst[i] = pixel_traits<Pixel>::from_rgb(bgr ? Color{src[2], src[1], src[0]} : Color{src[0], src[1], src[2]});
+        }
+    }
+}
+} // namespace detail
+
+// A 2D pixel grid shared by every canvas flavour: `char` cells for ASCII art, packed RGB
+// (Color) and the 32-bit RGBA32/BGRA32 formats. Rows are `stride()` pixels apart; by
+// default the stride is the width rounded up so each row starts on a
+// pixel_traits<Pixel>::row_alignment byte boundary (a cache line for 32-bit formats).
+// Canvas, CanvasRGB and friends are aliases of this template.
+template <class Pixel>
+class BasicCanvas {
+public:
+    using pixel_type = Pixel;
+    using traits = pixel_traits<Pixel>;
+
+    BasicCanvas(std::size_t width, std::size_t height, Pixel background = traits::background(),
+                std::size_t stride = 0)
+        : width_(width), height_(height), stride_(stride ? stride : default_stride(width)), background_(background),
+          pixels_(stride_ * height, background), dirty_(width, height) {
+        assert(width_ > 0 && height_ > 0 && "Canvas dimensions must be positive");
+        assert(stride_ >= width_ && "Canvas stride must cover a whole row");
+        dirty_.mark_all(); // nothing has been presented yet
+    }
+
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+    std::size_t stride() const { return stride_; } // in pixels
+    Pixel background() const { return background_; }
+
+    // Turn this into a fresh width x height canvas filled with `background`. The pixel
+    // buffer is only reallocated when it is too small, so pooled canvases (see
+    // CanvasPool) cost a fill rather than an allocation per use.
+    void reset(std::size_t width, std::size_t height, Pixel background, std::size_t stride = 0) {
+        assert(width > 0 && height > 0 && "Canvas dimensions must be positive");
+        width_ = width;
+        height_ = height;
+        stride_ = stride ? stride : default_stride(width);
+        assert(stride_ >= width_ && "Canvas stride must cover a whole row");
+        background_ = background;
+        pixels_.resize(stride_ * height);
+        dirty_.reset(width, height);
+        clear(background);
+    }
+
+    std::size_t capacity() const { return pixels_.capacity(); } // in pixels
+    void reserve(std::size_t pixels) { pixels_.reserve(pixels); }
+
+    // Row stride, in pixels, used when none is given.
+    static std::size_t default_stride(std::size_t width) {
+        constexpr std::size_t align = traits::row_alignment;
+        const std::size_t bytes = width * sizeof(Pixel);
+        const std::size_t padded = (bytes + align - 1) / align * align;
+        return padded % sizeof(Pixel) == 0 ? padded / sizeof(Pixel) : width;
+    }
+
+    void clear() { clear(background_); }
+
+    void clear(Pixel background) {
+        kernels::fill(pixels_.data(), pixels_.size(), background);
+        dirty_.mark_all();
+        counters_.add(instrument::Counter::pixels_written, width_ * height_);
+    }
+
+    void set_pixel(int x, int y, Pixel color) {
+        // Negative coordinates wrap to huge unsigned values, so two compares cover all four edges.
+        if (static_cast<std::size_t>(x) >= width_ || static_cast<std::size_t>(y) >= height_) {
+            counters_.add(instrument::Counter::pixels_clipped);
+            return;
+        }
+        pixels_[index(static_cast<std::size_t>(x), static_cast<std::size_t>(y))] = color;
+        dirty_.mark(x, y);
+        counters_.add(instrument::Counter::pixels_written);
+    }
+
+    Pixel get_pixel(int x, int y) const {
+        if (static_cast<std::size_t>(x) >= width_ || static_cast<std::size_t>(y) >= height_) return Pixel{};
+        return pixels_[index(static_cast<std::size_t>(x), static_cast<std::size_t>(y))];
+    }
+
+    // Bresenham line, clipped to the canvas once and written through row pointers.
+    void draw_line(int x0, int y0, int x1, int y1, Pixel color) {
+        const raster::LineWalk walk = raster::clip_line(bounds(), x0, y0, x1, y1);
+        count_line(x0, y0, x1, y1, walk.empty() ? 0 : walk.count());
+        if (walk.empty()) return;
+        raster::walk_line(origin(), pitch(), walk, color);
+        dirty_.mark_line(walk.x, walk.y, walk.x_last, walk.y_last);
+    }
+
+    // Bresenham line drawn over the canvas at opacity alpha (0-255).
+    void draw_line(int x0, int y0, int x1, int y1, Pixel color, std::uint8_t alpha) {
+        if (alpha == 255) {
+            draw_line(x0, y0, x1, y1, color);
+            return;
+        }
+        const raster::LineWalk walk = raster::clip_line(bounds(), x0, y0, x1, y1);
+        count_line(x0, y0, x1, y1, walk.empty() || alpha == 0 ? 0 : walk.count());
+        if (walk.empty() || alpha == 0) return;
+        raster::visit_line(origin(), pitch(), walk, [&](Pixel &p) { traits::blend(p, color, alpha); });
+        dirty_.mark_line(walk.x, walk.y, walk.x_last, walk.y_last);
+    }
+
+    // Anti-aliased line between sub-pixel positions (pixel centres lie on whole numbers),
+    // blended at opacity alpha. Endpoints are snapped to 1/256 pixel.
+    void draw_line_aa(double x0, double y0, double x1, double y1, Pixel color, std::uint8_t alpha = 255) {
+        const std::int32_t fx0 = raster::to_subpixel(x0);
+        const std::int32_t fy0 = raster::to_subpixel(y0);
+        const std::int32_t fx1 = raster::to_subpixel(x1);
+        const std::int32_t fy1 = raster::to_subpixel(y1);
+        const std::size_t written = raster::draw_line_aa(origin(), pitch(), bounds(), fx0, fy0, fx1, fy1, color, alpha);
+        // Wu pixels sit within one pixel of the Bresenham line between the rounded
+        // endpoints, which may itself run just outside the canvas.
+        const Rect around = {-1, -1, static_cast<int>(width_) + 2, static_cast<int>(height_) + 2};
+        const int px0 = raster::nearest_pixel(fx0), py0 = raster::nearest_pixel(fy0);
+        const int px1 = raster::nearest_pixel(fx1), py1 = raster::nearest_pixel(fy1);
+        const raster::LineWalk walk = raster::clip_line(around, px0, py0, px1, py1);
+        if constexpr (instrument::enabled) {
+            // Clipping is counted in steps along the rounded line, one pixel per step.
+            const long long total = std::max(std::llabs(static_cast<long long>(px1) - px0),
+                                             std::llabs(static_cast<long long>(py1) - py0)) + 1;
+            const long long inside = walk.empty() ? 0 : walk.count();
+            counters_.add(instrument::Counter::segments);
+            counters_.add(instrument::Counter::pixels_written, written);
+            counters_.add(instrument::Counter::pixels_clipped, static_cast<std::uint64_t>(total - inside));
+        }
+        if (!walk.empty()) dirty_.mark_line(walk.x, walk.y, walk.x_last, walk.y_last, 2);
+    }
+
+    // Draw `color` over pixel (x, y) at opacity alpha (0-255).
+    void blend_pixel(int x, int y, Pixel color, std::uint8_t alpha) {
+        if (static_cast<std::size_t>(x) >= width_ || static_cast<std::size_t>(y) >= height_) {
+            counters_.add(instrument::Counter::pixels_clipped);
+            return;
+        }
+        traits::blend(pixels_[index(static_cast<std::size_t>(x), static_cast<std::size_t>(y))], color, alpha);
+        dirty_.mark(x, y);
+        counters_.add(instrument::Counter::pixels_written);
+    }
+
+    // Fill pixels [x0, x1) of row y with one bulk write.
+    void fill_span(int x0, int x1, int y, Pixel color) {
+        if (static_cast<std::size_t>(y) >= height_) return;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, static_cast<int>(width_));
+        if (x0 >= x1) return;
+        kernels::fill(row(static_cast<std::size_t>(y)) + x0, static_cast<std::size_t>(x1 - x0), color);
+        dirty_.mark({x0, y, x1 - x0, 1});
+        counters_.add(instrument::Counter::pixels_written, static_cast<std::uint64_t>(x1 - x0));
+    }
+
+    // Source-over `color` onto pixels [x0, x1) of row y. 32-bit formats only; alpha is
+    // straight and the destination is treated as opaque.
+    void blend_span(int x0, int x1, int y, Pixel color) {
+        static_assert(sizeof(Pixel) == 4, "blend_span() needs a 32-bit pixel format");
+        if (static_cast<std::size_t>(y) >= height_) return;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, static_cast<int>(width_));
+        if (x0 >= x1) return;
+        std::uint32_t v;
+        std::memcpy(&v, &color, 4);
+        kernels::blend32(reinterpret_cast<std::uint8_t *>(row(static_cast<std::size_t>(y)) + x0),
+                         static_cast<std::size_t>(x1 - x0), v);
+        dirty_.mark({x0, y, x1 - x0, 1});
+        counters_.add(instrument::Counter::pixels_written, static_cast<std::uint64_t>(x1 - x0));
+    }
+
+    // Source-over a canvas of the same format with its top-left corner at (x, y).
+    void blend(const BasicCanvas &src, int x, int y) {
+        static_assert(sizeof(Pixel) == 4, "blend() needs a 32-bit pixel format");
+        const Rect r = intersect({x, y, static_cast<int>(src.width_), static_cast<int>(src.height_)}, bounds());
+        if (r.empty()) return;
+        for (int yy = r.y; yy < r.bottom(); ++yy) {
+            kernels::blend32_row(reinterpret_cast<std::uint8_t *>(row(static_cast<std::size_t>(yy)) + r.x),
+                                 reinterpret_cast<const std::uint8_t *>(
+                                     src.row(static_cast<std::size_t>(yy - y)) + (r.x - x)),
+                                 static_cast<std::size_t>(r.w));
+        }
+        dirty_.mark(r);
+        counters_.add(instrument::Counter::pixels_written,
+                      static_cast<std::uint64_t>(r.w) * static_cast<std::uint64_t>(r.h));
+    }
+
+    // Scanline polygon fill, blended at opacity alpha (0-255) below 255.
+    void fill_polygon(const std::vector<Point> &points, Pixel color, FillRule rule = FillRule::even_odd,
+                      std::uint8_t alpha = 255) {
+        counters_.add(instrument::Counter::fills);
+        if (alpha == 0) return;
+        raster::scan_polygon(bounds(), points.data(), points.size(), rule, [&](int y, int x0, int x1) {
+            Pixel *p = row(static_cast<std::size_t>(y));
+            if (alpha == 255) {
+                kernels::fill(p + x0, static_cast<std::size_t>(x1 - x0), color);
+            } else {
+                for (int x = x0; x < x1; ++x) traits::blend(p[x], color, alpha);
+            }
+            dirty_.mark({x0, y, x1 - x0, 1});
+            counters_.add(instrument::Counter::pixels_written, static_cast<std::uint64_t>(x1 - x0));
+        });
+    }
+
+    // Filled disc of radius r centred on (cx, cy).
+    void fill_circle(int cx, int cy, int r, Pixel color) {
+        if (r <= 0) return;
+        const std::size_t written = raster::fill_circle(origin(), pitch(), bounds(), cx, cy, r, color);
+        dirty_.mark({cx - r, cy - r, 2 * r + 1, 2 * r + 1});
+        if constexpr (instrument::enabled) {
+            counters_.add(instrument::Counter::stamps);
+            counters_.add(instrument::Counter::pixels_written, written);
+            counters_.add(instrument::Counter::pixels_clipped,
+                          static_cast<std::uint64_t>(raster::disc_pixels(r)) - written);
+        }
+    }
+
+    // One-pixel circle outline of radius r (midpoint algorithm), blended at opacity alpha.
+    void draw_circle(int cx, int cy, int r, Pixel color, std::uint8_t alpha = 255) {
+        draw_arc(cx, cy, r, 0.0, 360.0, color, alpha);
+    }
+
+    // Part of that outline: `sweep_degrees` counterclockwise (clockwise when negative) from
+    // `start_degrees`, measured on screen from the +x axis. Angles snap to 1/64 degree.
+    void draw_arc(int cx, int cy, int r, double start_degrees, double sweep_degrees, Pixel color,
+                  std::uint8_t alpha = 255) {
+        if (r < 0) return;
+        counters_.add(instrument::Counter::segments);
+        if (alpha == 0) return;
+        const std::size_t written = raster::draw_arc(origin(), pitch(), bounds(), cx, cy, r,
+                                                     raster::to_arc_angles(start_degrees, sweep_degrees), color, alpha);
+        if (written == 0) return;
+        dirty_.mark({cx - r, cy - r, 2 * r + 1, 2 * r + 1});
+        counters_.add(instrument::Counter::pixels_written, written);
+    }
+
+    // Bucket fill: replace the 4-connected region of pixels equal to the one at (x, y)
+    // with `color` (see raster::flood_fill). Returns the number of pixels filled.
+    std::size_t flood_fill(int x, int y, Pixel color) {
+        counters_.add(instrument::Counter::fills);
+        Rect touched;
+        const std::size_t filled = raster::flood_fill(origin(), pitch(), bounds(), x, y, color, flood_stack_, &touched);
+        if (filled == 0) return 0;
+        dirty_.mark(touched);
+        counters_.add(instrument::Counter::pixels_written, filled);
+        return filled;
+    }
+
+    Rect bounds() const { return {0, 0, static_cast<int>(width_), static_cast<int>(height_)}; }
+
+    // Raw pixel access. Row y starts at data() + y * stride(). Writes made through these
+    // pointers are not tracked; report them with mark_dirty().
+    const Pixel *data() const { return pixels_.data(); }
+    Pixel *data() { return pixels_.data(); }
+    const Pixel *row(std::size_t y) const { return pixels_.data() + y * stride_; }
+    Pixel *row(std::size_t y) { return pixels_.data() + y * stride_; }
+
+    // Regions changed since the last clear_dirty(), for presenters, encoders and diffing
+    // tools that only want to touch what moved.
+    const DirtyRegion &dirty() const { return dirty_; }
+    std::vector<Rect> dirty_rects() const { return dirty_.rects(); }
+    void mark_dirty(const Rect &r) { dirty_.mark(r); }
+    void clear_dirty() { dirty_.clear(); }
+
+    // Work done on this canvas; always zero unless built with PROJECTCODE_INSTRUMENT.
+    const instrument::Counters &counters() const { return counters_; }
+    void reset_counters() { counters_.reset(); }
+
+    // Print the grid, one line per row (char canvases).
+    void render(std::ostream &os = std::cout) const {
+        static_assert(std::is_same_v<Pixel, char>, "render() prints character canvases");
+        for (std::size_t y = 0; y < height_; ++y) {
+            os.write(row(y), static_cast<std::streamsize>(width_));
+            os << '\n';
+        }
+    }
+
+    // Save as binary PPM (P6). Simple and dependency-free.
+    bool save_ppm(const std::string &filename, WriteMode mode = WriteMode::buffered) const {
+        PROJECTCODE_TRACE_SCOPE("canvas", "export");
+        const std::string header = "P6\n" + std::to_string(width_) + " " + std::to_string(height_) + "\n255\n";
+        return count_export(detail::write_rows(
+            filename, reinterpret_cast<const std::uint8_t *>(header.data()), header.size(), width_ * 3, height_,
+            [&](std::size_t y, std::uint8_t *dst) { detail::pixels_to_rgb24(row(y), dst, width_); }, mode));
+    }
+
+    // Save as uncompressed 24-bit BMP. Also dependency-free.
+    bool save_bmp(const std::string &filename, WriteMode mode = WriteMode::buffered) const {
+        PROJECTCODE_TRACE_SCOPE("canvas", "export");
+        std::uint8_t header[detail::bmp_header_size];
+        if (!detail::make_bmp_header(header, width_, height_)) return false; // over 4 GiB: use PPM or PNG
+        // BMP rows are padded to 4-byte boundaries.
+        const std::size_t row_stride = width_ * 3;
+        const std::size_t row_padded = (row_stride + 3u) & ~std::size_t{3};
+
+        // Pixel data: BMP stores bottom-to-top, each row padded to 4 bytes, BGR order.
+        return count_export(detail::write_rows(
+            filename, header, detail::bmp_header_size, row_padded, height_,
+            [&](std::size_t i, std::uint8_t *dst) {
+                const std::size_t y = height_ - 1 - i; // flip vertically
+                detail::pixels_to_bgr24(row(y), dst, width_);
+                std::memset(dst + row_stride, 0, row_padded - row_stride);
+            },
+            mode));
+    }
+
+    // Replace the canvas with a binary PPM (P6, maxval 255) or an uncompressed 24/32-bit
+    // BMP, taking the image's size. ReadMode::mapped decodes straight from the mapped file
+    // into the rows. Returns false, leaving the canvas untouched, if the file is missing
+    // or not in that format.
+    bool load_ppm(const std::string &filename, ReadMode mode = ReadMode::mapped) {
+        return load(filename, ImageFormat::ppm, mode);
+    }
+    bool load_bmp(const std::string &filename, ReadMode mode = ReadMode::mapped) {
+        return load(filename, ImageFormat::bmp, mode);
+    }
+
+    // A copy `factor` times smaller in each direction (rounded up), every pixel the mean of
+    // the block it covers; see BoxDownscaler. Made in one pass over the rows without a
+    // second full-size buffer, for thumbnails and for resolving supersampled renders.
+    BasicCanvas downscale(unsigned factor) const {
+        PROJECTCODE_TRACE_SCOPE("canvas", "downscale");
+        BoxDownscaler box(width_, height_, factor);
+        BasicCanvas out(box.width(), box.height(), background_);
+        std::vector<std::uint8_t> rgb(std::is_same_v<Pixel, Color> ? 0 : width_ * 3);
+        std::size_t out_y = 0;
+        for (std::size_t y = 0; y < height_; ++y) {
+            const std::uint8_t *src = reinterpret_cast<const std::uint8_t *>(row(y));
+            if constexpr (!std::is_same_v<Pixel, Color>) {
+                detail::pixels_to_rgb24(row(y), rgb.data(), width_);
+                src = rgb.data();
+            }
+            if (box.push(src)) detail::pixels_from(box.row(), PixelLayout::rgb24, out.row(out_y++), out.width_);
+        }
+        return out;
+    }
+
+    // The pixels as an ImageView, for compare_images (3 and 4-byte color formats).
+    ImageView view() const {
+        constexpr PixelLayout layout = std::is_same_v<Pixel, RGBA32>   ? PixelLayout::rgba32
+                                       : std::is_same_v<Pixel, BGRA32> ? PixelLayout::bgra32
+                                                                       : PixelLayout::rgb24;
+        static_assert(sizeof(Pixel) == layout_bytes(layout), "view() needs Color, RGBA32 or BGRA32 pixels");
+        return {reinterpret_cast<const std::uint8_t *>(row(0)), pitch() * static_cast<std::ptrdiff_t>(sizeof(Pixel)),
+                width_, height_, layout};
+    }
+
+    // Save as 24-bit PNG with the built-in encoder. Row chunks are filtered and deflated
+    // on `pool` when one is given.
+    bool save_png(const std::string &filename, ThreadPool *pool = nullptr) const {
+        PROJECTCODE_TRACE_SCOPE("canvas", "export");
+        return count_export(detail::write_png(
+            filename, width_, height_,
+            [this](std::size_t y, std::uint8_t *dst) { detail::pixels_to_rgb24(row(y), dst, width_); }, pool));
+    }
+
+private:
+    std::size_t width_;
+    std::size_t height_;
+    std::size_t stride_;
+    Pixel background_;
+    std::vector<Pixel, AlignedAllocator<Pixel, 64>> pixels_;
+    DirtyRegion dirty_;
+    std::vector<raster::FloodSpan> flood_stack_; // kept between flood fills
+    mutable instrument::Counters counters_; // exports count too
+
+    std::size_t index(std::size_t x, std::size_t y) const { return y * stride_ + x; }
+
+    void count_line(int x0, int y0, int x1, int y1, long long written) {
+        if constexpr (instrument::enabled) {
+            const long long total = std::max(std::llabs(static_cast<long long>(x1) - x0),
+                                             std::llabs(static_cast<long long>(y1) - y0)) + 1;
+            counters_.add(instrument::Counter::segments);
+            counters_.add(instrument::Counter::pixels_written, static_cast<std::uint64_t>(written));
+            counters_.add(instrument::Counter::pixels_clipped, static_cast<std::uint64_t>(total - written));
+        } else {
+            (void)x0, (void)y0, (void)x1, (void)y1, (void)written;
+        }
+    }
+
+    // Exports are counted once the file is written; returns `written`.
+    bool count_export(bool written) const {
+        if (written) counters_.add(instrument::Counter::bytes_exported, width_ * height_ * 3);
+        return written;
+    }
+
+    bool load(const std::string &filename, ImageFormat format, ReadMode mode) {
+        PROJECTCODE_TRACE_SCOPE("canvas", "import");
+        const ImageFile image = ImageFile::open(filename, mode);
+        if (!image.is_open() || image.format() != format) return false;
+        const ImageView &src = image.view();
+        width_ = src.width;
+        height_ = src.height;
+        stride_ = default_stride(width_);
+        pixels_.resize(stride_ * height_);
+        for (std::size_t y = 0; y < height_; ++y) detail::pixels_from(src.row(y), src.layout, row(y), width_);
+        dirty_.reset(width_, height_);
+        dirty_.mark_all();
+        return true;
+    }
+    Pixel *origin() { return pixels_.data(); }
+    std::ptrdiff_t pitch() const { return static_cast<std::ptrdiff_t>(stride_); }
+};
+
+} // namespace projectcode
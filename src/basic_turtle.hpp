@@ -0,0 +1,543 @@
+#pragma once
+
+#include "display_list.hpp"
+#include "instrument.hpp"
+#include "pixel.hpp"
+#include "virtual_clock.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace projectcode {
+
+namespace detail {
+struct Direction {
+    double cos;
+    double sin;
+};
+
+// cos and sin of every whole degree. Only 0-45 degrees are evaluated; the rest are
+// mirrored from them, so cos(90) is exactly 0, sin(30) is exactly 0.5 and opposite
+// headings get exactly opposite steps.
+inline const Direction *whole_degree_directions() {
+    static const auto table = [] {
+        constexpr double pi = 3.14159265358979323846;
+        double s[91];
+        for (int d = 0; d <= 90; ++d) s[d] = d <= 45 ? std::sin(d * pi / 180.0) : std::cos((90 - d) * pi / 180.0);
+        s[30] = 0.5;
+        std::array<Direction, 360> t{};
+        for (int d = 0; d < 360; ++d) {
+            const int r = d % 90;
+            switch (d / 90) {
+            case 0: t[d] = {s[90 - r], s[r]}; break;
+            case 1: t[d] = {-s[r], s[90 - r]}; break;
+            case 2: t[d] = {-s[90 - r], -s[r]}; break;
+            default: t[d] = {s[r], -s[90 - r]}; break;
+            }
+        }
+        return t;
+    }();
+    return table.data();
+}
+} // namespace detail
+
+// Turtle graphics over any canvas with BasicCanvas's drawing interface. The pen draws
+// `Canvas::pixel_type` values: characters on a Canvas, colors on a CanvasRGB.
+// Turtle and TurtleRGB are aliases of this template.
+template <class Canvas>
+class BasicTurtle {
+public:
+    using canvas_type = Canvas;
+    using pixel_type = typename Canvas::pixel_type;
+    using display_list_type = BasicDisplayList<pixel_type>;
+
+    explicit BasicTurtle(Canvas &canvas, double start_x = 0.0, double start_y = 0.0)
+        : canvas_(canvas), x_(start_x), y_(start_y) {
+        clamp_to_canvas();
+        update_direction();
+    }
+    // An open wide-pen path still reaches the canvas; a list recorded to may be gone by now,
+    // so recordings need finish_path() before they are used.
+    ~BasicTurtle() {
+        recorder_ = nullptr;
+        finish_path();
+    }
+
+    void set_delay_ms(unsigned delay_ms) { delay_ms_ = delay_ms; }
+
+    // Spend delays on `clock` instead of sleeping (nullptr restores real sleeps).
+    void set_clock(VirtualClock *clock) { clock_ = clock; }
+
+    // Append everything this turtle draws to `list` (nullptr stops recording). With
+    // draw == false the turtle only records: the canvas is left untouched and, unless
+    // keep_delays is set, delays are skipped; the result is produced later with
+    // DisplayList::replay() or by another thread (see RenderPipeline). Call finish_path()
+    // before using the list if a wide pen may still have a path open.
+    void record_to(display_list_type *list, bool draw = true, bool keep_delays = false) {
+        finish_path();
+        recorder_ = list;
+        draw_to_canvas_ = draw || list == nullptr;
+        keep_delays_ = keep_delays;
+    }
+
+    void forward(double distance) {
+        if (distance == 0.0) return;
+        if (fixed_point_) {
+            if (distance != step_distance_) { // repeated steps reuse the rounded offset
+                step_distance_ = distance;
+                step_fx_ = std::llround(distance * cos_ * fixed_one);
+                step_fy_ = -std::llround(distance * sin_ * fixed_one); // invert Y for top-left origin
+            }
+            line_to_fixed(fx_ + step_fx_, fy_ + step_fy_, true);
+        } else {
+            line_to(x_ + distance * cos_, y_ - distance * sin_, true); // invert Y for top-left origin
+        }
+        apply_delay();
+    }
+
+    void move_to(double new_x, double new_y, bool draw = false) {
+        line_to(new_x, new_y, draw);
+        apply_delay();
+    }
+
+    // Python turtle's circle(): an arc of `extent` degrees through the current position,
+    // centred `radius` units to the left (to the right when radius is negative). The
+    // turtle ends on the arc with its heading turned by the extent. Thin aliased pens draw
+    // the outline with the midpoint circle algorithm; anti-aliased and wide pens draw the
+    // chords Python would.
+    void circle(double radius, double extent = 360.0) {
+        if (extent == 0.0) return;
+        if (radius == 0.0) {
+            turn_left(extent);
+            return;
+        }
+        const double sign = radius > 0 ? 1.0 : -1.0;
+        const double r = std::abs(radius);
+        const double cx = x_ - radius * sin_;
+        const double cy = y_ - radius * cos_;
+        const double start = heading_degrees_ - sign * 90.0;
+        const double sweep = sign * extent;
+        auto point_at = [&](double degrees) {
+            const double rad = deg_to_rad(degrees);
+            return Point{cx + r * std::cos(rad), cy - r * std::sin(rad)};
+        };
+        // Python's chord count, used for fill vertices and anti-aliased outlines.
+        const int steps = 1 + static_cast<int>(std::min(11.0 + r / 6.0, 59.0) * std::abs(extent) / 360.0);
+        const Point end = std::fmod(extent, 360.0) == 0.0 ? Point{x_, y_} : point_at(start + sweep);
+        const double end_heading = heading_degrees_ + sweep;
+
+        if (antialias_ || pen_width_ > 1.0) {
+            for (int k = 1; k < steps; ++k) {
+                const Point p = point_at(start + sweep * k / steps);
+                line_to(p.x, p.y, true);
+            }
+            line_to(end.x, end.y, true);
+        } else {
+            Stroke arc = make_stroke(end.x, end.y, 0, 0);
+            arc.px0 = static_cast<int>(std::round(cx));
+            arc.py0 = static_cast<int>(std::round(cy));
+            arc.arc_radius = static_cast<int>(std::round(r));
+            arc.arc = raster::to_arc_angles(start, sweep);
+            if (pen_is_down_) emit_stroke(arc);
+            if (filling_) {
+                for (int k = 1; k < steps; ++k) {
+                    const Point p = point_at(start + sweep * k / steps);
+                    fill_path_.push_back({static_cast<int>(std::round(p.x)), static_cast<int>(std::round(p.y)), false});
+                }
+            }
+            const std::size_t arc_vertex = fill_path_.size();
+            line_to(end.x, end.y, false);
+            if (filling_ && pen_is_down_) { // repaint the arc, not a chord, over the fill
+                fill_path_[arc_vertex].stroked = true;
+                fill_path_[arc_vertex].stroke = arc;
+            }
+        }
+        set_heading(end_heading);
+        apply_delay();
+    }
+
+    void turn_left(double degrees) { set_heading(heading_degrees_ + degrees); }
+    void turn_right(double degrees) { set_heading(heading_degrees_ - degrees); }
+
+    void pen_down() { pen_is_down_ = true; }
+    void pen_up() {
+        pen_is_down_ = false;
+        joinable_ = false;
+        finish_path();
+    }
+
+    void set_pen(pixel_type color) { pen_color_ = color; }
+
+    // Pen opacity (0-255); strokes below 255 are blended over what is already drawn.
+    void set_pen_alpha(std::uint8_t alpha) { pen_alpha_ = alpha; }
+    std::uint8_t pen_alpha() const { return pen_alpha_; }
+
+    // Pen width in pixels. Strokes wider than 1 are filled as polygons, one span per row;
+    // they are not anti-aliased. A stroke that starts where the previous one ended is
+    // joined to it, and the path they form gets caps only at its two ends. The defaults,
+    // round caps and joins, match Python turtle.
+    //
+    // Translucent wide strokes are collected while they join and the whole path is filled
+    // once when it ends (see finish_path()), so corners where strokes overlap are not
+    // blended twice. Opaque ones are drawn as they come; only the end cap waits.
+    void set_pen_width(double width) { pen_width_ = std::max(width, 0.0); }
+    double pen_width() const { return pen_width_; }
+    void set_line_cap(LineCap cap) { line_cap_ = cap; }
+    void set_line_join(LineJoin join) { line_join_ = join; }
+
+    // Anti-aliased strokes: Wu lines between the exact (unrounded) turtle positions.
+    void set_antialias(bool on) { antialias_ = on; }
+    bool antialias() const { return antialias_; }
+
+    // Fixed-point position: coordinates are integers in 1/65536 pixel and each forward()
+    // adds a rounded integer step, so there is no floating-point drift and a closed path
+    // of whole-degree turns returns exactly to its start. Pixels are found with a shift
+    // (halves round up) instead of std::round.
+    void set_fixed_point(bool on) {
+        if (on == fixed_point_) return;
+        fixed_point_ = on;
+        if (on) {
+            fx_ = to_fixed(x_);
+            fy_ = to_fixed(y_);
+            clamp_to_canvas();
+            step_distance_ = 0.0;
+        }
+    }
+    bool fixed_point() const { return fixed_point_; }
+
+    // Filling works like Python turtle: every position visited between begin_fill() and
+    // end_fill() becomes a polygon vertex, and end_fill() fills it with the fill color.
+    // Outline segments drawn meanwhile are repainted on top of the fill.
+    void set_fill(pixel_type color) { fill_color_ = color; }
+    void set_fill_rule(FillRule rule) { fill_rule_ = rule; }
+
+    void begin_fill() {
+        filling_ = true;
+        fill_path_.clear();
+        fill_path_.push_back({pixel_x(), pixel_y(), false});
+    }
+
+    void end_fill() {
+        if (!filling_) return;
+        filling_ = false;
+        fill_points_.clear();
+        for (const auto &v : fill_path_) {
+            fill_points_.push_back({static_cast<double>(v.x), static_cast<double>(v.y)});
+        }
+        emit_fill(fill_points_, fill_color_, fill_rule_);
+        for (const auto &v : fill_path_) {
+            if (v.stroked) emit_stroke(v.stroke);
+        }
+        finish_path();
+    }
+
+    bool filling() const { return filling_; }
+
+    // End the wide-pen path in progress: draw its end cap and, for a translucent pen, the
+    // whole path. Moving without drawing, pen_up(), any other kind of drawing, delays and
+    // the turtle's destruction do this too; call it before using the canvas mid-path. A
+    // path continued after this is joined as usual but overlaps at that corner.
+    void finish_path() {
+        if (!path_open_) return;
+        path_open_ = false;
+        const Stroke &s = path_stroke_;
+        if (s.alpha == 255) path_.clear(); // drawn already
+        path_.add_cap({s.x0, s.y0}, {s.x1, s.y1}, s.width, s.cap);
+        if (path_.empty()) return;
+        path_.outline(outline_);
+        path_.clear();
+        if (recorder_) recorder_->add_fill(outline_, s.color, FillRule::nonzero, s.alpha);
+        on_canvas([&] { canvas_.fill_polygon(outline_, s.color, FillRule::nonzero, s.alpha); });
+    }
+
+    void set_heading(double degrees) {
+        heading_degrees_ = normalize_angle(degrees);
+        update_direction();
+    }
+    double heading() const { return heading_degrees_; }
+
+    double x() const { return x_; }
+    double y() const { return y_; }
+
+    // Bucket fill from the pixel under the turtle, with the fill color or `color`: the
+    // connected region of that pixel's color is repainted (see BasicCanvas::flood_fill).
+    void fill_here() { fill_here(fill_color_); }
+    void fill_here(pixel_type color) {
+        finish_path();
+        counters_.add(instrument::Counter::fills);
+        if (recorder_) recorder_->add_flood(pixel_x(), pixel_y(), color);
+        on_canvas([&] { canvas_.flood_fill(pixel_x(), pixel_y(), color); });
+    }
+
+    void stamp_dot(int radius = 3, pixel_type color = pixel_traits<pixel_type>::pen()) {
+        if (radius <= 0) return;
+        finish_path();
+        if (recorder_) recorder_->add_stamp(pixel_x(), pixel_y(), radius, color);
+        counters_.add(instrument::Counter::stamps);
+        on_canvas([&] { canvas_.fill_circle(pixel_x(), pixel_y(), radius, color); });
+    }
+
+    // Segments, fills and stamps this turtle issued, plus the canvas pixels they touched.
+    // Always zero unless built with PROJECTCODE_INSTRUMENT.
+    const instrument::Counters &counters() const { return counters_; }
+    void reset_counters() { counters_.reset(); }
+
+private:
+    Canvas &canvas_;
+    double x_;
+    double y_;
+    double heading_degrees_ = 0.0; // 0 degrees points right
+    double cos_ = 1.0;             // direction of heading_degrees_
+    double sin_ = 0.0;
+    bool pen_is_down_ = true;
+    pixel_type pen_color_ = pixel_traits<pixel_type>::pen();
+    unsigned delay_ms_ = 0;
+    VirtualClock *clock_ = nullptr;
+    display_list_type *recorder_ = nullptr;
+    bool draw_to_canvas_ = true;
+    bool keep_delays_ = false;
+    instrument::Counters counters_;
+
+    std::uint8_t pen_alpha_ = 255;
+    bool antialias_ = false;
+    double pen_width_ = 1.0;
+    LineCap line_cap_ = LineCap::round;
+    LineJoin line_join_ = LineJoin::round;
+    bool joinable_ = false; // the last stroke ended at the current position
+    Point join_from_{};     // and started here
+    std::vector<Point> outline_;
+    raster::StrokePath path_; // wide-pen path in progress: pending pieces of a translucent one
+    bool path_open_ = false;  // its end cap is still to be drawn
+
+    static constexpr double fixed_one = 65536.0;
+    bool fixed_point_ = false;
+    std::int64_t fx_ = 0; // position in fixed-point mode; x_/y_ mirror it exactly
+    std::int64_t fy_ = 0;
+    double step_distance_ = 0.0; // forward() offset cached for this distance (0: none)
+    std::int64_t step_fx_ = 0;
+    std::int64_t step_fy_ = 0;
+
+    // One pen stroke, kept so end_fill() can repaint outlines over the fill. Aliased
+    // strokes use the pixel endpoints, anti-aliased and wide ones the exact positions. Arcs
+    // from circle() keep their pixel centre in px0/py0.
+    struct Stroke {
+        double x0;
+        double y0;
+        double x1;
+        double y1;
+        int px0;
+        int py0;
+        int px1;
+        int py1;
+        pixel_type color;
+        std::uint8_t alpha;
+        bool antialias;
+        int arc_radius = -1; // -1: a line
+        raster::ArcAngles arc{};
+        double width = 1.0;
+        LineCap cap = LineCap::round;
+        LineJoin join = LineJoin::round;
+        bool joined = false; // continues a stroke from `from`
+        Point from{};
+    };
+
+    struct FillVertex {
+        int x;
+        int y;
+        bool stroked;    // a line was drawn from the previous vertex to this one
+        Stroke stroke{}; // that line
+    };
+    bool filling_ = false;
+    pixel_type fill_color_ = pixel_traits<pixel_type>::pen();
+    FillRule fill_rule_ = FillRule::even_odd;
+    std::vector<FillVertex> fill_path_;
+    std::vector<Point> fill_points_;
+    Stroke path_stroke_{}; // last stroke of the wide-pen path in progress
+
+    static double deg_to_rad(double degrees) {
+        constexpr double pi = 3.14159265358979323846;
+        return degrees * pi / 180.0;
+    }
+
+    // Refresh the cached direction after a heading change.
+    void update_direction() {
+        const double whole = std::floor(heading_degrees_);
+        if (whole == heading_degrees_ && whole < 360.0) {
+            const detail::Direction d = detail::whole_degree_directions()[static_cast<int>(whole)];
+            cos_ = d.cos;
+            sin_ = d.sin;
+        } else {
+            const double rad = deg_to_rad(heading_degrees_);
+            cos_ = std::cos(rad);
+            sin_ = std::sin(rad);
+        }
+        step_distance_ = 0.0;
+    }
+
+    static std::int64_t to_fixed(double v) { return std::llround(v * fixed_one); }
+    static double from_fixed(std::int64_t v) { return static_cast<double>(v) / fixed_one; }
+    static int fixed_to_pixel(std::int64_t v) { return static_cast<int>((v + 32768) >> 16); }
+
+    static double normalize_angle(double degrees) {
+        double result = std::fmod(degrees, 360.0);
+        if (result < 0) result += 360.0;
+        return result;
+    }
+
+    int pixel_x() const { return fixed_point_ ? fixed_to_pixel(fx_) : static_cast<int>(std::round(x_)); }
+    int pixel_y() const { return fixed_point_ ? fixed_to_pixel(fy_) : static_cast<int>(std::round(y_)); }
+
+    void line_to(double new_x, double new_y, bool draw) {
+        if (fixed_point_) {
+            line_to_fixed(to_fixed(new_x), to_fixed(new_y), draw);
+            return;
+        }
+        const int x1 = static_cast<int>(std::round(new_x));
+        const int y1 = static_cast<int>(std::round(new_y));
+        const Stroke stroke = make_stroke(new_x, new_y, x1, y1);
+        const bool stroked = draw && pen_is_down_;
+        if (stroked) emit_stroke(stroke);
+        x_ = new_x;
+        y_ = new_y;
+        clamp_to_canvas();
+        track_join(stroked, stroke);
+        add_fill_vertex(x1, y1, stroked, stroke);
+    }
+
+    void line_to_fixed(std::int64_t nfx, std::int64_t nfy, bool draw) {
+        const int x1 = fixed_to_pixel(nfx);
+        const int y1 = fixed_to_pixel(nfy);
+        const Stroke stroke = make_stroke(from_fixed(nfx), from_fixed(nfy), x1, y1);
+        const bool stroked = draw && pen_is_down_;
+        if (stroked) emit_stroke(stroke);
+        fx_ = nfx;
+        fy_ = nfy;
+        clamp_to_canvas();
+        track_join(stroked, stroke);
+        add_fill_vertex(x1, y1, stroked, stroke);
+    }
+
+    Stroke make_stroke(double new_x, double new_y, int x1, int y1) const {
+        Stroke s = {x_, y_, new_x, new_y, pixel_x(), pixel_y(), x1, y1, pen_color_, pen_alpha_, antialias_};
+        s.width = pen_width_;
+        s.cap = line_cap_;
+        s.join = line_join_;
+        s.joined = joinable_;
+        s.from = join_from_;
+        return s;
+    }
+
+    // A stroke the turtle was not clamped out of can be joined by the next one.
+    void track_join(bool stroked, const Stroke &stroke) {
+        joinable_ = stroked && x_ == stroke.x1 && y_ == stroke.y1;
+        join_from_ = {stroke.x0, stroke.y0};
+        if (!joinable_) finish_path();
+    }
+
+    void add_fill_vertex(int x1, int y1, bool stroked, const Stroke &stroke) {
+        if (!filling_) return;
+        fill_path_.push_back({x1, y1, stroked, stroke});
+        // A segment leaving the canvas ends where the turtle was clamped to.
+        if (pixel_x() != x1 || pixel_y() != y1) fill_path_.push_back({pixel_x(), pixel_y(), false});
+    }
+
+    void clamp_to_canvas() {
+        if (fixed_point_) {
+            fx_ = std::max<std::int64_t>(0, std::min<std::int64_t>(fx_, static_cast<std::int64_t>(canvas_.width() - 1) << 16));
+            fy_ = std::max<std::int64_t>(0, std::min<std::int64_t>(fy_, static_cast<std::int64_t>(canvas_.height() - 1) << 16));
+            x_ = from_fixed(fx_);
+            y_ = from_fixed(fy_);
+            return;
+        }
+        x_ = std::max(0.0, std::min(x_, static_cast<double>(canvas_.width() - 1)));
+        y_ = std::max(0.0, std::min(y_, static_cast<double>(canvas_.height() - 1)));
+    }
+
+    // Same pen, so a joining stroke can extend the path in progress.
+    static bool same_pen(const Stroke &a, const Stroke &b) {
+        return std::memcmp(&a.color, &b.color, sizeof(pixel_type)) == 0 && a.alpha == b.alpha &&
+               a.width == b.width && a.cap == b.cap && a.join == b.join;
+    }
+
+    void emit_stroke(const Stroke &s) {
+        if (s.width > 1.0 && s.arc_radius < 0) {
+            if (path_open_ && !(s.joined && same_pen(s, path_stroke_))) finish_path();
+            if (s.alpha == 255) path_.clear(); // opaque strokes are drawn one by one
+            path_.add({s.x0, s.y0}, {s.x1, s.y1}, s.width, s.cap, s.join, s.joined ? &s.from : nullptr);
+            path_open_ = true;
+            path_stroke_ = s;
+            counters_.add(instrument::Counter::segments);
+            if (s.alpha < 255 || path_.empty()) return;
+            path_.outline(outline_);
+            if (recorder_) recorder_->add_fill(outline_, s.color, FillRule::nonzero, s.alpha);
+            on_canvas([&] { canvas_.fill_polygon(outline_, s.color, FillRule::nonzero, s.alpha); });
+            return;
+        }
+        finish_path();
+        if (s.arc_radius >= 0) {
+            counters_.add(instrument::Counter::segments);
+            if (recorder_) recorder_->add_arc(s.px0, s.py0, s.arc_radius, s.arc, s.color, s.alpha);
+            on_canvas([&] {
+                canvas_.draw_arc(s.px0, s.py0, s.arc_radius, s.arc.start / 64.0, s.arc.sweep / 64.0, s.color, s.alpha);
+            });
+            return;
+        }
+        if (s.antialias) {
+            const std::int32_t fx0 = raster::to_subpixel(s.x0);
+            const std::int32_t fy0 = raster::to_subpixel(s.y0);
+            const std::int32_t fx1 = raster::to_subpixel(s.x1);
+            const std::int32_t fy1 = raster::to_subpixel(s.y1);
+            counters_.add(instrument::Counter::segments);
+            if (recorder_) recorder_->add_aa_line(fx0, fy0, fx1, fy1, s.color, s.alpha);
+            on_canvas([&] { canvas_.draw_line_aa(s.x0, s.y0, s.x1, s.y1, s.color, s.alpha); });
+            return;
+        }
+        counters_.add(instrument::Counter::segments);
+        if (recorder_) recorder_->add_line(s.px0, s.py0, s.px1, s.py1, s.color, s.alpha);
+        on_canvas([&] { canvas_.draw_line(s.px0, s.py0, s.px1, s.py1, s.color, s.alpha); });
+    }
+
+    void emit_fill(const std::vector<Point> &points, pixel_type color, FillRule rule) {
+        finish_path();
+        counters_.add(instrument::Counter::fills);
+        if (recorder_) recorder_->add_fill(points, color, rule);
+        on_canvas([&] { canvas_.fill_polygon(points, color, rule); });
+    }
+
+    // Run one canvas draw call; instrumented builds time it and credit the pixels it
+    // wrote or clipped to this turtle.
+    template <class Draw>
+    void on_canvas(Draw &&draw) {
+        if (!draw_to_canvas_) return;
+        if constexpr (instrument::enabled) {
+            PROJECTCODE_TRACE_SCOPE("turtle", "rasterize");
+            const instrument::Counters &c = canvas_.counters();
+            const std::uint64_t written = c.get(instrument::Counter::pixels_written);
+            const std::uint64_t clipped = c.get(instrument::Counter::pixels_clipped);
+            draw();
+            counters_.add(instrument::Counter::pixels_written, c.get(instrument::Counter::pixels_written) - written);
+            counters_.add(instrument::Counter::pixels_clipped, c.get(instrument::Counter::pixels_clipped) - clipped);
+        } else {
+            draw();
+        }
+    }
+
+    void apply_delay() {
+        if (delay_ms_ == 0 || !(draw_to_canvas_ || keep_delays_)) return;
+        finish_path(); // show the path so far while waiting
+        PROJECTCODE_TRACE_SCOPE("turtle", "delay");
+        if (clock_) {
+            clock_->advance_ms(delay_ms_);
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+    }
+};
+
+} // namespace projectcode
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "canvas_rgb.hpp"
+#include "thread_pool.hpp"
+#include "turtle_rgb.hpp"
+#include "virtual_clock.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace projectcode {
+
+// Thread-safe pool of reusable canvases. Canvases are bucketed by pixel capacity rounded
+// up to a power of two, and a new one reserves its whole bucket, so any later request
+// in the same bucket is served by BasicCanvas::reset() without touching the allocator.
+// Once every bucket a workload needs holds as many canvases as run at once, acquiring
+// allocates nothing.
+template <class Pixel>
+class BasicCanvasPool {
+public:
+    using canvas_type = BasicCanvas<Pixel>;
+
+    // A canvas on loan; it goes back to its pool when the lease is destroyed.
+    class Lease {
+    public:
+        Lease(Lease &&other) noexcept : pool_(other.pool_), canvas_(std::move(other.canvas_)) {}
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        Lease &operator=(Lease &&) = delete;
+        ~Lease() {
+            if (canvas_) pool_->release(std::move(canvas_));
+        }
+
+        canvas_type &operator*() const { return *canvas_; }
+        canvas_type *operator->() const { return canvas_.get(); }
+
+    private:
+        friend class BasicCanvasPool;
+        Lease(BasicCanvasPool *pool, std::unique_ptr<canvas_type> canvas) : pool_(pool), canvas_(std::move(canvas)) {}
+
+        BasicCanvasPool *pool_;
+        std::unique_ptr<canvas_type> canvas_;
+    };
+
+    Lease acquire(std::size_t width, std::size_t height, Pixel background = pixel_traits<Pixel>::background()) {
+        const unsigned b = bucket(width, height);
+        std::unique_ptr<canvas_type> canvas;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto &free = free_[b];
+            if (!free.empty()) {
+                canvas = std::move(free.back());
+                free.pop_back();
+            }
+        }
+        if (!canvas) {
+            canvas = std::make_unique<canvas_type>(1, 1, background);
+            canvas->reserve(std::size_t{1} << b);
+            allocations_.fetch_add(1, std::memory_order_relaxed);
+        }
+        canvas->reset(width, height, background);
+        return Lease(this, std::move(canvas));
+    }
+
+    // Canvases created so far; flat in steady state.
+    std::size_t allocations() const { return allocations_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr unsigned bucket_count = 8 * sizeof(std::size_t);
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<canvas_type>> free_[bucket_count];
+    std::atomic<std::size_t> allocations_{0};
+
+    static unsigned bucket(std::size_t width, std::size_t height) {
+        const std::size_t need = canvas_type::default_stride(width) * height; // what reset() will size
+        unsigned b = 0;
+        while ((std::size_t{1} << b) < need) ++b;
+        return b;
+    }
+
+    void release(std::unique_ptr<canvas_type> canvas) {
+        const unsigned b = bucket_of(canvas->capacity());
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_[b].push_back(std::move(canvas));
+    }
+
+    static unsigned bucket_of(std::size_t capacity) {
+        unsigned b = 0;
+        while (b + 1 < bucket_count && (std::size_t{1} << (b + 1)) <= capacity) ++b;
+        return b;
+    }
+};
+
+using CanvasPool = BasicCanvasPool<Color>;
+
+// One program of a batch: draw code plus where its picture goes.
+struct BatchJob {
+    std::function<void(CanvasRGB &, TurtleRGB &)> draw;
+    std::string output; // written as PPM, BMP or PNG by extension; empty renders only
+    std::size_t width = 800;
+    std::size_t height = 600;
+    Color background{240, 248, 255};
+};
+
+struct BatchStats {
+    std::size_t jobs = 0;
+    std::size_t failed = 0; // draw code threw or the export failed
+    double seconds = 0.0;
+    std::size_t canvases_allocated = 0; // by this run
+
+    double jobs_per_second() const { return seconds > 0.0 ? static_cast<double>(jobs) / seconds : 0.0; }
+};
+
+namespace detail {
+inline bool ends_with(const std::string &s, const char *suffix) {
+    const std::size_t n = std::char_traits<char>::length(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// Export through the canvas's own writers, picked by file extension.
+template <class Pixel>
+bool save_by_extension(const BasicCanvas<Pixel> &canvas, const std::string &path) {
+    if (ends_with(path, ".png")) return canvas.save_png(path);
+    if (ends_with(path, ".bmp")) return canvas.save_bmp(path);
+    if (ends_with(path, ".ppm")) return canvas.save_ppm(path);
+    return false;
+}
+} // namespace detail
+
+// Renders many short turtle programs concurrently. Each job runs on a ThreadPool worker
+// with a pooled canvas and a fresh turtle at (0, 0); turtle delays go to a virtual clock,
+// so a submission that animates itself costs no wall time. Jobs are independent: one
+// that throws is counted as failed and the rest carry on.
+class BatchRenderer {
+public:
+    BatchRenderer(ThreadPool &pool, CanvasPool &canvases) : pool_(pool), canvases_(canvases) {}
+
+    BatchStats run(const std::vector<BatchJob> &jobs) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t allocated = canvases_.allocations();
+        std::atomic<std::size_t> failed{0};
+
+        pool_.parallel_for(jobs.size(), [&](std::size_t i) {
+            if (!run_job(jobs[i])) failed.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        BatchStats stats;
+        stats.jobs = jobs.size();
+        stats.failed = failed.load();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats.canvases_allocated = canvases_.allocations() - allocated;
+        return stats;
+    }
+
+private:
+    ThreadPool &pool_;
+    CanvasPool &canvases_;
+
+    bool run_job(const BatchJob &job) {
+        try {
+            auto canvas = canvases_.acquire(job.width, job.height, job.background);
+            TurtleRGB turtle(*canvas, 0, 0);
+            VirtualClock clock;
+            turtle.set_clock(&clock);
+            job.draw(*canvas, turtle);
+            return job.output.empty() || detail::save_by_extension(*canvas, job.output);
+        } catch (...) {
+            return false;
+        }
+    }
+};
+
+} // namespace projectcode
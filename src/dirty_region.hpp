@@ -0,0 +1,172 @@
+#pragma once
+
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace projectcode {
+
+// Tracks which parts of a width x height surface changed, at the granularity of square
+// tiles. Marking is a couple of shifts and a byte store, cheap enough for set_pixel.
+// rects() merges the dirty tiles into a short list of rectangles for presenters,
+// encoders or diffing tools; clear() starts a new frame.
+class DirtyRegion {
+public:
+    explicit DirtyRegion(std::size_t width = 0, std::size_t height = 0, unsigned tile_shift = 6)
+        : width_(width), height_(height), shift_(tile_shift),
+          tiles_x_((width + tile_size() - 1) >> tile_shift), tiles_y_((height + tile_size() - 1) >> tile_shift),
+          tiles_(tiles_x_ * tiles_y_, 0) {}
+
+    // Resize to a new surface with nothing dirty, keeping the tile storage if it is big enough.
+    void reset(std::size_t width, std::size_t height) {
+        width_ = width;
+        height_ = height;
+        tiles_x_ = (width + tile_size() - 1) >> shift_;
+        tiles_y_ = (height + tile_size() - 1) >> shift_;
+        tiles_.assign(tiles_x_ * tiles_y_, 0);
+        any_ = false;
+    }
+
+    std::size_t tile_size() const { return std::size_t{1} << shift_; }
+    std::size_t tiles_x() const { return tiles_x_; }
+    std::size_t tiles_y() const { return tiles_y_; }
+
+    bool empty() const { return !any_; }
+    bool tile_dirty(std::size_t tx, std::size_t ty) const { return tiles_[ty * tiles_x_ + tx] != 0; }
+
+    // Callers guarantee (x, y) lies on the surface.
+    void mark(int x, int y) {
+        tiles_[(static_cast<std::size_t>(y) >> shift_) * tiles_x_ + (static_cast<std::size_t>(x) >> shift_)] = 1;
+        any_ = true;
+    }
+
+    void mark(const Rect &r) {
+        const Rect c = intersect(r, {0, 0, static_cast<int>(width_), static_cast<int>(height_)});
+        if (c.empty()) return;
+        const std::size_t tx0 = static_cast<std::size_t>(c.x) >> shift_;
+        const std::size_t tx1 = static_cast<std::size_t>(c.right() - 1) >> shift_;
+        const std::size_t ty0 = static_cast<std::size_t>(c.y) >> shift_;
+        const std::size_t ty1 = static_cast<std::size_t>(c.bottom() - 1) >> shift_;
+        for (std::size_t ty = ty0; ty <= ty1; ++ty) {
+            std::fill(tiles_.begin() + static_cast<std::ptrdiff_t>(ty * tiles_x_ + tx0),
+                      tiles_.begin() + static_cast<std::ptrdiff_t>(ty * tiles_x_ + tx1 + 1), std::uint8_t{1});
+        }
+        any_ = true;
+    }
+
+    // Mark the pixels a line from (x0, y0) to (x1, y1) may touch, plus `pad` pixels around
+    // them. Long lines are split into tile-sized pieces so a diagonal does not dirty its
+    // whole bounding box.
+    void mark_line(int x0, int y0, int x1, int y1, int pad = 1) {
+        const long long dx = static_cast<long long>(x1) - x0;
+        const long long dy = static_cast<long long>(y1) - y0;
+        const long long len = std::max(std::llabs(dx), std::llabs(dy));
+        const long long pieces = len / static_cast<long long>(tile_size()) + 1;
+        long long px = x0;
+        long long py = y0;
+        for (long long i = 1; i <= pieces; ++i) {
+            const long long qx = x0 + dx * i / pieces;
+            const long long qy = y0 + dy * i / pieces;
+            // Bresenham strays at most half a pixel from the ideal line, so the default
+            // padding of one covers the pieces' rounding.
+            const long long lx = std::min(px, qx) - pad;
+            const long long ly = std::min(py, qy) - pad;
+            const long long hx = std::max(px, qx) + pad + 1;
+            const long long hy = std::max(py, qy) + pad + 1;
+            mark(clamp_rect(lx, ly, hx, hy));
+            px = qx;
+            py = qy;
+        }
+    }
+
+    void mark_all() { mark({0, 0, static_cast<int>(width_), static_cast<int>(height_)}); }
+
+    // Mark every tile that is dirty in `other`, a region over a surface of the same size
+    // and tile size (such as another layer of a LayerStack).
+    void merge(const DirtyRegion &other) {
+        assert(other.tiles_x_ == tiles_x_ && other.tiles_y_ == tiles_y_ && other.shift_ == shift_ &&
+               "regions must cover surfaces of the same size");
+        if (!other.any_) return;
+        for (std::size_t i = 0; i < tiles_.size(); ++i) tiles_[i] |= other.tiles_[i];
+        any_ = true;
+    }
+
+    void clear() {
+        if (!any_) return;
+        std::fill(tiles_.begin(), tiles_.end(), std::uint8_t{0});
+        any_ = false;
+    }
+
+    // Smallest rectangle covering every dirty tile, clipped to the surface.
+    Rect bounds() const {
+        Rect box;
+        for (const Rect &r : rects()) box = unite(box, r);
+        return box;
+    }
+
+    // Dirty tiles merged into rectangles: horizontal runs of tiles per tile row, extended
+    // downwards while the rows below carry the same run. Clipped to the surface.
+    std::vector<Rect> rects() const {
+        std::vector<Rect> out;
+        if (!any_) return out;
+        std::vector<std::uint8_t> taken(tiles_.size(), 0);
+        const int ts = static_cast<int>(tile_size());
+        for (std::size_t ty = 0; ty < tiles_y_; ++ty) {
+            std::size_t tx = 0;
+            while (tx < tiles_x_) {
+                const std::size_t i = ty * tiles_x_ + tx;
+                if (!tiles_[i] || taken[i]) {
+                    ++tx;
+                    continue;
+                }
+                std::size_t run = 1;
+                while (tx + run < tiles_x_ && tiles_[i + run] && !taken[i + run]) ++run;
+                std::size_t rows = 1;
+                while (ty + rows < tiles_y_ && run_matches(tx, ty + rows, run, taken)) ++rows;
+                for (std::size_t r = 0; r < rows; ++r) {
+                    std::fill_n(taken.begin() + static_cast<std::ptrdiff_t>((ty + r) * tiles_x_ + tx), run,
+                                std::uint8_t{1});
+                }
+                Rect rect{static_cast<int>(tx) * ts, static_cast<int>(ty) * ts, static_cast<int>(run) * ts,
+                          static_cast<int>(rows) * ts};
+                out.push_back(intersect(rect, {0, 0, static_cast<int>(width_), static_cast<int>(height_)}));
+                tx += run;
+            }
+        }
+        return out;
+    }
+
+private:
+    std::size_t width_;
+    std::size_t height_;
+    unsigned shift_;
+    std::size_t tiles_x_;
+    std::size_t tiles_y_;
+    std::vector<std::uint8_t> tiles_;
+    bool any_ = false;
+
+    Rect clamp_rect(long long x0, long long y0, long long x1, long long y1) const {
+        const long long w = static_cast<long long>(width_);
+        const long long h = static_cast<long long>(height_);
+        x0 = std::max(0LL, std::min(x0, w));
+        x1 = std::max(0LL, std::min(x1, w));
+        y0 = std::max(0LL, std::min(y0, h));
+        y1 = std::max(0LL, std::min(y1, h));
+        return {static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(x1 - x0), static_cast<int>(y1 - y0)};
+    }
+
+    bool run_matches(std::size_t tx, std::size_t ty, std::size_t run, const std::vector<std::uint8_t> &taken) const {
+        const std::size_t i = ty * tiles_x_ + tx;
+        for (std::size_t k = 0; k < run; ++k) {
+            if (!tiles_[i + k] || taken[i + k]) return false;
+        }
+        return true;
+    }
+};
+
+} // namespace projectcode
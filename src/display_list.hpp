@@ -0,0 +1,157 @@
+#pragma once
+
+#include "basic_canvas.hpp"
+#include "pixel.hpp"
+#include "raster.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace projectcode {
+
+// A recorded turtle program: the primitives a turtle rasterized, already resolved to
+// pixel coordinates and colors. Commands are fixed-size and self-contained (each carries
+// its own color), so a list can be replayed into any canvas in one pass without trig,
+// delays or turtle state. clear() keeps the capacity, so re-recording reuses the buffers.
+template <class Pixel>
+class BasicDisplayList {
+public:
+    using pixel_type = Pixel;
+
+    enum class Op : std::uint8_t { line, aa_line, fill, stamp, arc, flood };
+
+    struct Command {
+        Op op;
+        FillRule rule;      // fill only
+        std::uint8_t alpha; // opacity of everything but stamps
+        Pixel color;
+        // line: x0, y0, x1, y1. aa_line: the same in 24.8 fixed point (see raster::wu_line).
+        // fill: first vertex, vertex count. stamp: x, y, radius. arc: x, y, radius, and the
+        // start angle << 16 | sweep, both in 1/64 degree (see raster::ArcAngles). flood: the
+        // seed x, y.
+        std::int32_t a;
+        std::int32_t b;
+        std::int32_t c;
+        std::int32_t d;
+    };
+
+    void reserve(std::size_t commands, std::size_t vertices = 0) {
+        commands_.reserve(commands);
+        vertices_.reserve(vertices);
+    }
+
+    void clear() {
+        commands_.clear();
+        vertices_.clear();
+        floods_ = 0;
+    }
+
+    bool empty() const { return commands_.empty(); }
+    // Flood fills read what was drawn before them, so such lists must replay in order.
+    bool has_floods() const { return floods_ != 0; }
+    std::size_t size() const { return commands_.size(); }
+    const std::vector<Command> &commands() const { return commands_; }
+    const std::vector<Point> &vertices() const { return vertices_; }
+
+    void add_line(int x0, int y0, int x1, int y1, Pixel color, std::uint8_t alpha = 255) {
+        commands_.push_back({Op::line, FillRule::even_odd, alpha, color, x0, y0, x1, y1});
+    }
+
+    // Endpoints in 24.8 fixed point, as produced by raster::to_subpixel().
+    void add_aa_line(std::int32_t fx0, std::int32_t fy0, std::int32_t fx1, std::int32_t fy1, Pixel color,
+                     std::uint8_t alpha = 255) {
+        commands_.push_back({Op::aa_line, FillRule::even_odd, alpha, color, fx0, fy0, fx1, fy1});
+    }
+
+    void add_fill(const std::vector<Point> &points, Pixel color, FillRule rule, std::uint8_t alpha = 255) {
+        commands_.push_back({Op::fill, rule, alpha, color, static_cast<std::int32_t>(vertices_.size()),
+                             static_cast<std::int32_t>(points.size()), 0, 0});
+        vertices_.insert(vertices_.end(), points.begin(), points.end());
+    }
+
+    void add_stamp(int x, int y, int radius, Pixel color) {
+        commands_.push_back({Op::stamp, FillRule::even_odd, 255, color, x, y, radius, 0});
+    }
+
+    // Arc outline with angles already quantized by raster::to_arc_angles().
+    void add_arc(int x, int y, int radius, raster::ArcAngles arc, Pixel color, std::uint8_t alpha = 255) {
+        commands_.push_back({Op::arc, FillRule::even_odd, alpha, color, x, y, radius, pack_arc(arc)});
+    }
+
+    // Bucket fill seeded at (x, y); see BasicCanvas::flood_fill.
+    void add_flood(int x, int y, Pixel color) {
+        commands_.push_back({Op::flood, FillRule::even_odd, 255, color, x, y, 0, 0});
+        ++floods_;
+    }
+
+    static std::int32_t pack_arc(raster::ArcAngles arc) { return (arc.start << 16) | arc.sweep; }
+    static raster::ArcAngles unpack_arc(std::int32_t d) { return {d >> 16, d & 0xFFFF}; }
+
+    // Draw every command into `canvas` in recording order. With scale != 1 the coordinates
+    // are scaled about the origin, so a program recorded at 800x600 fills a 1600x1200
+    // canvas at scale 2.
+    void replay(BasicCanvas<Pixel> &canvas, double scale = 1.0) const {
+        PROJECTCODE_TRACE_SCOPE("display_list", "replay");
+        std::vector<Point> scratch;
+        for (const Command &cmd : commands_) {
+            if (cmd.op == Op::fill) {
+                scratch.assign(vertices_.begin() + cmd.a, vertices_.begin() + cmd.a + cmd.b);
+                if (scale != 1.0) {
+                    for (Point &p : scratch) p = {p.x * scale, p.y * scale};
+                }
+            }
+            draw_command(canvas, cmd, scratch, scale);
+        }
+    }
+
+    // Draw a single command. `points` holds a fill's vertices, already scaled; the
+    // command's own vertex index is not used, so commands can travel without their list.
+    static void draw_command(BasicCanvas<Pixel> &canvas, const Command &cmd, const std::vector<Point> &points,
+                             double scale = 1.0) {
+        switch (cmd.op) {
+        case Op::line:
+            if (scale == 1.0) {
+                canvas.draw_line(cmd.a, cmd.b, cmd.c, cmd.d, cmd.color, cmd.alpha);
+            } else {
+                canvas.draw_line(scaled(cmd.a, scale), scaled(cmd.b, scale), scaled(cmd.c, scale),
+                                 scaled(cmd.d, scale), cmd.color, cmd.alpha);
+            }
+            break;
+        case Op::aa_line: {
+            const double k = scale / 256.0; // exact at scale 1, so replay matches live drawing
+            canvas.draw_line_aa(cmd.a * k, cmd.b * k, cmd.c * k, cmd.d * k, cmd.color, cmd.alpha);
+            break;
+        }
+        case Op::fill:
+            canvas.fill_polygon(points, cmd.color, cmd.rule, cmd.alpha);
+            break;
+        case Op::stamp:
+            canvas.fill_circle(scaled(cmd.a, scale), scaled(cmd.b, scale), scaled(cmd.c, scale), cmd.color);
+            break;
+        case Op::arc: {
+            const raster::ArcAngles arc = unpack_arc(cmd.d);
+            canvas.draw_arc(scaled(cmd.a, scale), scaled(cmd.b, scale), scaled(cmd.c, scale), arc.start / 64.0,
+                            arc.sweep / 64.0, cmd.color, cmd.alpha);
+            break;
+        }
+        case Op::flood:
+            canvas.flood_fill(scaled(cmd.a, scale), scaled(cmd.b, scale), cmd.color);
+            break;
+        }
+    }
+
+private:
+    std::vector<Command> commands_;
+    std::vector<Point> vertices_;
+    std::size_t floods_ = 0;
+
+    static int scaled(std::int32_t v, double scale) {
+        return scale == 1.0 ? v : static_cast<int>(std::round(v * scale));
+    }
+};
+
+using DisplayList = BasicDisplayList<Color>;
+
+} // namespace projectcode
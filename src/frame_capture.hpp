@@ -0,0 +1,206 @@
+#pragma once
+
+#include "basic_canvas.hpp"
+#include "canvas_rgb.hpp"
+#include "image_writer.hpp"
+#include "turtle_rgb.hpp"
+#include "virtual_clock.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace projectcode {
+
+// Streams canvas snapshots as a YUV4MPEG2 (.y4m) video: 4:2:0 full-range BT.601
+// (C420jpeg), which ffmpeg and most players read directly. Every frame must have the
+// size of the first one.
+class Y4MWriter {
+public:
+    Y4MWriter(const std::string &path, unsigned fps) : out_(path, std::ios::binary), fps_(fps ? fps : 30) {}
+
+    bool is_open() const { return static_cast<bool>(out_); }
+    std::uint64_t frames() const { return frames_; }
+
+    template <class Pixel>
+    bool write_frame(const BasicCanvas<Pixel> &canvas) {
+        if (!out_) return false;
+        PROJECTCODE_TRACE_SCOPE("capture", "y4m_frame");
+        const std::size_t w = canvas.width();
+        const std::size_t h = canvas.height();
+        if (frames_ == 0) {
+            width_ = w;
+            height_ = h;
+            out_ << "YUV4MPEG2 W" << w << " H" << h << " F" << fps_ << ":1 Ip A1:1 C420jpeg\n";
+        } else if (w != width_ || h != height_) {
+            return false;
+        }
+
+        const std::size_t cw = (w + 1) / 2;
+        const std::size_t ch = (h + 1) / 2;
+        planes_.resize(w * h + 2 * cw * ch);
+        rgb_.resize(w * 6);
+        std::uint8_t *luma = planes_.data();
+        std::uint8_t *cb = luma + w * h;
+        std::uint8_t *cr = cb + cw * ch;
+        std::uint8_t *top = rgb_.data();
+        std::uint8_t *bottom = top + w * 3;
+
+        // Two rows at a time: both get luma, and each 2x2 block's average gets chroma.
+        for (std::size_t cy = 0; cy < ch; ++cy) {
+            const std::size_t y0 = cy * 2;
+            const std::size_t y1 = std::min(y0 + 1, h - 1);
+            detail::pixels_to_rgb24(canvas.row(y0), top, w);
+            detail::pixels_to_rgb24(canvas.row(y1), bottom, w);
+            for (std::size_t x = 0; x < w; ++x) {
+                luma[y0 * w + x] = y_of(top + x * 3);
+                luma[y1 * w + x] = y_of(bottom + x * 3);
+            }
+            for (std::size_t cx = 0; cx < cw; ++cx) {
+                const std::size_t x0 = cx * 2 * 3;
+                const std::size_t x1 = std::min(cx * 2 + 1, w - 1) * 3;
+                int avg[3];
+                for (int c = 0; c < 3; ++c) avg[c] = (top[x0 + c] + top[x1 + c] + bottom[x0 + c] + bottom[x1 + c] + 2) >> 2;
+                cb[cy * cw + cx] = clamp_u8((-11059 * avg[0] - 21709 * avg[1] + 32768 * avg[2] + 8421376) >> 16);
+                cr[cy * cw + cx] = clamp_u8((32768 * avg[0] - 27439 * avg[1] - 5329 * avg[2] + 8421376) >> 16);
+            }
+        }
+
+        out_ << "FRAME\n";
+        out_.write(reinterpret_cast<const char *>(planes_.data()), static_cast<std::streamsize>(planes_.size()));
+        ++frames_;
+        return static_cast<bool>(out_);
+    }
+
+private:
+    std::ofstream out_;
+    unsigned fps_;
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+    std::uint64_t frames_ = 0;
+    std::vector<std::uint8_t> planes_;
+    std::vector<std::uint8_t> rgb_;
+
+    static std::uint8_t clamp_u8(int v) { return static_cast<std::uint8_t>(std::clamp(v, 0, 255)); }
+
+    // 16.16 fixed-point BT.601 weights, summing to exactly 1.
+    static std::uint8_t y_of(const std::uint8_t *p) {
+        return static_cast<std::uint8_t>((19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768) >> 16);
+    }
+};
+
+// Delta-encoded raw RGB frames for lossless capture. Layout, little-endian:
+//   header: "PCDELTA1", u32 width, u32 height, u32 fps
+//   frame:  u32 rect count, then per rect u32 x, y, w, h and w * h packed RGB pixels
+// The first frame is the whole canvas; later ones hold only the canvas's dirty
+// rectangles, so an unchanged frame is four bytes. Writing a frame clears the canvas's
+// dirty state: the writer must be the only consumer of it.
+class DeltaRawWriter {
+public:
+    DeltaRawWriter(const std::string &path, unsigned fps) : out_(path, std::ios::binary), fps_(fps) {}
+
+    bool is_open() const { return static_cast<bool>(out_); }
+    std::uint64_t frames() const { return frames_; }
+
+    template <class Pixel>
+    bool write_frame(BasicCanvas<Pixel> &canvas) {
+        if (!out_) return false;
+        PROJECTCODE_TRACE_SCOPE("capture", "delta_frame");
+        if (frames_ == 0) {
+            width_ = canvas.width();
+            height_ = canvas.height();
+            std::uint8_t header[20];
+            std::memcpy(header, "PCDELTA1", 8);
+            detail::store_u32le(header + 8, static_cast<std::uint32_t>(width_));
+            detail::store_u32le(header + 12, static_cast<std::uint32_t>(height_));
+            detail::store_u32le(header + 16, fps_);
+            out_.write(reinterpret_cast<const char *>(header), sizeof header);
+            rects_.assign(1, canvas.bounds());
+        } else if (canvas.width() != width_ || canvas.height() != height_) {
+            return false;
+        } else {
+            rects_ = canvas.dirty_rects();
+        }
+
+        put_u32(static_cast<std::uint32_t>(rects_.size()));
+        for (const Rect &r : rects_) {
+            put_u32(static_cast<std::uint32_t>(r.x));
+            put_u32(static_cast<std::uint32_t>(r.y));
+            put_u32(static_cast<std::uint32_t>(r.w));
+            put_u32(static_cast<std::uint32_t>(r.h));
+            row_.resize(static_cast<std::size_t>(r.w) * 3);
+            for (int y = r.y; y < r.bottom(); ++y) {
+                detail::pixels_to_rgb24(canvas.row(static_cast<std::size_t>(y)) + r.x, row_.data(),
+                                        static_cast<std::size_t>(r.w));
+                out_.write(reinterpret_cast<const char *>(row_.data()), static_cast<std::streamsize>(row_.size()));
+            }
+        }
+        canvas.clear_dirty();
+        ++frames_;
+        return static_cast<bool>(out_);
+    }
+
+private:
+    std::ofstream out_;
+    std::uint32_t fps_;
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+    std::uint64_t frames_ = 0;
+    std::vector<Rect> rects_;
+    std::vector<std::uint8_t> row_;
+
+    void put_u32(std::uint32_t v) {
+        std::uint8_t b[4];
+        detail::store_u32le(b, v);
+        out_.write(reinterpret_cast<const char *>(b), 4);
+    }
+};
+
+struct HeadlessOptions {
+    int width = 800;
+    int height = 600;
+    Color background{240, 248, 255};
+    unsigned fps = 30; // 0: no timeline, capture on flush() instead
+};
+
+// Run window-style draw code without a window system. draw_fn has run_window's
+// signature. Turtle delays advance a VirtualClock instead of sleeping, and
+// sink.write_frame(canvas) is called for the starting canvas and then at every frame
+// tick, so the capture plays back at the speed the program would have run on screen.
+// With fps == 0 each flush() that changed the canvas writes a frame instead. Changes
+// made after the last capture are written as a final frame. Returns the frame count.
+template <class Sink, class DrawFn>
+std::uint64_t run_headless(const HeadlessOptions &opts, Sink &sink, DrawFn draw_fn) {
+    CanvasRGB canvas(static_cast<std::size_t>(opts.width), static_cast<std::size_t>(opts.height), opts.background);
+    TurtleRGB turtle(canvas, 0, 0);
+    VirtualClock clock(opts.fps);
+    turtle.set_clock(&clock);
+
+    std::uint64_t frames = 0;
+    auto capture = [&]() {
+        sink.write_frame(canvas);
+        canvas.clear_dirty();
+        ++frames;
+    };
+    capture();
+    clock.on_tick([&](std::uint64_t) { capture(); });
+
+    std::function<bool()> flush = [&]() {
+        turtle.finish_path();
+        if (opts.fps == 0 && !canvas.dirty().empty()) capture();
+        return true;
+    };
+
+    draw_fn(canvas, turtle, flush);
+    turtle.finish_path();
+
+    if (!canvas.dirty().empty()) capture();
+    return frames;
+}
+
+} // namespace projectcode
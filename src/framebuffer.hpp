@@ -0,0 +1,61 @@
+#pragma once
+
+#include "basic_canvas.hpp"
+#include "pixel_kernels.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace projectcode {
+
+namespace detail {
+// Persistent DIB-style copy of a canvas, as presented by the Win32 window: 32-bit BGRA
+// for the 32-bit canvas formats (BGRA32 rows are copied as is), 24-bit BGR otherwise.
+// Rows are stored bottom-up and padded to 4 bytes, the DIB layout whose source
+// rectangles StretchDIBits addresses unambiguously. Kept free of Windows headers so it
+// can be built and measured anywhere.
+struct Framebuffer {
+    std::vector<std::uint8_t> bytes;
+    std::size_t row_padded = 0;
+    std::size_t pixel_bytes = 3;
+    int width = 0;
+    int height = 0;
+};
+
+// Convert the canvas pixels inside `r` to BGR(A) in the framebuffer.
+template <class Pixel>
+void update_framebuffer(Framebuffer &fb, const BasicCanvas<Pixel> &canvas, const Rect &r) {
+    const Rect c = intersect(r, canvas.bounds());
+    for (int y = c.y; y < c.bottom(); ++y) {
+        const Pixel *src = canvas.row(static_cast<std::size_t>(y)) + c.x;
+        std::uint8_t *dst = fb.bytes.data() + static_cast<std::size_t>(fb.height - 1 - y) * fb.row_padded +
+                            static_cast<std::size_t>(c.x) * fb.pixel_bytes;
+        if constexpr (std::is_same_v<Pixel, BGRA32>) {
+            std::memcpy(dst, src, static_cast<std::size_t>(c.w) * 4);
+        } else if constexpr (std::is_same_v<Pixel, RGBA32>) {
+            kernels::swap_rb32(reinterpret_cast<const std::uint8_t *>(src), dst, static_cast<std::size_t>(c.w));
+        } else {
+            pixels_to_bgr24(src, dst, static_cast<std::size_t>(c.w));
+        }
+    }
+}
+
+template <class Pixel>
+Framebuffer make_framebuffer(const BasicCanvas<Pixel> &canvas) {
+    Framebuffer fb;
+    fb.width = static_cast<int>(canvas.width());
+    fb.height = static_cast<int>(canvas.height());
+    fb.pixel_bytes = sizeof(Pixel) == 4 ? 4 : 3;
+    const std::size_t row_stride = static_cast<std::size_t>(fb.width) * fb.pixel_bytes;
+    fb.row_padded = (row_stride + 3u) & ~std::size_t{3}; // 4-byte alignment
+    fb.bytes.resize(fb.row_padded * static_cast<std::size_t>(fb.height), 0);
+
+    update_framebuffer(fb, canvas, canvas.bounds());
+    return fb;
+}
+} // namespace detail
+
+} // namespace projectcode
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "image_reader.hpp"
+#include "instrument.hpp"
+#include "pixel_kernels.hpp"
+#include "raster.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace projectcode {
+
+struct CompareOptions {
+    unsigned tolerance = 0; // channel deltas up to this count as equal
+    // Pixels allowed to differ; by default none, so only an exact match (within the
+    // tolerance) passes. The comparison stops as soon as more differ, with statistics for
+    // the rows compared so far; use SIZE_MAX to always get them for the whole image.
+    std::size_t max_differing = 0;
+};
+
+struct ImageDiff {
+    bool same_size = true;
+    bool exceeded = false;     // stopped early: more than max_differing pixels differ
+    std::size_t differing = 0; // pixels with a channel delta above the tolerance
+    Rect bounds;               // bounding box of those pixels
+    unsigned max_delta = 0;    // largest channel delta
+    double psnr = std::numeric_limits<double>::infinity(); // in dB over all channels; infinite if identical
+
+    // Within the thresholds of the comparison: the sizes match and no more than
+    // max_differing pixels differ.
+    bool passed() const { return same_size && !exceeded; }
+};
+
+namespace detail {
+
+// Row y of `view` as packed 3-byte pixels in RGB order, or in BGR order when `bgr`;
+// converted into `scratch` unless it is stored that way already.
+inline const std::uint8_t *row24(const ImageView &view, std::size_t y, bool bgr, std::vector<std::uint8_t> &scratch) {
+    const std::uint8_t *src = view.row(y);
+    switch (view.layout) {
+    case PixelLayout::rgb24:
+        if (!bgr) return src;
+        kernels::swap_rb24(src, scratch.data(), view.width);
+        break;
+    case PixelLayout::bgr24:
+        if (bgr) return src;
+        kernels::swap_rb24(src, scratch.data(), view.width);
+        break;
+    case PixelLayout::rgba32:
+        kernels::pack24(src, scratch.data(), view.width, bgr);
+        break;
+    case PixelLayout::bgra32:
+        kernels::pack24(src, scratch.data(), view.width, !bgr);
+        break;
+    }
+    return scratch.data();
+}
+
+} // namespace detail
+
+// Compare two images pixel by pixel, ignoring alpha. Identical rows are skipped with a
+// memcmp; the others go through kernels::diff24, which counts differing pixels and sums
+// squared deltas a vector at a time. Rows are read where they lie whenever both images
+// store the same 3-byte channel order (a PPM against a CanvasRGB, two BMPs), so a mapped
+// golden file is compared without being decoded.
+inline ImageDiff compare_images(const ImageView &a, const ImageView &b, const CompareOptions &options = {}) {
+    PROJECTCODE_TRACE_SCOPE("image", "compare");
+    ImageDiff diff;
+    if (a.width != b.width || a.height != b.height) {
+        diff.same_size = false;
+        diff.exceeded = true;
+        diff.psnr = 0.0;
+        return diff;
+    }
+    // Compare in BMP order when both sides are stored that way, otherwise in RGB order.
+    const bool bgr = (a.layout == PixelLayout::bgr24 || a.layout == PixelLayout::bgra32) &&
+                     (b.layout == PixelLayout::bgr24 || b.layout == PixelLayout::bgra32);
+    std::vector<std::uint8_t> scratch_a(a.layout == (bgr ? PixelLayout::bgr24 : PixelLayout::rgb24) ? 0 : a.width * 3);
+    std::vector<std::uint8_t> scratch_b(b.layout == (bgr ? PixelLayout::bgr24 : PixelLayout::rgb24) ? 0 : b.width * 3);
+    const std::size_t row_bytes = a.width * 3;
+    std::uint64_t sum_sq = 0;
+    std::size_t x0 = a.width, x1 = 0, y0 = a.height, y1 = 0;
+    for (std::size_t y = 0; y < a.height; ++y) {
+        const std::uint8_t *ra = detail::row24(a, y, bgr, scratch_a);
+        const std::uint8_t *rb = detail::row24(b, y, bgr, scratch_b);
+        if (std::memcmp(ra, rb, row_bytes) == 0) continue;
+        const kernels::Diff24 d = kernels::diff24(ra, rb, a.width, options.tolerance);
+        sum_sq += d.sum_sq;
+        diff.max_delta = std::max(diff.max_delta, d.max_delta);
+        if (d.differing) {
+            diff.differing += d.differing;
+            x0 = std::min(x0, d.first);
+            x1 = std::max(x1, d.last);
+            y0 = std::min(y0, y);
+            y1 = y;
+            if (diff.differing > options.max_differing) {
+                diff.exceeded = true;
+                break;
+            }
+        }
+    }
+    if (diff.differing) {
+        diff.bounds = {static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(x1 - x0 + 1),
+                       static_cast<int>(y1 - y0 + 1)};
+    }
+    if (sum_sq) {
+        const double mse = static_cast<double>(sum_sq) / (static_cast<double>(a.width) * a.height * 3.0);
+        diff.psnr = 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+    return diff;
+}
+
+} // namespace projectcode
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace projectcode {
+
+// How images are read from disk.
+enum class ReadMode {
+    buffered, // the file is read into memory in one go
+    mapped,   // the file is mapped read-only and rows are used where they lie, without a copy
+};
+
+enum class ImageFormat { ppm, bmp };
+
+// Byte layout of one pixel in an image's rows.
+enum class PixelLayout { rgb24, bgr24, rgba32, bgra32 };
+
+constexpr std::size_t layout_bytes(PixelLayout layout) {
+    return layout == PixelLayout::rgb24 || layout == PixelLayout::bgr24 ? 3 : 4;
+}
+
+// Rows of pixels somewhere in memory: `pitch` bytes apart, negative for images stored
+// bottom-up. Used to compare canvases and image files without converting them first.
+struct ImageView {
+    const std::uint8_t *origin = nullptr; // top row
+    std::ptrdiff_t pitch = 0;
+    std::size_t width = 0;
+    std::size_t height = 0;
+    PixelLayout layout = PixelLayout::rgb24;
+
+    const std::uint8_t *row(std::size_t y) const { return origin + static_cast<std::ptrdiff_t>(y) * pitch; }
+};
+
+namespace detail {
+
+inline std::uint32_t load_u16le(const std::uint8_t *p) { return p[0] | static_cast<std::uint32_t>(p[1]) << 8; }
+
+inline std::uint32_t load_u32le(const std::uint8_t *p) { return load_u16le(p) | load_u16le(p + 2) << 16; }
+
+// Next whitespace-separated decimal in a PPM header, skipping # comments. Returns false
+// at the end of the data or on anything else.
+inline bool read_ppm_number(const std::uint8_t *data, std::size_t size, std::size_t &pos, std::size_t &value) {
+    for (;;) {
+        while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n')) ++pos;
+        if (pos < size && data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') ++pos;
+            continue;
+        }
+        break;
+    }
+    if (pos >= size || data[pos] < '0' || data[pos] > '9') return false;
+    value = 0;
+    for (; pos < size && data[pos] >= '0' && data[pos] <= '9'; ++pos) {
+        if (value > (std::numeric_limits<std::uint32_t>::max() - 9) / 10) return false;
+        value = value * 10 + static_cast<std::size_t>(data[pos] - '0');
+    }
+    return true;
+}
+
+// Locate the pixels of a binary PPM (P6, maxval 255).
+inline bool parse_ppm(const std::uint8_t *data, std::size_t size, ImageView &view) {
+    if (size < 2 || data[0] != 'P' || data[1] != '6') return false;
+    std::size_t pos = 2, w = 0, h = 0, maxval = 0;
+    if (!read_ppm_number(data, size, pos, w) || !read_ppm_number(data, size, pos, h) ||
+        !read_ppm_number(data, size, pos, maxval)) {
+        return false;
+    }
+    if (w == 0 || h == 0 || maxval != 255 || pos >= size) return false;
+    ++pos; // the single whitespace byte before the pixels
+    if ((size - pos) / 3 / w < h) return false;
+    view = {data + pos, static_cast<std::ptrdiff_t>(w * 3), w, h, PixelLayout::rgb24};
+    return true;
+}
+
+// Locate the pixels of an uncompressed 24-bit or 32-bit BMP, bottom-up or top-down.
+// 32-bit files may use BI_BITFIELDS with the usual BGRA masks.
+inline bool parse_bmp(const std::uint8_t *data, std::size_t size, ImageView &view) {
+    if (size < 54 || data[0] != 'B' || data[1] != 'M') return false;
+    const std::uint32_t offset = load_u32le(data + 10);
+    const std::uint32_t info_size = load_u32le(data + 14);
+    const auto w = static_cast<std::int32_t>(load_u32le(data + 18));
+    const auto h = static_cast<std::int32_t>(load_u32le(data + 22));
+    const std::uint32_t bits = load_u16le(data + 28);
+    const std::uint32_t compression = load_u32le(data + 30);
+    if (info_size < 40 || w <= 0 || h == 0 || h == std::numeric_limits<std::int32_t>::min()) return false;
+    if (bits != 24 && bits != 32) return false;
+    if (compression == 3) { // BI_BITFIELDS: the masks follow the 40-byte header in every version
+        if (bits != 32 || size < 66 || load_u32le(data + 54) != 0x00FF0000u || load_u32le(data + 58) != 0x0000FF00u ||
+            load_u32le(data + 62) != 0x000000FFu) {
+            return false;
+        }
+    } else if (compression != 0) {
+        return false;
+    }
+    const std::size_t width = static_cast<std::size_t>(w);
+    const std::size_t height = static_cast<std::size_t>(h < 0 ? -static_cast<std::int64_t>(h) : h);
+    const std::size_t row_bytes = (width * (bits / 8) + 3u) & ~std::size_t{3};
+    if (offset > size || (size - offset) / row_bytes < height) return false;
+    const std::uint8_t *pixels = data + offset;
+    const auto pitch = static_cast<std::ptrdiff_t>(row_bytes);
+    if (h > 0) { // bottom-up
+        view = {pixels + (height - 1) * row_bytes, -pitch, width, height,
+                bits == 24 ? PixelLayout::bgr24 : PixelLayout::bgra32};
+    } else {
+        view = {pixels, pitch, width, height, bits == 24 ? PixelLayout::bgr24 : PixelLayout::bgra32};
+    }
+    return true;
+}
+
+} // namespace detail
+
+// A PPM (P6) or uncompressed BMP opened for reading, such as a golden image. Mapped files
+// are not copied: view() points into the mapping. is_open() reports whether the file
+// could be read and decoded; the memory is released on destruction.
+class ImageFile {
+public:
+    static ImageFile open(const std::string &path, ReadMode mode = ReadMode::mapped) {
+        ImageFile f;
+        const std::uint8_t *data = nullptr;
+        std::size_t size = 0;
+        if (mode == ReadMode::mapped) {
+            f.map_ = MappedFile::open_read(path);
+            data = f.map_.data();
+            size = f.map_.size();
+        } else {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) return f;
+            const std::streamoff length = in.tellg();
+            if (length <= 0) return f;
+            f.bytes_.resize(static_cast<std::size_t>(length));
+            in.seekg(0);
+            if (!in.read(reinterpret_cast<char *>(f.bytes_.data()), length)) return f;
+            data = f.bytes_.data();
+            size = f.bytes_.size();
+        }
+        if (!data) return f;
+        if (detail::parse_ppm(data, size, f.view_)) {
+            f.format_ = ImageFormat::ppm;
+        } else if (detail::parse_bmp(data, size, f.view_)) {
+            f.format_ = ImageFormat::bmp;
+        } else {
+            f.view_ = ImageView{};
+        }
+        return f;
+    }
+
+    bool is_open() const { return view_.origin != nullptr; }
+    ImageFormat format() const { return format_; }
+    std::size_t width() const { return view_.width; }
+    std::size_t height() const { return view_.height; }
+    const ImageView &view() const { return view_; }
+
+private:
+    MappedFile map_;
+    std::vector<std::uint8_t> bytes_;
+    ImageView view_;
+    ImageFormat format_ = ImageFormat::ppm;
+};
+
+} // namespace projectcode
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace projectcode {
+
+// How exporters put bytes on disk.
+enum class WriteMode {
+    buffered, // rows are encoded into a reusable block buffer and written in large chunks
+    mapped,   // the file is created with its final size reserved, mapped, and rows are encoded in place
+};
+
+namespace detail {
+
+inline void store_u16le(std::uint8_t *p, std::uint16_t v) {
+    p[0] = static_cast<std::uint8_t>(v & 0xFF);
+    p[1] = static_cast<std::uint8_t>((v >> 8) & 0xFF);
+}
+
+inline void store_u32le(std::uint8_t *p, std::uint32_t v) {
+    store_u16le(p, static_cast<std::uint16_t>(v & 0xFFFF));
+    store_u16le(p + 2, static_cast<std::uint16_t>(v >> 16));
+}
+
+constexpr std::size_t bmp_header_size = 54; // 14-byte file header + 40-byte info header
+
+// Header of an uncompressed, bottom-up 24-bit BMP. Sizes are 32-bit fields, so images
+// whose pixel data exceeds 4 GiB cannot be stored; returns false for those instead of
+// writing a truncated size.
+inline bool make_bmp_header(std::uint8_t *header, std::size_t width, std::size_t height) {
+    const std::uint64_t row_padded = (static_cast<std::uint64_t>(width) * 3 + 3u) & ~std::uint64_t{3};
+    const std::uint64_t pixel_data_size = row_padded * height;
+    if (width == 0 || height == 0 || width > 0x7FFFFFFFu || height > 0x7FFFFFFFu ||
+        pixel_data_size + bmp_header_size > 0xFFFFFFFFu) {
+        return false;
+    }
+    std::memset(header, 0, bmp_header_size);
+    // BITMAPFILEHEADER
+    header[0] = 'B';
+    header[1] = 'M';
+    store_u32le(header + 2, static_cast<std::uint32_t>(bmp_header_size + pixel_data_size));
+    store_u32le(header + 10, static_cast<std::uint32_t>(bmp_header_size)); // after two reserved u16s
+
+    // BITMAPINFOHEADER
+    store_u32le(header + 14, 40); // info header size
+    store_u32le(header + 18, static_cast<std::uint32_t>(width));
+    store_u32le(header + 22, static_cast<std::uint32_t>(height));
+    store_u16le(header + 26, 1);  // planes
+    store_u16le(header + 28, 24); // bpp
+    store_u32le(header + 30, 0);  // compression = BI_RGB
+    store_u32le(header + 34, static_cast<std::uint32_t>(pixel_data_size));
+    store_u32le(header + 38, 2835); // x ppm (~72 DPI)
+    store_u32le(header + 42, 2835); // y ppm
+    // colors used / important colors stay 0
+    return true;
+}
+
+// Write `header` followed by `rows` rows of `row_bytes` bytes each; encode(i, dst) fills
+// row i. Buffered mode batches rows into one thread-local block buffer that is reused by
+// every export on the thread; mapped mode encodes straight into the file's pages and
+// syncs them before returning.
+template <class EncodeRow>
+bool write_rows(const std::string &path, const std::uint8_t *header, std::size_t header_size, std::size_t row_bytes,
+                std::size_t rows, EncodeRow encode, WriteMode mode) {
+    if (mode == WriteMode::mapped) {
+        MappedFile file = MappedFile::create(path, header_size + row_bytes * rows);
+        if (!file.is_open()) return false;
+        std::uint8_t *out = file.data();
+        std::memcpy(out, header, header_size);
+        out += header_size;
+        for (std::size_t i = 0; i < rows; ++i, out += row_bytes) encode(i, out);
+        return file.flush();
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char *>(header), static_cast<std::streamsize>(header_size));
+
+    constexpr std::size_t block_bytes = std::size_t{1} << 20;
+    const std::size_t rows_per_block = std::max<std::size_t>(1, block_bytes / std::max<std::size_t>(row_bytes, 1));
+    thread_local std::vector<std::uint8_t> buffer;
+    const std::size_t needed = rows_per_block * row_bytes;
+    if (buffer.size() < needed) buffer.resize(needed);
+
+    for (std::size_t i = 0; i < rows;) {
+        const std::size_t n = std::min(rows_per_block, rows - i);
+        for (std::size_t k = 0; k < n; ++k) encode(i + k, buffer.data() + k * row_bytes);
+        out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(n * row_bytes));
+        i += n;
+    }
+    return static_cast<bool>(out);
+}
+
+} // namespace detail
+
+} // namespace projectcode
@@ -0,0 +1,284 @@
+#pragma once
+
+// Optional instrumentation: per-canvas and per-turtle counters plus scoped timers that
+// feed a process-wide trace, exportable as Chrome trace-event JSON (chrome://tracing,
+// Perfetto) or as a summary table. Build with PROJECTCODE_INSTRUMENT=1 to enable it; by
+// default every hook compiles to nothing, counters hold no data and the trace is empty.
+
+#ifndef PROJECTCODE_INSTRUMENT
+#define PROJECTCODE_INSTRUMENT 0
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+
+#if PROJECTCODE_INSTRUMENT
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#endif
+
+#define PROJECTCODE_CONCAT_INNER(a, b) a##b
+#define PROJECTCODE_CONCAT(a, b) PROJECTCODE_CONCAT_INNER(a, b)
+
+// Time the enclosing block as a trace event. `category` and `name` must be string
+// literals (or otherwise outlive the trace).
+#if PROJECTCODE_INSTRUMENT
+#define PROJECTCODE_TRACE_SCOPE(category, name)                                                                        \
+    ::projectcode::instrument::Scope PROJECTCODE_CONCAT(projectcode_trace_scope_, __LINE__)(category, name)
+#else
+#define PROJECTCODE_TRACE_SCOPE(category, name) ((void)0)
+#endif
+
+namespace projectcode {
+
+namespace instrument {
+
+constexpr bool enabled = PROJECTCODE_INSTRUMENT != 0;
+
+enum class Counter : unsigned {
+    segments,       // lines drawn
+    pixels_written, // pixels stored or blended
+    pixels_clipped, // line and disc pixels that fell outside the canvas (estimated for anti-aliased lines)
+    fills,          // polygons filled
+    stamps,         // discs stamped
+    bytes_exported, // pixel bytes handed to exporters (before any compression)
+};
+
+constexpr std::size_t counter_count = 6;
+
+inline const char *counter_name(Counter c) {
+    static const char *const names[counter_count] = {"segments", "pixels_written", "pixels_clipped",
+                                                     "fills",    "stamps",         "bytes_exported"};
+    return names[static_cast<unsigned>(c)];
+}
+
+// A set of event counters. Without instrumentation it is empty and every call vanishes.
+class Counters {
+public:
+    void add(Counter c, std::uint64_t n = 1) {
+#if PROJECTCODE_INSTRUMENT
+        values_[static_cast<unsigned>(c)] += n;
+#else
+        (void)c;
+        (void)n;
+#endif
+    }
+
+    std::uint64_t get(Counter c) const {
+#if PROJECTCODE_INSTRUMENT
+        return values_[static_cast<unsigned>(c)];
+#else
+        (void)c;
+        return 0;
+#endif
+    }
+
+    void reset() {
+#if PROJECTCODE_INSTRUMENT
+        values_.fill(0);
+#endif
+    }
+
+    Counters &operator+=(const Counters &other) {
+#if PROJECTCODE_INSTRUMENT
+        for (std::size_t i = 0; i < counter_count; ++i) values_[i] += other.values_[i];
+#else
+        (void)other;
+#endif
+        return *this;
+    }
+
+private:
+#if PROJECTCODE_INSTRUMENT
+    std::array<std::uint64_t, counter_count> values_{};
+#endif
+};
+
+inline void write_counters(std::ostream &os, const Counters &counters, const std::string &label = "counters") {
+    os << label << '\n';
+    for (std::size_t i = 0; i < counter_count; ++i) {
+        const Counter c = static_cast<Counter>(i);
+        os << "  " << std::left << std::setw(16) << counter_name(c) << std::right << std::setw(16) << counters.get(c)
+           << '\n';
+    }
+}
+
+#if PROJECTCODE_INSTRUMENT
+
+struct TraceEvent {
+    const char *category;
+    const char *name;
+    std::uint64_t start_ns; // since the trace epoch
+    std::uint64_t duration_ns;
+    std::uint32_t thread;
+};
+
+// Process-wide event log. Events are appended under a mutex; instrumented builds trade
+// a little speed for seeing where time goes.
+class Trace {
+public:
+    static Trace &global() {
+        static Trace trace;
+        return trace;
+    }
+
+    std::uint64_t now_ns() const {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count());
+    }
+
+    void record(const char *category, const char *name, std::uint64_t start_ns, std::uint64_t end_ns) {
+        const std::uint32_t thread = thread_index();
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.push_back({category, name, start_ns, end_ns - start_ns, thread});
+    }
+
+    // A snapshot of `counters`, shown as a counter track in trace viewers.
+    void sample(const char *name, const Counters &counters) {
+        const std::uint64_t ts = now_ns();
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples_.push_back({name, ts, counters});
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.clear();
+        samples_.clear();
+    }
+
+    std::vector<TraceEvent> events() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_;
+    }
+
+    void write_chrome_json(std::ostream &os) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto sep = [&]() {
+            if (!first) os << ",\n";
+            first = false;
+        };
+        os << std::fixed << std::setprecision(3);
+        for (const TraceEvent &e : events_) {
+            sep();
+            os << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\",\"ts\":"
+               << static_cast<double>(e.start_ns) / 1000.0 << ",\"dur\":" << static_cast<double>(e.duration_ns) / 1000.0
+               << ",\"pid\":1,\"tid\":" << e.thread << "}";
+        }
+        for (const Sample &s : samples_) {
+            sep();
+            os << "{\"name\":\"" << s.name << "\",\"ph\":\"C\",\"ts\":" << static_cast<double>(s.ts_ns) / 1000.0
+               << ",\"pid\":1,\"args\":{";
+            for (std::size_t i = 0; i < counter_count; ++i) {
+                const Counter c = static_cast<Counter>(i);
+                os << (i ? "," : "") << '"' << counter_name(c) << "\":" << s.counters.get(c);
+            }
+            os << "}}";
+        }
+        os << "\n]}\n";
+        os.unsetf(std::ios::floatfield);
+    }
+
+private:
+    struct Sample {
+        const char *name;
+        std::uint64_t ts_ns;
+        Counters counters;
+    };
+
+    std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+    mutable std::mutex mutex_;
+    std::vector<TraceEvent> events_;
+    std::vector<Sample> samples_;
+
+    static std::uint32_t thread_index() {
+        static std::atomic<std::uint32_t> next{1};
+        thread_local const std::uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+};
+
+// Records the lifetime of a block as one trace event.
+class Scope {
+public:
+    Scope(const char *category, const char *name)
+        : category_(category), name_(name), start_(Trace::global().now_ns()) {}
+    ~Scope() { Trace::global().record(category_, name_, start_, Trace::global().now_ns()); }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *category_;
+    const char *name_;
+    std::uint64_t start_;
+};
+
+#endif // PROJECTCODE_INSTRUMENT
+
+// Record a snapshot of `counters` in the trace.
+inline void sample(const char *name, const Counters &counters) {
+#if PROJECTCODE_INSTRUMENT
+    Trace::global().sample(name, counters);
+#else
+    (void)name;
+    (void)counters;
+#endif
+}
+
+// Write the global trace as Chrome trace-event JSON. Without instrumentation the file
+// holds an empty trace.
+inline bool write_chrome_trace(const std::string &path) {
+    std::ofstream out(path);
+    if (!out) return false;
+#if PROJECTCODE_INSTRUMENT
+    Trace::global().write_chrome_json(out);
+#else
+    out << "{\"traceEvents\":[]}\n";
+#endif
+    return static_cast<bool>(out);
+}
+
+// Per-scope totals of the global trace: calls, total, mean and longest duration.
+inline void write_summary(std::ostream &os) {
+    struct Row {
+        std::uint64_t calls = 0;
+        std::uint64_t total_ns = 0;
+        std::uint64_t max_ns = 0;
+    };
+    std::map<std::string, Row> rows;
+#if PROJECTCODE_INSTRUMENT
+    for (const TraceEvent &e : Trace::global().events()) {
+        Row &r = rows[std::string(e.category) + "/" + e.name];
+        ++r.calls;
+        r.total_ns += e.duration_ns;
+        r.max_ns = std::max(r.max_ns, e.duration_ns);
+    }
+#endif
+    os << std::left << std::setw(28) << "scope" << std::right << std::setw(10) << "calls" << std::setw(14)
+       << "total ms" << std::setw(12) << "mean us" << std::setw(12) << "max us" << '\n';
+    os << std::fixed << std::setprecision(3);
+    for (const auto &entry : rows) {
+        const Row &r = entry.second;
+        os << std::left << std::setw(28) << entry.first << std::right << std::setw(10) << r.calls << std::setw(14)
+           << static_cast<double>(r.total_ns) / 1e6 << std::setw(12)
+           << static_cast<double>(r.total_ns) / 1e3 / static_cast<double>(r.calls) << std::setw(12)
+           << static_cast<double>(r.max_ns) / 1e3 << '\n';
+    }
+    os.unsetf(std::ios::floatfield);
+    if (!enabled) os << "(instrumentation compiled out; build with PROJECTCODE_INSTRUMENT=1)\n";
+}
+
+} // namespace instrument
+
+} // namespace projectcode
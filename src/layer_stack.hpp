@@ -0,0 +1,279 @@
+#pragma once
+
+#include "canvas_rgb.hpp"
+#include "dirty_region.hpp"
+#include "instrument.hpp"
+#include "pixel_kernels.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace projectcode {
+
+// How a layer's pixels combine with what lies beneath them.
+enum class BlendMode {
+    normal,   // source-over
+    multiply, // darkens: backdrop * source
+    screen,   // lightens: 1 - (1 - backdrop) * (1 - source)
+    add,      // backdrop + source, saturating
+};
+
+namespace detail {
+
+// Composite n premultiplied layer pixels at `opacity` onto an opaque 32-bit row.
+inline void composite_row(std::uint8_t *dst, const std::uint8_t *src, std::size_t n, unsigned opacity,
+                          BlendMode mode) {
+    if (mode == BlendMode::normal) {
+        kernels::over32_row(dst, src, n, opacity);
+        return;
+    }
+    using kernels::detail::div255;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint8_t *s = src + i * 4;
+        if (kernels::detail::load_u32(s) == 0) continue; // transparent
+        std::uint8_t *d = dst + i * 4;
+        const unsigned a = div255(s[3] * opacity);
+        for (int c = 0; c < 3; ++c) {
+            const unsigned sc = div255(s[c] * opacity);
+            unsigned out = d[c];
+            switch (mode) {
+            case BlendMode::multiply: out = div255(out * std::min(255u, sc + 255 - a)); break;
+            case BlendMode::screen: out = out + sc - div255(out * sc); break;
+            case BlendMode::add: out = out + sc; break;
+            case BlendMode::normal: break;
+            }
+            d[c] = static_cast<std::uint8_t>(std::min(out, 255u));
+        }
+    }
+}
+
+} // namespace detail
+
+// A straight-alpha color with its channels scaled by its alpha, the form layer pixels hold.
+inline RGBA32 premultiply(RGBA32 c) {
+    return {detail::mix_channel(0, c.r, c.a), detail::mix_channel(0, c.g, c.a), detail::mix_channel(0, c.b, c.a),
+            c.a};
+}
+
+// The canvas behind each LayerStack layer: a CanvasRGBA32 that keeps its pixels
+// premultiplied. Colors are passed straight, as everywhere else. Blended calls already
+// leave premultiplied pixels (straight source-over a premultiplied pixel), so only the
+// calls that store `color` as-is are wrapped to store premultiply(color) instead.
+// These are hiding overloads: draw through a LayerCanvas (BasicTurtle<LayerCanvas>, not
+// TurtleRGBA32) unless every color is opaque.
+class LayerCanvas : public CanvasRGBA32 {
+public:
+    using CanvasRGBA32::CanvasRGBA32;
+    using CanvasRGBA32::clear;
+
+    void clear(RGBA32 background) { CanvasRGBA32::clear(premultiply(background)); }
+    void set_pixel(int x, int y, RGBA32 color) { CanvasRGBA32::set_pixel(x, y, premultiply(color)); }
+    void fill_span(int x0, int x1, int y, RGBA32 color) { CanvasRGBA32::fill_span(x0, x1, y, premultiply(color)); }
+    void fill_circle(int cx, int cy, int r, RGBA32 color) { CanvasRGBA32::fill_circle(cx, cy, r, premultiply(color)); }
+    std::size_t flood_fill(int x, int y, RGBA32 color) { return CanvasRGBA32::flood_fill(x, y, premultiply(color)); }
+
+    void draw_line(int x0, int y0, int x1, int y1, RGBA32 color) {
+        CanvasRGBA32::draw_line(x0, y0, x1, y1, premultiply(color));
+    }
+    void draw_line(int x0, int y0, int x1, int y1, RGBA32 color, std::uint8_t alpha) {
+        CanvasRGBA32::draw_line(x0, y0, x1, y1, alpha == 255 ? premultiply(color) : color, alpha);
+    }
+
+    void fill_polygon(const std::vector<Point> &points, RGBA32 color, FillRule rule = FillRule::even_odd,
+                      std::uint8_t alpha = 255) {
+        CanvasRGBA32::fill_polygon(points, alpha == 255 ? premultiply(color) : color, rule, alpha);
+    }
+
+    void draw_circle(int cx, int cy, int r, RGBA32 color, std::uint8_t alpha = 255) {
+        draw_arc(cx, cy, r, 0.0, 360.0, color, alpha);
+    }
+    void draw_arc(int cx, int cy, int r, double start_degrees, double sweep_degrees, RGBA32 color,
+                  std::uint8_t alpha = 255) {
+        CanvasRGBA32::draw_arc(cx, cy, r, start_degrees, sweep_degrees, alpha == 255 ? premultiply(color) : color,
+                               alpha);
+    }
+};
+
+// An ordered stack of transparent layers flattened onto an opaque CanvasRGB, so one
+// element (a turtle cursor, a highlight, a HUD) can move without redrawing the scene
+// under it. Draw on layer(i) directly or through a BasicTurtle<LayerCanvas>. composite()
+// consumes the layers' dirty regions and redraws only the tiles that changed since the
+// previous call; output()'s own dirty region then says what a presenter has to repaint.
+//
+// Layer pixels hold premultiplied alpha, which LayerCanvas maintains for straight-alpha
+// colors. Layers start out transparent and clear() makes them transparent again.
+class LayerStack {
+public:
+    LayerStack(std::size_t width, std::size_t height, Color background = pixel_traits<Color>::background())
+        : out_(width, height, background), background_(background), pending_(width, height), row_(width) {
+        pending_.mark_all();
+    }
+
+    std::size_t width() const { return out_.width(); }
+    std::size_t height() const { return out_.height(); }
+    std::size_t size() const { return layers_.size(); }
+
+    // Add a transparent layer on top of the others and return its index. Canvas
+    // references stay valid until the layer is removed.
+    std::size_t add_layer(BlendMode mode = BlendMode::normal) {
+        auto layer = std::make_unique<Layer>(width(), height());
+        layer->canvas.clear_dirty(); // transparent: the output does not change
+        layer->mode = mode;
+        layers_.push_back(std::move(layer));
+        return layers_.size() - 1;
+    }
+
+    LayerCanvas &layer(std::size_t i) { return at(i).canvas; }
+    const LayerCanvas &layer(std::size_t i) const { return at(i).canvas; }
+
+    bool visible(std::size_t i) const { return at(i).visible; }
+    std::uint8_t opacity(std::size_t i) const { return at(i).opacity; }
+    BlendMode blend_mode(std::size_t i) const { return at(i).mode; }
+
+    void set_visible(std::size_t i, bool visible) {
+        Layer &l = at(i);
+        if (l.visible == visible) return;
+        touch(l);
+        l.visible = visible;
+    }
+
+    void set_opacity(std::size_t i, std::uint8_t opacity) {
+        Layer &l = at(i);
+        if (l.opacity == opacity) return;
+        touch(l);
+        l.opacity = opacity;
+    }
+
+    void set_blend_mode(std::size_t i, BlendMode mode) {
+        Layer &l = at(i);
+        if (l.mode == mode) return;
+        touch(l);
+        l.mode = mode;
+    }
+
+    // Move layer `from` to position `to`, shifting the layers in between.
+    void move_layer(std::size_t from, std::size_t to) {
+        assert(from < layers_.size() && to < layers_.size() && "layer index out of range");
+        if (from == to) return;
+        touch(*layers_[from]);
+        const auto first = layers_.begin();
+        if (from < to) {
+            std::rotate(first + static_cast<std::ptrdiff_t>(from), first + static_cast<std::ptrdiff_t>(from) + 1,
+                        first + static_cast<std::ptrdiff_t>(to) + 1);
+        } else {
+            std::rotate(first + static_cast<std::ptrdiff_t>(to), first + static_cast<std::ptrdiff_t>(from),
+                        first + static_cast<std::ptrdiff_t>(from) + 1);
+        }
+    }
+
+    // Remove layer i; the layers above it move down one index.
+    void remove_layer(std::size_t i) {
+        touch(at(i));
+        layers_.erase(layers_.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+
+    // Make layer i transparent again, touching only the tiles drawn on since it was last
+    // cleared. A cursor overlay is cleared and redrawn every frame at the cost of the
+    // tiles under its old and new positions; CanvasRGBA32::clear() would touch them all.
+    void clear_layer(std::size_t i) {
+        Layer &l = at(i);
+        l.painted.merge(l.canvas.dirty());
+        l.canvas.clear_dirty();
+        for (const Rect &r : l.painted.rects()) {
+            for (int y = r.y; y < r.bottom(); ++y) {
+                kernels::fill(l.canvas.row(static_cast<std::size_t>(y)) + r.x, static_cast<std::size_t>(r.w),
+                              RGBA32{0, 0, 0, 0});
+            }
+        }
+        if (l.visible && l.opacity) pending_.merge(l.painted);
+        l.painted.clear();
+    }
+
+    Color background() const { return background_; }
+    void set_background(Color background) {
+        background_ = background;
+        pending_.mark_all();
+    }
+
+    // Recomposite everything on the next composite(), e.g. after drawing on output().
+    void invalidate() { pending_.mark_all(); }
+
+    // Bring output() up to date. Only tiles dirtied on visible layers, or touched by layer
+    // changes, since the previous call are recomposited: background, then each visible
+    // layer bottom to top. Returns those rectangles, empty when nothing changed.
+    const std::vector<Rect> &composite() {
+        PROJECTCODE_TRACE_SCOPE("layers", "composite");
+        for (auto &layer : layers_) {
+            const DirtyRegion &d = layer->canvas.dirty();
+            if (d.empty()) continue;
+            layer->painted.merge(d);
+            if (layer->visible && layer->opacity) pending_.merge(d);
+            layer->canvas.clear_dirty();
+        }
+        rects_ = pending_.rects();
+        pending_.clear();
+        for (const Rect &r : rects_) composite_rect(r);
+        return rects_;
+    }
+
+    // The flattened image as of the last composite().
+    const CanvasRGB &output() const { return out_; }
+    CanvasRGB &output() { return out_; }
+
+private:
+    struct Layer {
+        Layer(std::size_t width, std::size_t height)
+            : canvas(width, height, RGBA32{0, 0, 0, 0}), painted(width, height) {}
+
+        LayerCanvas canvas;
+        DirtyRegion painted; // tiles drawn on since the layer was last cleared
+        bool visible = true;
+        std::uint8_t opacity = 255;
+        BlendMode mode = BlendMode::normal;
+    };
+
+    CanvasRGB out_;
+    Color background_;
+    std::vector<std::unique_ptr<Layer>> layers_; // bottom first; boxed so canvases never move
+    DirtyRegion pending_;                        // output tiles to recomposite
+    std::vector<Rect> rects_;
+    std::vector<RGBA32, AlignedAllocator<RGBA32, 64>> row_; // one output row being composited
+
+    Layer &at(std::size_t i) {
+        assert(i < layers_.size() && "layer index out of range");
+        return *layers_[i];
+    }
+    const Layer &at(std::size_t i) const {
+        assert(i < layers_.size() && "layer index out of range");
+        return *layers_[i];
+    }
+
+    // Everything the layer may cover changes when its visibility, opacity, mode or place
+    // in the stack does.
+    void touch(const Layer &l) {
+        pending_.merge(l.painted);
+        pending_.merge(l.canvas.dirty());
+    }
+
+    void composite_rect(const Rect &r) {
+        const std::size_t n = static_cast<std::size_t>(r.w);
+        auto *acc = reinterpret_cast<std::uint8_t *>(row_.data());
+        for (int y = r.y; y < r.bottom(); ++y) {
+            const std::size_t row = static_cast<std::size_t>(y);
+            kernels::fill(row_.data(), n, RGBA32{background_.r, background_.g, background_.b, 255});
+            for (const auto &layer : layers_) {
+                if (!layer->visible || !layer->opacity) continue;
+                detail::composite_row(acc, reinterpret_cast<const std::uint8_t *>(layer->canvas.row(row) + r.x), n,
+                                      layer->opacity, layer->mode);
+            }
+            kernels::pack24(acc, reinterpret_cast<std::uint8_t *>(out_.row(row) + r.x), n, false);
+        }
+        out_.mark_dirty(r);
+    }
+};
+
+} // namespace projectcode
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace projectcode {
+
+// A file mapped into memory, either created at a fixed size for writing or opened
+// read-only. Writers fill the pages directly instead of going through stream buffers.
+// is_open() reports whether the mapping succeeded; the file is unmapped and closed on
+// destruction. Disk space for writable files is reserved up front, so a full disk fails
+// create() or grow() instead of faulting on a later page write; flush() reports whether
+// the written pages reached the file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept { swap(other); }
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+    ~MappedFile() { close(); }
+
+    // Create (or truncate) `path` with exactly `size` bytes reserved and map it read-write.
+    static MappedFile create(const std::string &path, std::size_t size) {
+        MappedFile f;
+        if (size == 0) return f;
+#ifdef _WIN32
+        f.file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (f.file_ == INVALID_HANDLE_VALUE || !reserve(f.file_, size)) return f;
+        const std::uint64_t s = size;
+        f.mapping_ = CreateFileMappingA(f.file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(s >> 32),
+                                        static_cast<DWORD>(s & 0xFFFFFFFFu), nullptr);
+        if (!f.mapping_) return f;
+        f.data_ = static_cast<std::uint8_t *>(MapViewOfFile(f.mapping_, FILE_MAP_WRITE, 0, 0, size));
+#else
+        f.fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (f.fd_ < 0) return f;
+        if (!reserve(f.fd_, 0, size)) return f;
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f.fd_, 0);
+        if (p == MAP_FAILED) return f;
+        f.data_ = static_cast<std::uint8_t *>(p);
+#endif
+        if (f.data_) f.size_ = size;
+        return f;
+    }
+
+    // Map an existing file read-only.
+    static MappedFile open_read(const std::string &path) {
+        MappedFile f;
+#ifdef _WIN32
+        f.file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (f.file_ == INVALID_HANDLE_VALUE) return f;
+        LARGE_INTEGER len;
+        if (!GetFileSizeEx(f.file_, &len) || len.QuadPart == 0) return f;
+        f.mapping_ = CreateFileMappingA(f.file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!f.mapping_) return f;
+        f.data_ = static_cast<std::uint8_t *>(MapViewOfFile(f.mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (f.data_) f.size_ = static_cast<std::size_t>(len.QuadPart);
+#else
+        f.fd_ = ::open(path.c_str(), O_RDONLY);
+        if (f.fd_ < 0) return f;
+        struct stat st;
+        if (::fstat(f.fd_, &st) != 0 || st.st_size == 0) return f;
+        void *p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, f.fd_, 0);
+        if (p == MAP_FAILED) return f;
+        f.data_ = static_cast<std::uint8_t *>(p);
+        f.size_ = static_cast<std::size_t>(st.st_size);
+#endif
+        return f;
+    }
+
+    // Extend a file from create() to `size` bytes and map it again; the data pointer
+    // changes. On failure the old mapping stays valid.
+    bool grow(std::size_t size) {
+        if (!data_ || size <= size_) return data_ != nullptr;
+#ifdef _WIN32
+        if (!reserve(file_, size)) return false;
+        const std::uint64_t s = size;
+        HANDLE mapping = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(s >> 32),
+                                           static_cast<DWORD>(s & 0xFFFFFFFFu), nullptr);
+        if (!mapping) return false;
+        void *p = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+        if (!p) {
+            CloseHandle(mapping);
+            return false;
+        }
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        mapping_ = mapping;
+#else
+        if (!reserve(fd_, size_, size - size_)) return false;
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) return false;
+        ::munmap(data_, size_);
+#endif
+        data_ = static_cast<std::uint8_t *>(p);
+        size_ = size;
+        return true;
+    }
+
+    // Write the mapped pages of a file from create() back to disk and wait for them.
+    bool flush() {
+        if (!data_) return false;
+#ifdef _WIN32
+        return FlushViewOfFile(data_, 0) && FlushFileBuffers(file_);
+#else
+        return ::msync(data_, size_, MS_SYNC) == 0;
+#endif
+    }
+
+    bool is_open() const { return data_ != nullptr; }
+    std::size_t size() const { return size_; }
+    std::uint8_t *data() { return data_; } // writable only for files from create()
+    const std::uint8_t *data() const { return data_; }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) ::munmap(data_, size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    std::uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+
+#ifdef _WIN32
+    // Set the file's end to `size` bytes, allocating the clusters up to it.
+    static bool reserve(HANDLE file, std::size_t size) {
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(size);
+        return SetFilePointerEx(file, end, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+    }
+#else
+    // Allocate blocks for [offset, offset + len), growing the file to cover them. macOS
+    // has no posix_fallocate and only gets the size.
+    static bool reserve(int fd, std::size_t offset, std::size_t len) {
+#ifdef __APPLE__
+        return ::ftruncate(fd, static_cast<off_t>(offset + len)) == 0;
+#else
+        return ::posix_fallocate(fd, static_cast<off_t>(offset), static_cast<off_t>(len)) == 0;
+#endif
+    }
+#endif
+
+    void swap(MappedFile &other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+#ifdef _WIN32
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#else
+        std::swap(fd_, other.fd_);
+#endif
+    }
+};
+
+} // namespace projectcode
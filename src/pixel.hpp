@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace projectcode {
+
+// Packed 24-bit RGB, the library's default color.
+struct Color {
+    unsigned char r{0};
+    unsigned char g{0};
+    unsigned char b{0};
+};
+static_assert(sizeof(Color) == 3, "Color rows are written to files as packed RGB bytes");
+
+// 32-bit pixels with alpha. Four-byte aligned, so whole rows can be filled, blended and
+// swizzled with vector loads. BGRA32 matches the byte order of Windows DIBs.
+struct alignas(4) RGBA32 {
+    unsigned char r{0};
+    unsigned char g{0};
+    unsigned char b{0};
+    unsigned char a{255};
+};
+
+struct alignas(4) BGRA32 {
+    unsigned char b{0};
+    unsigned char g{0};
+    unsigned char r{0};
+    unsigned char a{255};
+};
+
+static_assert(sizeof(RGBA32) == 4 && sizeof(BGRA32) == 4, "32-bit pixels must not be padded");
+
+namespace detail {
+// round((s * a + d * (255 - a)) / 255), exact for 8-bit inputs.
+inline unsigned char mix_channel(unsigned d, unsigned s, unsigned a) {
+    unsigned x = s * a + d * (255 - a) + 128;
+    return static_cast<unsigned char>((x + (x >> 8)) >> 8);
+}
+
+// Source-over for the 32-bit formats: the pixel's own alpha scaled by `alpha`, the
+// destination color treated as opaque (matches kernels::blend32).
+template <class P>
+void blend32(P &dst, P src, unsigned alpha) {
+    const unsigned a = mix_channel(0, src.a, alpha);
+    dst.r = mix_channel(dst.r, src.r, a);
+    dst.g = mix_channel(dst.g, src.g, a);
+    dst.b = mix_channel(dst.b, src.b, a);
+    dst.a = mix_channel(dst.a, 255, a);
+}
+} // namespace detail
+
+// Per-format defaults and conversions used by BasicCanvas and BasicTurtle.
+// row_alignment is the byte alignment BasicCanvas rounds each row up to by default.
+// blend(dst, src, alpha) draws src over dst at opacity alpha (0-255); character cells
+// cannot be mixed, so they are replaced once alpha reaches half.
+template <class Pixel>
+struct pixel_traits;
+
+template <>
+struct pixel_traits<char> {
+    static constexpr std::size_t row_alignment = 1;
+    static char background() { return ' '; }
+    static char pen() { return '*'; }
+    static void blend(char &dst, char src, unsigned alpha) {
+        if (alpha >= 128) dst = src;
+    }
+};
+
+template <>
+struct pixel_traits<Color> {
+    static constexpr std::size_t row_alignment = 1;
+    static Color background() { return {255, 255, 255}; }
+    static Color pen() { return {0, 0, 0}; }
+    static Color to_rgb(Color c) { return c; }
+    static Color from_rgb(Color c) { return c; }
+    static void blend(Color &dst, Color src, unsigned alpha) {
+        dst.r = detail::mix_channel(dst.r, src.r, alpha);
+        dst.g = detail::mix_channel(dst.g, src.g, alpha);
+        dst.b = detail::mix_channel(dst.b, src.b, alpha);
+    }
+};
+
+template <>
+struct pixel_traits<RGBA32> {
+    static constexpr std::size_t row_alignment = 64;
+    static RGBA32 background() { return {255, 255, 255, 255}; }
+    static RGBA32 pen() { return {0, 0, 0, 255}; }
+    static Color to_rgb(RGBA32 p) { return {p.r, p.g, p.b}; }
+    static RGBA32 from_rgb(Color c) { return {c.r, c.g, c.b, 255}; }
+    static void blend(RGBA32 &dst, RGBA32 src, unsigned alpha) { detail::blend32(dst, src, alpha); }
+};
+
+template <>
+struct pixel_traits<BGRA32> {
+    static constexpr std::size_t row_alignment = 64;
+    static BGRA32 background() { return {255, 255, 255, 255}; }
+    static BGRA32 pen() { return {0, 0, 0, 255}; }
+    static Color to_rgb(BGRA32 p) { return {p.r, p.g, p.b}; }
+    static BGRA32 from_rgb(Color c) { return {c.b, c.g, c.r, 255}; }
+    static void blend(BGRA32 &dst, BGRA32 src, unsigned alpha) { detail::blend32(dst, src, alpha); }
+};
+
+// Allocator handing out `Align`-byte aligned storage, used for cache-line aligned rows.
+template <class T, std::size_t Align>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <class U>
+    struct rebind {
+        using other = AlignedAllocator<U, Align>;
+    };
+
+    AlignedAllocator() = default;
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Align> &) {}
+
+    T *allocate(std::size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T *p, std::size_t) { ::operator delete(p, std::align_val_t(Align)); }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U, Align> &) const {
+        return true;
+    }
+    template <class U>
+    bool operator!=(const AlignedAllocator<U, Align> &) const {
+        return false;
+    }
+};
+
+} // namespace projectcode
@@ -0,0 +1,1141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PROJECTCODE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define PROJECTCODE_X86 0
+#endif
+
+// GCC and Clang only allow an instruction set's intrinsics inside functions compiled for
+// it; MSVC allows them everywhere.
+#if PROJECTCODE_X86 && (defined(__GNUC__) || defined(__clang__))
+#define PROJECTCODE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PROJECTCODE_TARGET(isa)
+#endif
+
+namespace projectcode {
+
+enum class SimdLevel : std::uint8_t { scalar, sse2, ssse3, avx2 };
+
+// Bulk pixel kernels: fills, RGB <-> BGR(A) swizzles, source-over blending, run matching,
+// image differencing, row summing and layer compositing over raw bytes. Each has a scalar version and
+// SSE2/SSSE3/AVX2 versions where they pay off; the best one the CPU supports is picked on
+// first use. Every version produces the same bytes, so output never depends on the machine.
+namespace kernels {
+
+// How n 3-byte pixels of two images differ (see diff24). `first` and `last` are
+// meaningful only when `differing` is nonzero.
+struct Diff24 {
+    std::size_t differing = 0; // pixels with a channel delta above the tolerance
+    std::size_t first = 0;     // index of the first such pixel
+    std::size_t last = 0;      // and of the last
+    unsigned max_delta = 0;    // largest channel delta
+    std::uint64_t sum_sq = 0;  // sum of squared channel deltas
+};
+
+namespace detail {
+
+inline std::uint32_t load_u32(const std::uint8_t *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline void store_u32(std::uint8_t *p, std::uint32_t v) { std::memcpy(p, &v, 4); }
+
+// Exact round(x / 255) for x in [0, 255 * 255].
+inline unsigned div255(unsigned x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// Index of the lowest / highest set bit of a nonzero mask.
+inline unsigned lowest_bit(std::uint32_t m) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return static_cast<unsigned>(i);
+#else
+    return static_cast<unsigned>(__builtin_ctz(m));
+#endif
+}
+
+inline unsigned highest_bit(std::uint32_t m) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanReverse(&i, m);
+    return static_cast<unsigned>(i);
+#else
+    return 31u - static_cast<unsigned>(__builtin_clz(m));
+#endif
+}
+
+// Byte-equality masks of three consecutive vectors (`bits` bytes each) holding 3-byte
+// pixels: the number of pixels matching before the first mismatch, or after the last.
+inline std::size_t first_mismatch24(const std::uint32_t *eq, unsigned bits) {
+    const std::uint32_t full = bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1u;
+    for (unsigned k = 0; k < 3; ++k) {
+        const std::uint32_t miss = ~eq[k] & full;
+        if (miss) return (k * bits + lowest_bit(miss)) / 3;
+    }
+    return bits;
+}
+
+inline std::size_t last_mismatch24(const std::uint32_t *eq, unsigned bits) {
+    const std::uint32_t full = bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1u;
+    for (unsigned k = 3; k-- > 0;) {
+        const std::uint32_t miss = ~eq[k] & full;
+        if (miss) return bits - 1 - (k * bits + highest_bit(miss)) / 3;
+    }
+    return bits;
+}
+
+// ---- scalar ---------------------------------------------------------------------------
+
+inline void fill24_scalar(std::uint8_t *dst, std::size_t n, const std::uint8_t *px) {
+    for (std::size_t i = 0; i < n; ++i, dst += 3) {
+        dst[0] = px[0];
+        dst[1] = px[1];
+        dst[2] = px[2];
+    }
+}
+
+inline void fill32_scalar(std::uint8_t *dst, std::size_t n, std::uint32_t v) {
+    for (std::size_t i = 0; i < n; ++i) store_u32(dst + i * 4, v);
+}
+
+inline void swap_rb24_scalar(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint8_t r = src[i * 3 + 0];
+        dst[i * 3 + 1] = src[i * 3 + 1];
+        dst[i * 3 + 0] = src[i * 3 + 2];
+        dst[i * 3 + 2] = r;
+    }
+}
+
+inline void swap_rb32_scalar(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint32_t v = load_u32(src + i * 4);
+        store_u32(dst + i * 4, (v & 0xFF00FF00u) | ((v >> 16) & 0xFFu) | ((v & 0xFFu) << 16));
+    }
+}
+
+template <bool Swap>
+void pack24_scalar(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i * 3 + 0] = src[i * 4 + (Swap ? 2 : 0)];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4 + (Swap ? 0 : 2)];
+    }
+}
+
+template <bool Swap>
+void expand32_scalar(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint8_t r = src[i * 3 + 0];
+        const std::uint8_t b = src[i * 3 + 2];
+        dst[i * 4 + 0] = Swap ? b : r;
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = Swap ? r : b;
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+// Source-over with straight alpha in byte 3, treating the destination color as opaque:
+// out = (src * a + dst * (255 - a)) / 255 per channel, with the alpha channel's source
+// taken as 255, which gives out_a = a + dst_a * (255 - a) / 255.
+inline void blend_pixel(std::uint8_t *d, const std::uint8_t *s) {
+    const unsigned a = s[3];
+    const unsigned ia = 255 - a;
+    d[0] = static_cast<std::uint8_t>(div255(s[0] * a + d[0] * ia));
+    d[1] = static_cast<std::uint8_t>(div255(s[1] * a + d[1] * ia));
+    d[2] = static_cast<std::uint8_t>(div255(s[2] * a + d[2] * ia));
+    d[3] = static_cast<std::uint8_t>(div255(255 * a + d[3] * ia));
+}
+
+inline void blend32_scalar(std::uint8_t *dst, std::size_t n, std::uint32_t color) {
+    std::uint8_t s[4];
+    store_u32(s, color);
+    for (std::size_t i = 0; i < n; ++i) blend_pixel(dst + i * 4, s);
+}
+
+inline void blend32_row_scalar(std::uint8_t *dst, const std::uint8_t *src, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) blend_pixel(dst + i * 4, src + i * 4);
+}
+
+// Source-over with premultiplied alpha in byte 3, the source first scaled by `alpha`:
+// s' = s * alpha / 255, out = s' + dst * (255 - s'_a) / 255 per channel, saturating.
+// Fully transparent source pixels (all four bytes zero) leave dst untouched.
+inline void over32_row_scalar(std::uint8_t *dst, const std::uint8_t *src, std::size_t n, unsigned alpha) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint8_t *s = src + i * 4;
+        if (load_u32(s) == 0) continue;
+        std::uint8_t *d = dst + i * 4;
+        const unsigned ia = 255 - div255(s[3] * alpha);
+        for (int c = 0; c < 4; ++c) {
+            d[c] = static_cast<std::uint8_t>(std::min(255u, div255(s[c] * alpha) + div255(d[c] * ia)));
+        }
+    }
+}
+
+// Run matching: how many of the n pixels starting at p (match) or ending just before
+// `end` (match_back) equal the given pixel before the first one that differs.
+inline std::size_t match24_scalar(const std::uint8_t *p, std::size_t n, const std::uint8_t *px) {
+    std::size_t i = 0;
+    for (; i < n; ++i, p += 3) {
+        if (p[0] != px[0] || p[1] != px[1] || p[2] != px[2]) break;
+    }
+    return i;
+}
+
+inline std::size_t match24_back_scalar(const std::uint8_t *end, std::size_t n, const std::uint8_t *px) {
+    std::size_t i = 0;
+    for (; i < n; ++i) {
+        end -= 3;
+        if (end[0] != px[0] || end[1] != px[1] || end[2] != px[2]) break;
+    }
+    return i;
+}
+
+inline std::size_t match32_scalar(const std::uint8_t *p, std::size_t n, std::uint32_t v) {
+    std::size_t i = 0;
+    while (i < n && load_u32(p + i * 4) == v) ++i;
+    return i;
+}
+
+inline std::size_t match32_back_scalar(const std::uint8_t *end, std::size_t n, std::uint32_t v) {
+    std::size_t i = 0;
+    while (i < n && load_u32(end - (i + 1) * 4) == v) ++i;
+    return i;
+}
+
+// Add the statistics of pixels starting `offset` pixels into the row to `into`.
+inline void merge_diff(Diff24 &into, const Diff24 &part, std::size_t offset) {
+    if (part.differing) {
+        if (!into.differing) into.first = offset + part.first;
+        into.last = offset + part.last;
+        into.differing += part.differing;
+    }
+    into.max_delta = std::max(into.max_delta, part.max_delta);
+    into.sum_sq += part.sum_sq;
+}
+
+inline Diff24 diff24_scalar(const std::uint8_t *a, const std::uint8_t *b, std::size_t n, unsigned tolerance) {
+    Diff24 r;
+    for (std::size_t i = 0; i < n; ++i, a += 3, b += 3) {
+        unsigned worst = 0;
+        for (int c = 0; c < 3; ++c) {
+            const unsigned d = a[c] > b[c] ? a[c] - b[c] : b[c] - a[c];
+            r.sum_sq += d * d;
+            worst = std::max(worst, d);
+        }
+        r.max_delta = std::max(r.max_delta, worst);
+        if (worst > tolerance) {
+            if (!r.differing) r.first = i;
+            r.last = i;
+            ++r.differing;
+        }
+    }
+    return r;
+}
+
+inline void accumulate8_scalar(std::uint16_t *acc, const std::uint8_t *src, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) acc[i] = static_cast<std::uint16_t>(acc[i] + src[i]);
+}
+
+#if PROJECTCODE_X86
+// Fold a mask over 48 bytes (16 pixels) into one bit per pixel, at bit 3 * pixel, and add
+// those pixels, the first at index `base`, to `r`.
+inline void add_pixels24(Diff24 &r, std::uint64_t bytes, std::size_t base) {
+    std::uint64_t bits = (bytes | bytes >> 1 | bytes >> 2) & 0x249249249249ull;
+    if (!bits) return;
+    const auto lo = static_cast<std::uint32_t>(bits);
+    const auto hi = static_cast<std::uint32_t>(bits >> 32);
+    if (!r.differing) r.first = base + (lo ? lowest_bit(lo) : 32 + lowest_bit(hi)) / 3;
+    r.last = base + (hi ? 32 + highest_bit(hi) : highest_bit(lo)) / 3;
+    bits -= (bits >> 1) & 0x5555555555555555ull; // population count
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    r.differing += static_cast<std::size_t>((bits * 0x0101010101010101ull) >> 56);
+}
+#endif
+
+#if PROJECTCODE_X86
+
+// ---- SSE2 -----------------------------------------------------------------------------
+
+PROJECTCODE_TARGET("sse2")
+inline void fill24_sse2(std::uint8_t *dst, std::size_t n, const std::uint8_t *px) {
+    // 16 pixels are exactly three vectors.
+    alignas(16) std::uint8_t pattern[48];
+    fill24_scalar(pattern, 16, px);
+    const __m128i v0 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern));
+    const __m128i v1 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern + 16));
+    const __m128i v2 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern + 32));
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16, dst += 48) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v0);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), v1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), v2);
+    }
+    fill24_scalar(dst, n - i, px);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline void fill32_sse2(std::uint8_t *dst, std::size_t n, std::uint32_t v) {
+    const __m128i x = _mm_set1_epi32(static_cast<int>(v));
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), x);
+    fill32_scalar(dst + i * 4, n - i, v);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline void swap_rb32_sse2(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m128i ga = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+    const __m128i lo = _mm_set1_epi32(0xFF);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        const __m128i r = _mm_or_si128(_mm_and_si128(v, ga),
+                                       _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), lo),
+                                                    _mm_slli_epi32(_mm_and_si128(v, lo), 16)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), r);
+    }
+    swap_rb32_scalar(src + i * 4, dst + i * 4, n - i);
+}
+
+// Blend four pixels held as 16-bit lanes: (s * a + d * (255 - a)) / 255, rounded exactly.
+PROJECTCODE_TARGET("sse2")
+inline __m128i blend_lanes_sse2(__m128i d16, __m128i sa16, __m128i ia16) {
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(d16, ia16), sa16);
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline void blend32_sse2(std::uint8_t *dst, std::size_t n, std::uint32_t color) {
+    std::uint8_t s[4];
+    store_u32(s, color);
+    const unsigned a = s[3];
+    const short sa[4] = {static_cast<short>(s[0] * a), static_cast<short>(s[1] * a), static_cast<short>(s[2] * a),
+                         static_cast<short>(255 * a)};
+    const __m128i sa16 = _mm_setr_epi16(sa[0], sa[1], sa[2], sa[3], sa[0], sa[1], sa[2], sa[3]);
+    const __m128i ia16 = _mm_set1_epi16(static_cast<short>(255 - a));
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i * 4));
+        const __m128i lo = blend_lanes_sse2(_mm_unpacklo_epi8(d, zero), sa16, ia16);
+        const __m128i hi = blend_lanes_sse2(_mm_unpackhi_epi8(d, zero), sa16, ia16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    blend32_scalar(dst + i * 4, n - i, color);
+}
+
+// Per-pixel alpha: broadcast each pixel's alpha over its four lanes and substitute 255 for
+// the source alpha channel.
+PROJECTCODE_TARGET("sse2")
+inline __m128i blend_row_lanes_sse2(__m128i d16, __m128i s16) {
+    const __m128i a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+    const __m128i alpha_lane = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    const __m128i s_opaque = _mm_or_si128(_mm_andnot_si128(alpha_lane, s16), _mm_and_si128(alpha_lane, _mm_set1_epi16(255)));
+    const __m128i ia16 = _mm_sub_epi16(_mm_set1_epi16(255), a16);
+    return blend_lanes_sse2(d16, _mm_mullo_epi16(s_opaque, a16), ia16);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline void blend32_row_sse2(std::uint8_t *dst, const std::uint8_t *src, std::size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i * 4));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        const __m128i lo = blend_row_lanes_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+        const __m128i hi = blend_row_lanes_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    blend32_row_scalar(dst + i * 4, src + i * 4, n - i);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline __m128i over_lanes_sse2(__m128i d16, __m128i s16, __m128i alpha16) {
+    const __m128i zero = _mm_setzero_si128();
+    s16 = blend_lanes_sse2(s16, zero, alpha16); // s * alpha / 255
+    const __m128i a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+    return _mm_add_epi16(s16, blend_lanes_sse2(d16, zero, _mm_sub_epi16(_mm_set1_epi16(255), a16)));
+}
+
+PROJECTCODE_TARGET("sse2")
+inline void over32_row_sse2(std::uint8_t *dst, const std::uint8_t *src, std::size_t n, unsigned alpha) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha16 = _mm_set1_epi16(static_cast<short>(alpha));
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(s, zero)) == 0xFFFF) continue; // transparent
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i * 4));
+        const __m128i lo = over_lanes_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), alpha16);
+        const __m128i hi = over_lanes_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), alpha16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    over32_row_scalar(dst + i * 4, src + i * 4, n - i, alpha);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline std::uint32_t equal_mask_sse2(const std::uint8_t *p, __m128i v) {
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), v)));
+}
+
+// 16 pixels are three vectors compared against the repeating pattern.
+PROJECTCODE_TARGET("sse2")
+inline std::size_t match24_sse2(const std::uint8_t *p, std::size_t n, const std::uint8_t *px) {
+    alignas(16) std::uint8_t pattern[48];
+    fill24_scalar(pattern, 16, px);
+    const __m128i v0 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern));
+    const __m128i v1 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern + 16));
+    const __m128i v2 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern + 32));
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const std::uint8_t *q = p + i * 3;
+        const std::uint32_t eq[3] = {equal_mask_sse2(q, v0), equal_mask_sse2(q + 16, v1), equal_mask_sse2(q + 32, v2)};
+        const std::size_t run = first_mismatch24(eq, 16);
+        if (run < 16) return i + run;
+    }
+    return i + match24_scalar(p + i * 3, n - i, px);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline std::size_t match24_back_sse2(const std::uint8_t *end, std::size_t n, const std::uint8_t *px) {
+    alignas(16) std::uint8_t pattern[48];
+    fill24_scalar(pattern, 16, px);
+    const __m128i v0 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern));
+    const __m128i v1 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern + 16));
+    const __m128i v2 = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern + 32));
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const std::uint8_t *q = end - (i + 16) * 3;
+        const std::uint32_t eq[3] = {equal_mask_sse2(q, v0), equal_mask_sse2(q + 16, v1), equal_mask_sse2(q + 32, v2)};
+        const std::size_t run = last_mismatch24(eq, 16);
+        if (run < 16) return i + run;
+    }
+    return i + match24_back_scalar(end - i * 3, n - i, px);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline std::size_t match32_sse2(const std::uint8_t *p, std::size_t n, std::uint32_t v) {
+    const __m128i x = _mm_set1_epi32(static_cast<int>(v));
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const std::uint32_t miss = ~equal_mask_sse2(p + i * 4, x) & 0xFFFFu;
+        if (miss) return i + lowest_bit(miss) / 4;
+    }
+    return i + match32_scalar(p + i * 4, n - i, v);
+}
+
+PROJECTCODE_TARGET("sse2")
+inline std::size_t match32_back_sse2(const std::uint8_t *end, std::size_t n, std::uint32_t v) {
+    const __m128i x = _mm_set1_epi32(static_cast<int>(v));
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const std::uint32_t miss = ~equal_mask_sse2(end - (i + 4) * 4, x) & 0xFFFFu;
+        if (miss) return i + 3 - highest_bit(miss) / 4;
+    }
+    return i + match32_back_scalar(end - i * 4, n - i, v);
+}
+
+// |a - b| per byte, and the squares of those deltas summed in pairs into 32-bit lanes.
+PROJECTCODE_TARGET("sse2")
+inline __m128i abs_diff_sse2(const std::uint8_t *a, const std::uint8_t *b) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    return _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+}
+
+PROJECTCODE_TARGET("sse2")
+inline __m128i square_sum_sse2(__m128i d) {
+    const __m128i lo = _mm_unpacklo_epi8(d, _mm_setzero_si128());
+    const __m128i hi = _mm_unpackhi_epi8(d, _mm_setzero_si128());
+    return _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi));
+}
+
+// Bytes whose delta exceeds the tolerance `t`.
+PROJECTCODE_TARGET("sse2")
+inline std::uint32_t over_mask_sse2(__m128i d, __m128i t) {
+    return ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(d, t), _mm_setzero_si128()))) &
+           0xFFFFu;
+}
+
+// 16 pixels per step. Squares go to 32-bit lanes, which are drained into 64 bits before
+// they could overflow.
+PROJECTCODE_TARGET("sse2")
+inline Diff24 diff24_sse2(const std::uint8_t *a, const std::uint8_t *b, std::size_t n, unsigned tolerance) {
+    const __m128i t = _mm_set1_epi8(static_cast<char>(std::min(tolerance, 255u)));
+    __m128i top = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    alignas(16) std::uint32_t lanes[4];
+    Diff24 r;
+    std::size_t i = 0;
+    unsigned steps = 0;
+    for (; i + 16 <= n; i += 16) {
+        const std::uint8_t *p = a + i * 3;
+        const std::uint8_t *q = b + i * 3;
+        const __m128i d0 = abs_diff_sse2(p, q);
+        const __m128i d1 = abs_diff_sse2(p + 16, q + 16);
+        const __m128i d2 = abs_diff_sse2(p + 32, q + 32);
+        top = _mm_max_epu8(top, _mm_max_epu8(d0, _mm_max_epu8(d1, d2)));
+        acc = _mm_add_epi32(acc, _mm_add_epi32(square_sum_sse2(d0), _mm_add_epi32(square_sum_sse2(d1),
+                                                                                  square_sum_sse2(d2))));
+        if (tolerance < 255) {
+            add_pixels24(r, over_mask_sse2(d0, t) | std::uint64_t{over_mask_sse2(d1, t)} << 16 |
+                                std::uint64_t{over_mask_sse2(d2, t)} << 32, i);
+        }
+        if (++steps == 2048 || i + 32 > n) {
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+            r.sum_sq += std::uint64_t{lanes[0]} + lanes[1] + lanes[2] + lanes[3];
+            acc = _mm_setzero_si128();
+            steps = 0;
+        }
+    }
+    alignas(16) std::uint8_t bytes[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(bytes), top);
+    for (std::uint8_t v : bytes) r.max_delta = std::max<unsigned>(r.max_delta, v);
+    merge_diff(r, diff24_scalar(a + i * 3, b + i * 3, n - i, tolerance), i);
+    return r;
+}
+
+PROJECTCODE_TARGET("sse2")
+inline void accumulate8_sse2(std::uint16_t *acc, const std::uint8_t *src, std::size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        auto *a = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_unpacklo_epi8(s, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_unpackhi_epi8(s, zero)));
+    }
+    accumulate8_scalar(acc + i, src + i, n - i);
+}
+
+// ---- SSSE3: byte shuffles -------------------------------------------------------------
+
+PROJECTCODE_TARGET("ssse3")
+inline void swap_rb24_ssse3(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    // Five pixels per 16-byte shuffle. The 16th byte is copied through unchanged and
+    // rewritten by the next iteration, so stop while a full vector is still in range.
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 6 <= n; i += 5) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3), _mm_shuffle_epi8(v, mask));
+    }
+    swap_rb24_scalar(src + i * 3, dst + i * 3, n - i);
+}
+
+PROJECTCODE_TARGET("ssse3")
+inline void swap_rb32_ssse3(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+    swap_rb32_scalar(src + i * 4, dst + i * 4, n - i);
+}
+
+// Four 32-bit pixels to 12 packed bytes. The 16-byte store spills four bytes that the
+// next iteration overwrites, hence the extra pixels of headroom in the loop bound.
+template <bool Swap>
+PROJECTCODE_TARGET("ssse3")
+void pack24_ssse3(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m128i mask = Swap ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                              : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    std::size_t i = 0;
+    for (; i + 6 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3), _mm_shuffle_epi8(v, mask));
+    }
+    pack24_scalar<Swap>(src + i * 4, dst + i * 3, n - i);
+}
+
+template <bool Swap>
+PROJECTCODE_TARGET("ssse3")
+void expand32_ssse3(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m128i mask = Swap ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                              : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for (; i + 6 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+    }
+    expand32_scalar<Swap>(src + i * 3, dst + i * 4, n - i);
+}
+
+// ---- AVX2 -----------------------------------------------------------------------------
+
+PROJECTCODE_TARGET("avx2")
+inline void fill24_avx2(std::uint8_t *dst, std::size_t n, const std::uint8_t *px) {
+    alignas(32) std::uint8_t pattern[96];
+    fill24_scalar(pattern, 32, px);
+    const __m256i v0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern));
+    const __m256i v1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern + 32));
+    const __m256i v2 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern + 64));
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32, dst += 96) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), v0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), v1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 64), v2);
+    }
+    fill24_sse2(dst, n - i, px);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline void fill32_avx2(std::uint8_t *dst, std::size_t n, std::uint32_t v) {
+    const __m256i x = _mm256_set1_epi32(static_cast<int>(v));
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), x);
+    fill32_scalar(dst + i * 4, n - i, v);
+}
+
+// Ten pixels per iteration: two 15-byte groups, one per 128-bit lane.
+PROJECTCODE_TARGET("avx2")
+inline void swap_rb24_avx2(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15,
+                                          2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 11 <= n; i += 10) {
+        const std::uint8_t *s = src + i * 3;
+        const __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 15)), 1);
+        const __m256i r = _mm256_shuffle_epi8(v, mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3), _mm256_castsi256_si128(r));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3 + 15), _mm256_extracti128_si256(r, 1));
+    }
+    swap_rb24_ssse3(src + i * 3, dst + i * 3, n - i);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline void swap_rb32_avx2(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_shuffle_epi8(v, mask));
+    }
+    swap_rb32_ssse3(src + i * 4, dst + i * 4, n - i);
+}
+
+// Eight pixels to 24 bytes: shuffle within each lane, then close the gap between lanes.
+template <bool Swap>
+PROJECTCODE_TARGET("avx2")
+void pack24_avx2(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m256i mask = Swap ? _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                              : _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i order = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    std::size_t i = 0;
+    for (; i + 11 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+        const __m256i r = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, mask), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 3), r);
+    }
+    pack24_ssse3<Swap>(src + i * 4, dst + i * 3, n - i);
+}
+
+template <bool Swap>
+PROJECTCODE_TARGET("avx2")
+void expand32_avx2(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    const __m256i mask = Swap ? _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                                                 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                              : _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for (; i + 10 <= n; i += 8) {
+        const std::uint8_t *s = src + i * 3;
+        const __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4),
+                            _mm256_or_si256(_mm256_shuffle_epi8(v, mask), alpha));
+    }
+    expand32_ssse3<Swap>(src + i * 3, dst + i * 4, n - i);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline __m256i blend_lanes_avx2(__m256i d16, __m256i sa16, __m256i ia16) {
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(d16, ia16), sa16);
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline void blend32_avx2(std::uint8_t *dst, std::size_t n, std::uint32_t color) {
+    std::uint8_t s[4];
+    store_u32(s, color);
+    const unsigned a = s[3];
+    const short sa[4] = {static_cast<short>(s[0] * a), static_cast<short>(s[1] * a), static_cast<short>(s[2] * a),
+                         static_cast<short>(255 * a)};
+    const __m256i sa16 = _mm256_setr_epi16(sa[0], sa[1], sa[2], sa[3], sa[0], sa[1], sa[2], sa[3], sa[0], sa[1],
+                                           sa[2], sa[3], sa[0], sa[1], sa[2], sa[3]);
+    const __m256i ia16 = _mm256_set1_epi16(static_cast<short>(255 - a));
+    const __m256i zero = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i * 4));
+        const __m256i lo = blend_lanes_avx2(_mm256_unpacklo_epi8(d, zero), sa16, ia16);
+        const __m256i hi = blend_lanes_avx2(_mm256_unpackhi_epi8(d, zero), sa16, ia16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    blend32_sse2(dst + i * 4, n - i, color);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline __m256i blend_row_lanes_avx2(__m256i d16, __m256i s16) {
+    const __m256i a16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, 0xFF), 0xFF);
+    const __m256i alpha_lane = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    const __m256i s_opaque =
+        _mm256_or_si256(_mm256_andnot_si256(alpha_lane, s16), _mm256_and_si256(alpha_lane, _mm256_set1_epi16(255)));
+    const __m256i ia16 = _mm256_sub_epi16(_mm256_set1_epi16(255), a16);
+    return blend_lanes_avx2(d16, _mm256_mullo_epi16(s_opaque, a16), ia16);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline void blend32_row_avx2(std::uint8_t *dst, const std::uint8_t *src, std::size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i * 4));
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+        const __m256i lo = blend_row_lanes_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+        const __m256i hi = blend_row_lanes_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    blend32_row_sse2(dst + i * 4, src + i * 4, n - i);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline __m256i over_lanes_avx2(__m256i d16, __m256i s16, __m256i alpha16) {
+    const __m256i zero = _mm256_setzero_si256();
+    s16 = blend_lanes_avx2(s16, zero, alpha16);
+    const __m256i a16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, 0xFF), 0xFF);
+    return _mm256_add_epi16(s16, blend_lanes_avx2(d16, zero, _mm256_sub_epi16(_mm256_set1_epi16(255), a16)));
+}
+
+PROJECTCODE_TARGET("avx2")
+inline void over32_row_avx2(std::uint8_t *dst, const std::uint8_t *src, std::size_t n, unsigned alpha) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha16 = _mm256_set1_epi16(static_cast<short>(alpha));
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+        if (_mm256_testz_si256(s, s)) continue; // transparent
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i * 4));
+        const __m256i lo = over_lanes_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), alpha16);
+        const __m256i hi = over_lanes_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), alpha16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    over32_row_sse2(dst + i * 4, src + i * 4, n - i, alpha);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline std::uint32_t equal_mask_avx2(const std::uint8_t *p, __m256i v) {
+    return static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), v)));
+}
+
+PROJECTCODE_TARGET("avx2")
+inline std::size_t match24_avx2(const std::uint8_t *p, std::size_t n, const std::uint8_t *px) {
+    alignas(32) std::uint8_t pattern[96];
+    fill24_scalar(pattern, 32, px);
+    const __m256i v0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern));
+    const __m256i v1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern + 32));
+    const __m256i v2 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern + 64));
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const std::uint8_t *q = p + i * 3;
+        const std::uint32_t eq[3] = {equal_mask_avx2(q, v0), equal_mask_avx2(q + 32, v1), equal_mask_avx2(q + 64, v2)};
+        const std::size_t run = first_mismatch24(eq, 32);
+        if (run < 32) return i + run;
+    }
+    return i + match24_sse2(p + i * 3, n - i, px);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline std::size_t match24_back_avx2(const std::uint8_t *end, std::size_t n, const std::uint8_t *px) {
+    alignas(32) std::uint8_t pattern[96];
+    fill24_scalar(pattern, 32, px);
+    const __m256i v0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern));
+    const __m256i v1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern + 32));
+    const __m256i v2 = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern + 64));
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const std::uint8_t *q = end - (i + 32) * 3;
+        const std::uint32_t eq[3] = {equal_mask_avx2(q, v0), equal_mask_avx2(q + 32, v1), equal_mask_avx2(q + 64, v2)};
+        const std::size_t run = last_mismatch24(eq, 32);
+        if (run < 32) return i + run;
+    }
+    return i + match24_back_sse2(end - i * 3, n - i, px);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline std::size_t match32_avx2(const std::uint8_t *p, std::size_t n, std::uint32_t v) {
+    const __m256i x = _mm256_set1_epi32(static_cast<int>(v));
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const std::uint32_t miss = ~equal_mask_avx2(p + i * 4, x);
+        if (miss) return i + lowest_bit(miss) / 4;
+    }
+    return i + match32_sse2(p + i * 4, n - i, v);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline std::size_t match32_back_avx2(const std::uint8_t *end, std::size_t n, std::uint32_t v) {
+    const __m256i x = _mm256_set1_epi32(static_cast<int>(v));
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const std::uint32_t miss = ~equal_mask_avx2(end - (i + 8) * 4, x);
+        if (miss) return i + 7 - highest_bit(miss) / 4;
+    }
+    return i + match32_back_sse2(end - i * 4, n - i, v);
+}
+
+PROJECTCODE_TARGET("avx2")
+inline __m256i abs_diff_avx2(const std::uint8_t *a, const std::uint8_t *b) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+    return _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x));
+}
+
+PROJECTCODE_TARGET("avx2")
+inline __m256i square_sum_avx2(__m256i d) {
+    const __m256i lo = _mm256_unpacklo_epi8(d, _mm256_setzero_si256());
+    const __m256i hi = _mm256_unpackhi_epi8(d, _mm256_setzero_si256());
+    return _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi));
+}
+
+PROJECTCODE_TARGET("avx2")
+inline std::uint32_t over_mask_avx2(__m256i d, __m256i t) {
+    return ~static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(d, t), _mm256_setzero_si256())));
+}
+
+// 32 pixels per step; the 96 byte masks are folded as two groups of 16 pixels.
+PROJECTCODE_TARGET("avx2")
+inline Diff24 diff24_avx2(const std::uint8_t *a, const std::uint8_t *b, std::size_t n, unsigned tolerance) {
+    const __m256i t = _mm256_set1_epi8(static_cast<char>(std::min(tolerance, 255u)));
+    __m256i top = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    alignas(32) std::uint32_t lanes[8];
+    Diff24 r;
+    std::size_t i = 0;
+    unsigned steps = 0;
+    for (; i + 32 <= n; i += 32) {
+        const std::uint8_t *p = a + i * 3;
+        const std::uint8_t *q = b + i * 3;
+        const __m256i d0 = abs_diff_avx2(p, q);
+        const __m256i d1 = abs_diff_avx2(p + 32, q + 32);
+        const __m256i d2 = abs_diff_avx2(p + 64, q + 64);
+        top = _mm256_max_epu8(top, _mm256_max_epu8(d0, _mm256_max_epu8(d1, d2)));
+        acc = _mm256_add_epi32(acc, _mm256_add_epi32(square_sum_avx2(d0), _mm256_add_epi32(square_sum_avx2(d1),
+                                                                                           square_sum_avx2(d2))));
+        if (tolerance < 255) {
+            const std::uint32_t m0 = over_mask_avx2(d0, t);
+            const std::uint32_t m1 = over_mask_avx2(d1, t);
+            const std::uint32_t m2 = over_mask_avx2(d2, t);
+            add_pixels24(r, m0 | std::uint64_t{m1 & 0xFFFFu} << 32, i);
+            add_pixels24(r, m1 >> 16 | std::uint64_t{m2} << 16, i + 16);
+        }
+        if (++steps == 2048 || i + 64 > n) {
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+            for (std::uint32_t v : lanes) r.sum_sq += v;
+            acc = _mm256_setzero_si256();
+            steps = 0;
+        }
+    }
+    alignas(32) std::uint8_t bytes[32];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(bytes), top);
+    for (std::uint8_t v : bytes) r.max_delta = std::max<unsigned>(r.max_delta, v);
+    merge_diff(r, diff24_sse2(a + i * 3, b + i * 3, n - i, tolerance), i);
+    return r;
+}
+
+PROJECTCODE_TARGET("avx2")
+inline void accumulate8_avx2(std::uint16_t *acc, const std::uint8_t *src, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        const __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 16)));
+        auto *a = reinterpret_cast<__m256i *>(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), lo));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi16(_mm256_loadu_si256(a + 1), hi));
+    }
+    accumulate8_sse2(acc + i, src + i, n - i);
+}
+
+#endif // PROJECTCODE_X86
+
+inline SimdLevel detect_level() {
+#if PROJECTCODE_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    const int max_leaf = r[0];
+    __cpuid(r, 1);
+    const bool sse2 = (r[3] & (1 << 26)) != 0;
+    const bool ssse3 = (r[2] & (1 << 9)) != 0;
+    const bool os_avx = (r[2] & (1 << 27)) != 0 && (r[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (max_leaf >= 7 && os_avx) {
+        __cpuidex(r, 7, 0);
+        avx2 = (r[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool ssse3 = __builtin_cpu_supports("ssse3");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2 && ssse3) return SimdLevel::avx2;
+    if (ssse3 && sse2) return SimdLevel::ssse3;
+    if (sse2) return SimdLevel::sse2;
+#endif
+    return SimdLevel::scalar;
+}
+
+struct Table {
+    SimdLevel level;
+    void (*fill24)(std::uint8_t *, std::size_t, const std::uint8_t *);
+    void (*fill32)(std::uint8_t *, std::size_t, std::uint32_t);
+    void (*swap_rb24)(const std::uint8_t *, std::uint8_t *, std::size_t);
+    void (*swap_rb32)(const std::uint8_t *, std::uint8_t *, std::size_t);
+    void (*pack24)(const std::uint8_t *, std::uint8_t *, std::size_t);
+    void (*pack24_swap)(const std::uint8_t *, std::uint8_t *, std::size_t);
+    void (*expand32)(const std::uint8_t *, std::uint8_t *, std::size_t);
+    void (*expand32_swap)(const std::uint8_t *, std::uint8_t *, std::size_t);
+    void (*blend32)(std::uint8_t *, std::size_t, std::uint32_t);
+    void (*blend32_row)(std::uint8_t *, const std::uint8_t *, std::size_t);
+    std::size_t (*match24)(const std::uint8_t *, std::size_t, const std::uint8_t *);
+    std::size_t (*match24_back)(const std::uint8_t *, std::size_t, const std::uint8_t *);
+    std::size_t (*match32)(const std::uint8_t *, std::size_t, std::uint32_t);
+    std::size_t (*match32_back)(const std::uint8_t *, std::size_t, std::uint32_t);
+    Diff24 (*diff24)(const std::uint8_t *, const std::uint8_t *, std::size_t, unsigned);
+    void (*accumulate8)(std::uint16_t *, const std::uint8_t *, std::size_t);
+    void (*over32_row)(std::uint8_t *, const std::uint8_t *, std::size_t, unsigned);
+};
+
+inline Table make_table(SimdLevel level) {
+    Table t{SimdLevel::scalar,     fill24_scalar,          fill32_scalar,        swap_rb24_scalar,
+            swap_rb32_scalar,      pack24_scalar<false>,   pack24_scalar<true>,  expand32_scalar<false>,
+            expand32_scalar<true>, blend32_scalar,         blend32_row_scalar,   match24_scalar,
+            match24_back_scalar,   match32_scalar,         match32_back_scalar,  diff24_scalar,
+            accumulate8_scalar,    over32_row_scalar};
+#if PROJECTCODE_X86
+    if (level >= SimdLevel::sse2) {
+        t.level = SimdLevel::sse2;
+        t.fill24 = fill24_sse2;
+        t.fill32 = fill32_sse2;
+        t.swap_rb32 = swap_rb32_sse2;
+        t.blend32 = blend32_sse2;
+        t.blend32_row = blend32_row_sse2;
+        t.match24 = match24_sse2;
+        t.match24_back = match24_back_sse2;
+        t.match32 = match32_sse2;
+        t.match32_back = match32_back_sse2;
+        t.diff24 = diff24_sse2;
+        t.accumulate8 = accumulate8_sse2;
+        t.over32_row = over32_row_sse2;
+    }
+    if (level >= SimdLevel::ssse3) {
+        t.level = SimdLevel::ssse3;
+        t.swap_rb24 = swap_rb24_ssse3;
+        t.swap_rb32 = swap_rb32_ssse3;
+        t.pack24 = pack24_ssse3<false>;
+        t.pack24_swap = pack24_ssse3<true>;
+        t.expand32 = expand32_ssse3<false>;
+        t.expand32_swap = expand32_ssse3<true>;
+    }
+    if (level >= SimdLevel::avx2) {
+        t.level = SimdLevel::avx2;
+        t.fill24 = fill24_avx2;
+        t.fill32 = fill32_avx2;
+        t.swap_rb24 = swap_rb24_avx2;
+        t.swap_rb32 = swap_rb32_avx2;
+        t.pack24 = pack24_avx2<false>;
+        t.pack24_swap = pack24_avx2<true>;
+        t.expand32 = expand32_avx2<false>;
+        t.expand32_swap = expand32_avx2<true>;
+        t.blend32 = blend32_avx2;
+        t.blend32_row = blend32_row_avx2;
+        t.match24 = match24_avx2;
+        t.match24_back = match24_back_avx2;
+        t.match32 = match32_avx2;
+        t.match32_back = match32_back_avx2;
+        t.diff24 = diff24_avx2;
+        t.accumulate8 = accumulate8_avx2;
+        t.over32_row = over32_row_avx2;
+    }
+#else
+    (void)level;
+#endif
+    return t;
+}
+
+inline Table &table() {
+    static Table t = make_table(detect_level());
+    return t;
+}
+
+} // namespace detail
+
+// Best level the CPU supports, and the level currently in use.
+inline SimdLevel detected_level() {
+    static const SimdLevel level = detail::detect_level();
+    return level;
+}
+inline SimdLevel active_level() { return detail::table().level; }
+
+// Use at most `level` (clamped to what the CPU supports), e.g. to benchmark or check the
+// fallbacks. Not thread-safe: call it before drawing starts.
+inline void set_level(SimdLevel level) { detail::table() = detail::make_table(std::min(level, detected_level())); }
+
+// Fill n pixels of 3 bytes each with `px`.
+inline void fill24(std::uint8_t *dst, std::size_t n, const std::uint8_t *px) { detail::table().fill24(dst, n, px); }
+// Fill n 4-byte pixels with `v` (in memory byte order).
+inline void fill32(std::uint8_t *dst, std::size_t n, std::uint32_t v) { detail::table().fill32(dst, n, v); }
+// RGB <-> BGR on packed 24-bit pixels. src may equal dst.
+inline void swap_rb24(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    detail::table().swap_rb24(src, dst, n);
+}
+// RGBA <-> BGRA. src may equal dst.
+inline void swap_rb32(const std::uint8_t *src, std::uint8_t *dst, std::size_t n) {
+    detail::table().swap_rb32(src, dst, n);
+}
+// Drop the alpha byte of 32-bit pixels, optionally swapping R and B.
+inline void pack24(const std::uint8_t *src, std::uint8_t *dst, std::size_t n, bool swap_rb) {
+    (swap_rb ? detail::table().pack24_swap : detail::table().pack24)(src, dst, n);
+}
+// Widen 24-bit pixels to 32 bits with opaque alpha, optionally swapping R and B.
+inline void expand32(const std::uint8_t *src, std::uint8_t *dst, std::size_t n, bool swap_rb) {
+    (swap_rb ? detail::table().expand32_swap : detail::table().expand32)(src, dst, n);
+}
+// Source-over of one color (straight alpha in byte 3) onto n 32-bit pixels.
+inline void blend32(std::uint8_t *dst, std::size_t n, std::uint32_t color) {
+    detail::table().blend32(dst, n, color);
+}
+// Source-over of n 32-bit pixels onto n others, same channel order.
+inline void blend32_row(std::uint8_t *dst, const std::uint8_t *src, std::size_t n) {
+    detail::table().blend32_row(dst, src, n);
+}
+// Source-over of n premultiplied 32-bit pixels at opacity alpha (0-255) onto n others;
+// layer stacks composite with it. Transparent source pixels are skipped.
+inline void over32_row(std::uint8_t *dst, const std::uint8_t *src, std::size_t n, unsigned alpha = 255) {
+    detail::table().over32_row(dst, src, n, alpha);
+}
+
+// Leading / trailing run of 3-byte pixels equal to `px` in n pixels from p / before end.
+inline std::size_t match24(const std::uint8_t *p, std::size_t n, const std::uint8_t *px) {
+    return detail::table().match24(p, n, px);
+}
+inline std::size_t match24_back(const std::uint8_t *end, std::size_t n, const std::uint8_t *px) {
+    return detail::table().match24_back(end, n, px);
+}
+// The same for 4-byte pixels equal to `v` (in memory byte order).
+inline std::size_t match32(const std::uint8_t *p, std::size_t n, std::uint32_t v) {
+    return detail::table().match32(p, n, v);
+}
+inline std::size_t match32_back(const std::uint8_t *end, std::size_t n, std::uint32_t v) {
+    return detail::table().match32_back(end, n, v);
+}
+
+// Compare n 3-byte pixels at a and b channel by channel; pixels count as differing when a
+// channel delta exceeds `tolerance`.
+inline Diff24 diff24(const std::uint8_t *a, const std::uint8_t *b, std::size_t n, unsigned tolerance = 0) {
+    return detail::table().diff24(a, b, n, tolerance);
+}
+
+// acc[i] += src[i] for n bytes, wrapping at 16 bits; box filters sum rows with it.
+inline void accumulate8(std::uint16_t *acc, const std::uint8_t *src, std::size_t n) {
+    detail::table().accumulate8(acc, src, n);
+}
+
+// Typed fill used by the canvases and rasterizers. Short runs (line pixels, disc rims)
+// stay inline; longer ones go to the vector kernels.
+template <class T>
+void fill(T *dst, std::size_t n, const T &value) {
+    if constexpr (!std::is_trivially_copyable_v<T> || (sizeof(T) != 1 && sizeof(T) != 3 && sizeof(T) != 4)) {
+        std::fill(dst, dst + n, value);
+    } else if constexpr (sizeof(T) == 1) {
+        unsigned char byte;
+        std::memcpy(&byte, &value, 1);
+        std::memset(dst, byte, n);
+    } else {
+        if (n < 16) {
+            std::fill(dst, dst + n, value);
+            return;
+        }
+        if constexpr (sizeof(T) == 3) {
+            fill24(reinterpret_cast<std::uint8_t *>(dst), n, reinterpret_cast<const std::uint8_t *>(&value));
+        } else {
+            std::uint32_t v;
+            std::memcpy(&v, &value, 4);
+            fill32(reinterpret_cast<std::uint8_t *>(dst), n, v);
+        }
+    }
+}
+
+// Typed run matching: how many pixels from p onwards (match) or just before `end`
+// (match_back), at most n, are bytewise equal to `value`. Flood fill uses these to find
+// span ends a vector at a time.
+template <class T>
+std::size_t match(const T *p, std::size_t n, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "pixels are compared bytewise");
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(p);
+    if constexpr (sizeof(T) == 3) {
+        return match24(bytes, n, reinterpret_cast<const std::uint8_t *>(&value));
+    } else if constexpr (sizeof(T) == 4) {
+        std::uint32_t v;
+        std::memcpy(&v, &value, 4);
+        return match32(bytes, n, v);
+    } else {
+        std::size_t i = 0;
+        while (i < n && std::memcmp(p + i, &value, sizeof(T)) == 0) ++i;
+        return i;
+    }
+}
+
+template <class T>
+std::size_t match_back(const T *end, std::size_t n, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "pixels are compared bytewise");
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(end);
+    if constexpr (sizeof(T) == 3) {
+        return match24_back(bytes, n, reinterpret_cast<const std::uint8_t *>(&value));
+    } else if constexpr (sizeof(T) == 4) {
+        std::uint32_t v;
+        std::memcpy(&v, &value, 4);
+        return match32_back(bytes, n, v);
+    } else {
+        std::size_t i = 0;
+        while (i < n && std::memcmp(end - i - 1, &value, sizeof(T)) == 0) ++i;
+        return i;
+    }
+}
+
+} // namespace kernels
+
+} // namespace projectcode
@@ -0,0 +1,423 @@
+#pragma once
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace projectcode {
+
+namespace detail {
+
+// --- Checksums --------------------------------------------------------------------------
+
+// CRC-32 (PNG chunks), slice-by-8: eight table lookups consume eight bytes per step.
+struct Crc32Tables {
+    std::array<std::array<std::uint32_t, 256>, 8> t{};
+    Crc32Tables() {
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            for (std::size_t s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+inline std::uint32_t crc32(std::uint32_t crc, const std::uint8_t *p, std::size_t n) {
+    static const Crc32Tables tables;
+    const auto &t = tables.t;
+    crc = ~crc;
+    while (n >= 8) {
+        const std::uint32_t lo = crc ^ (static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 |
+                                        static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^ t[3][p[4]] ^
+              t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Adler-32 (zlib stream trailer). Sums are reduced once per 5552 bytes, the longest run
+// that cannot overflow 32 bits.
+constexpr std::uint32_t adler_base = 65521u;
+
+inline std::uint32_t adler32(std::uint32_t adler, const std::uint8_t *p, std::size_t n) {
+    std::uint32_t a = adler & 0xFFFF;
+    std::uint32_t b = adler >> 16;
+    while (n > 0) {
+        std::size_t k = std::min<std::size_t>(n, 5552);
+        n -= k;
+        for (; k >= 4; k -= 4, p += 4) {
+            b += (a += p[0]);
+            b += (a += p[1]);
+            b += (a += p[2]);
+            b += (a += p[3]);
+        }
+        while (k--) b += (a += *p++);
+        a %= adler_base;
+        b %= adler_base;
+    }
+    return a | (b << 16);
+}
+
+// Adler-32 of A followed by B, from adler(A), adler(B) and the length of B.
+inline std::uint32_t adler32_combine(std::uint32_t a1, std::uint32_t a2, std::size_t len2) {
+    const std::uint32_t rem = static_cast<std::uint32_t>(len2 % adler_base);
+    std::uint32_t sum1 = a1 & 0xFFFF;
+    std::uint32_t sum2 = static_cast<std::uint32_t>((static_cast<std::uint64_t>(rem) * sum1) % adler_base);
+    sum1 += (a2 & 0xFFFF) + adler_base - 1;
+    sum2 += (a1 >> 16) + (a2 >> 16) + adler_base - rem;
+    if (sum1 >= adler_base) sum1 -= adler_base;
+    if (sum1 >= adler_base) sum1 -= adler_base;
+    if (sum2 >= (adler_base << 1)) sum2 -= (adler_base << 1);
+    if (sum2 >= adler_base) sum2 -= adler_base;
+    return sum1 | (sum2 << 16);
+}
+
+// --- Deflate ----------------------------------------------------------------------------
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<std::uint8_t> &out) : out_(out) {}
+
+    void put(std::uint32_t bits, unsigned count) {
+        acc_ |= static_cast<std::uint64_t>(bits) << used_;
+        used_ += count;
+        while (used_ >= 8) {
+            out_.push_back(static_cast<std::uint8_t>(acc_));
+            acc_ >>= 8;
+            used_ -= 8;
+        }
+    }
+
+    void align() {
+        if (used_ > 0) put(0, 8 - used_);
+    }
+
+private:
+    std::vector<std::uint8_t> &out_;
+    std::uint64_t acc_ = 0;
+    unsigned used_ = 0;
+};
+
+// Deflate with LZ77 matching over hash chains and the fixed Huffman code. Turtle drawings
+// are dominated by long runs that compress to a few bits per 258-byte match, so the fixed
+// code costs little over a dynamic one and keeps the encoder small.
+class DeflateEncoder {
+public:
+    // Compress `n` bytes into `out` as one fixed-Huffman block. A final chunk sets BFINAL;
+    // other chunks end with an empty stored block that byte-aligns the stream, so
+    // independently compressed chunks can simply be concatenated.
+    void compress(const std::uint8_t *data, std::size_t n, bool final, std::vector<std::uint8_t> &out) {
+        static const Tables tables;
+        BitWriter bits(out);
+        bits.put(final ? 1u : 0u, 1);
+        bits.put(1, 2); // BTYPE = fixed Huffman
+
+        head_.assign(hash_size, -1);
+        prev_.resize(window);
+        std::size_t i = 0;
+        while (i < n) {
+            unsigned best_len = 0;
+            std::size_t best_dist = 0;
+            if (i + min_match <= n) {
+                const std::size_t h = hash(data + i);
+                long cand = head_[h];
+                const std::size_t max_len = std::min<std::size_t>(max_match, n - i);
+                for (int chain = 0; cand >= 0 && chain < max_chain; ++chain) {
+                    const std::size_t c = static_cast<std::size_t>(cand);
+                    if (i - c > window) break;
+                    if (data[c + best_len] == data[i + best_len]) {
+                        unsigned len = 0;
+                        while (len < max_len && data[c + len] == data[i + len]) ++len;
+                        if (len > best_len) {
+                            best_len = len;
+                            best_dist = i - c;
+                            if (len == max_len) break;
+                        }
+                    }
+                    cand = prev_[c & (window - 1)];
+                }
+                insert(i, h);
+            }
+
+            if (best_len >= min_match) {
+                put_symbol(bits, tables, tables.length_code[best_len]);
+                bits.put(tables.length_extra_value[best_len], tables.length_extra_bits[best_len]);
+                const unsigned dcode = distance_code(best_dist);
+                bits.put(tables.dist_code_bits[dcode], 5);
+                bits.put(static_cast<std::uint32_t>(best_dist - tables.dist_base[dcode]), tables.dist_extra[dcode]);
+                const std::size_t end = i + best_len;
+                for (++i; i < end; ++i) {
+                    if (i + min_match <= n) insert(i, hash(data + i));
+                }
+            } else {
+                put_symbol(bits, tables, data[i]);
+                ++i;
+            }
+        }
+        put_symbol(bits, tables, 256); // end of block
+
+        if (!final) {
+            bits.put(0, 3); // stored block, not final
+            bits.align();
+            bits.put(0x0000, 16);
+            bits.put(0xFFFF, 16);
+        }
+        bits.align();
+    }
+
+private:
+    static constexpr std::size_t window = 32768;
+    static constexpr std::size_t hash_size = 1u << 15;
+    static constexpr unsigned min_match = 3;
+    static constexpr unsigned max_match = 258;
+    static constexpr int max_chain = 24;
+
+    std::vector<long> head_;
+    std::vector<long> prev_;
+
+    struct Tables {
+        std::array<std::uint16_t, 288> code{}; // bit-reversed fixed codes
+        std::array<std::uint8_t, 288> code_len{};
+        std::array<std::uint16_t, 259> length_code{};
+        std::array<std::uint8_t, 259> length_extra_bits{};
+        std::array<std::uint16_t, 259> length_extra_value{};
+        std::array<std::uint16_t, 30> dist_base{};
+        std::array<std::uint8_t, 30> dist_extra{};
+        std::array<std::uint8_t, 30> dist_code_bits{}; // bit-reversed 5-bit distance codes
+
+        Tables() {
+            for (unsigned s = 0; s < 288; ++s) {
+                unsigned c;
+                unsigned len;
+                if (s < 144) {
+                    c = 0x30 + s;
+                    len = 8;
+                } else if (s < 256) {
+                    c = 0x190 + (s - 144);
+                    len = 9;
+                } else if (s < 280) {
+                    c = s - 256;
+                    len = 7;
+                } else {
+                    c = 0xC0 + (s - 280);
+                    len = 8;
+                }
+                code[s] = static_cast<std::uint16_t>(reverse(c, len));
+                code_len[s] = static_cast<std::uint8_t>(len);
+            }
+
+            static const std::uint16_t len_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                       31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const std::uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                       2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            for (unsigned k = 0; k < 29; ++k) {
+                const unsigned last = k == 28 ? 258 : len_base[k + 1] - 1u;
+                for (unsigned l = len_base[k]; l <= last && l <= 258; ++l) {
+                    length_code[l] = static_cast<std::uint16_t>(257 + k);
+                    length_extra_bits[l] = len_extra[k];
+                    length_extra_value[l] = static_cast<std::uint16_t>(l - len_base[k]);
+                }
+            }
+
+            static const std::uint16_t d_base[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                                     33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                                     1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+            for (unsigned k = 0; k < 30; ++k) {
+                dist_base[k] = d_base[k];
+                dist_extra[k] = static_cast<std::uint8_t>(k < 2 ? 0 : k / 2 - 1);
+                dist_code_bits[k] = static_cast<std::uint8_t>(reverse(k, 5));
+            }
+        }
+
+        static unsigned reverse(unsigned v, unsigned bits) {
+            unsigned r = 0;
+            for (unsigned b = 0; b < bits; ++b) r |= ((v >> b) & 1u) << (bits - 1 - b);
+            return r;
+        }
+    };
+
+    static std::size_t hash(const std::uint8_t *p) {
+        const std::uint32_t v = static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 |
+                                static_cast<std::uint32_t>(p[2]) << 16;
+        return (v * 2654435761u) >> (32 - 15);
+    }
+
+    void insert(std::size_t i, std::size_t h) {
+        prev_[i & (window - 1)] = head_[h];
+        head_[h] = static_cast<long>(i);
+    }
+
+    static unsigned distance_code(std::size_t dist) {
+        // Codes pair up per power of two: 2*log2(dist-1) plus the next bit below the top.
+        if (dist <= 4) return static_cast<unsigned>(dist - 1);
+        std::size_t d = dist - 1;
+        unsigned top = 0;
+        while ((d >> (top + 1)) != 0) ++top;
+        return 2 * top + static_cast<unsigned>((d >> (top - 1)) & 1u);
+    }
+
+    static void put_symbol(BitWriter &bits, const Tables &t, unsigned s) { bits.put(t.code[s], t.code_len[s]); }
+};
+
+// --- PNG --------------------------------------------------------------------------------
+
+inline void store_u32be(std::uint8_t *p, std::uint32_t v) {
+    p[0] = static_cast<std::uint8_t>(v >> 24);
+    p[1] = static_cast<std::uint8_t>(v >> 16);
+    p[2] = static_cast<std::uint8_t>(v >> 8);
+    p[3] = static_cast<std::uint8_t>(v);
+}
+
+inline std::uint8_t paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<std::uint8_t>(a);
+    if (pb <= pc) return static_cast<std::uint8_t>(b);
+    return static_cast<std::uint8_t>(c);
+}
+
+// Filter one row (bpp bytes per pixel) with each of the five PNG filters and keep the one
+// with the smallest sum of absolute signed residuals, the usual adaptive heuristic.
+// `out` receives the filter type byte followed by the filtered row.
+inline void filter_row(const std::uint8_t *cur, const std::uint8_t *prev, std::size_t len, std::size_t bpp,
+                       std::uint8_t *out, std::vector<std::uint8_t> &scratch) {
+    scratch.resize(len * 5);
+    std::uint8_t *f[5] = {scratch.data(), scratch.data() + len, scratch.data() + 2 * len, scratch.data() + 3 * len,
+                          scratch.data() + 4 * len};
+    unsigned long sums[5] = {0, 0, 0, 0, 0};
+    auto cost = [](std::uint8_t v) { return static_cast<unsigned long>(v < 128 ? v : 256 - v); };
+    for (std::size_t i = 0; i < len; ++i) {
+        const int x = cur[i];
+        const int a = i >= bpp ? cur[i - bpp] : 0;
+        const int b = prev ? prev[i] : 0;
+        const int c = (prev && i >= bpp) ? prev[i - bpp] : 0;
+        f[0][i] = static_cast<std::uint8_t>(x);
+        f[1][i] = static_cast<std::uint8_t>(x - a);
+        f[2][i] = static_cast<std::uint8_t>(x - b);
+        f[3][i] = static_cast<std::uint8_t>(x - ((a + b) >> 1));
+        f[4][i] = static_cast<std::uint8_t>(x - paeth(a, b, c));
+        for (int k = 0; k < 5; ++k) sums[k] += cost(f[k][i]);
+    }
+    int best = 0;
+    for (int k = 1; k < 5; ++k) {
+        if (sums[k] < sums[best]) best = k;
+    }
+    out[0] = static_cast<std::uint8_t>(best);
+    std::memcpy(out + 1, f[best], len);
+}
+
+// Encode an 8-bit RGB image; row(y, dst) writes the 3 * width bytes of row y. Rows are
+// split into chunks that are filtered, deflated and checksummed independently, in
+// parallel when a pool is given, then stitched into one zlib stream.
+template <class RowFn>
+bool write_png(const std::string &path, std::size_t width, std::size_t height, RowFn row, ThreadPool *pool) {
+    if (width == 0 || height == 0 || width > 0x7FFFFFFFu || height > 0x7FFFFFFFu) return false;
+    const std::size_t row_bytes = width * 3;
+    const std::size_t rows_per_chunk = std::max<std::size_t>(1, (std::size_t{256} << 10) / (row_bytes + 1));
+    const std::size_t chunks = (height + rows_per_chunk - 1) / rows_per_chunk;
+
+    struct Chunk {
+        std::vector<std::uint8_t> deflated;
+        std::uint32_t adler = 1;
+        std::size_t raw_size = 0;
+    };
+    std::vector<Chunk> parts(chunks);
+
+    auto encode_chunk = [&](std::size_t k) {
+        const std::size_t y0 = k * rows_per_chunk;
+        const std::size_t y1 = std::min(height, y0 + rows_per_chunk);
+        std::vector<std::uint8_t> filtered((y1 - y0) * (row_bytes + 1));
+        std::vector<std::uint8_t> scratch;
+        std::vector<std::uint8_t> cur(row_bytes);
+        std::vector<std::uint8_t> prev(row_bytes);
+        if (y0 > 0) row(y0 - 1, prev.data());
+        for (std::size_t y = y0; y < y1; ++y) {
+            row(y, cur.data());
+            filter_row(cur.data(), y > 0 ? prev.data() : nullptr, row_bytes, 3,
+                       filtered.data() + (y - y0) * (row_bytes + 1), scratch);
+            cur.swap(prev);
+        }
+        Chunk &c = parts[k];
+        c.raw_size = filtered.size();
+        c.adler = adler32(1, filtered.data(), filtered.size());
+        DeflateEncoder enc;
+        enc.compress(filtered.data(), filtered.size(), k + 1 == chunks, c.deflated);
+    };
+    if (pool && chunks > 1) {
+        pool->parallel_for(chunks, encode_chunk);
+    } else {
+        for (std::size_t k = 0; k < chunks; ++k) encode_chunk(k);
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    auto write_chunk = [&](const char *type, const std::uint8_t *a, std::size_t na, const std::uint8_t *b,
+                           std::size_t nb) {
+        std::uint8_t head[8];
+        store_u32be(head, static_cast<std::uint32_t>(na + nb));
+        std::memcpy(head + 4, type, 4);
+        std::uint32_t crc = crc32(0, head + 4, 4);
+        crc = crc32(crc, a, na);
+        crc = crc32(crc, b, nb);
+        std::uint8_t tail[4];
+        store_u32be(tail, crc);
+        out.write(reinterpret_cast<const char *>(head), 8);
+        out.write(reinterpret_cast<const char *>(a), static_cast<std::streamsize>(na));
+        out.write(reinterpret_cast<const char *>(b), static_cast<std::streamsize>(nb));
+        out.write(reinterpret_cast<const char *>(tail), 4);
+    };
+
+    static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.write(reinterpret_cast<const char *>(signature), 8);
+
+    std::uint8_t ihdr[13];
+    store_u32be(ihdr, static_cast<std::uint32_t>(width));
+    store_u32be(ihdr + 4, static_cast<std::uint32_t>(height));
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 2;  // color type: truecolor
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // no interlace
+    write_chunk("IHDR", ihdr, 13, nullptr, 0);
+
+    // One IDAT per compressed chunk; the zlib header rides on the first, the Adler-32 of
+    // the whole filtered stream on the last.
+    std::uint32_t adler = 1;
+    for (std::size_t k = 0; k < chunks; ++k) adler = adler32_combine(adler, parts[k].adler, parts[k].raw_size);
+    for (std::size_t k = 0; k < chunks; ++k) {
+        std::vector<std::uint8_t> &d = parts[k].deflated;
+        if (k + 1 == chunks) {
+            std::uint8_t trailer[4];
+            store_u32be(trailer, adler);
+            d.insert(d.end(), trailer, trailer + 4);
+        }
+        static const std::uint8_t zlib_header[2] = {0x78, 0x01};
+        if (k == 0) {
+            write_chunk("IDAT", zlib_header, 2, d.data(), d.size());
+        } else {
+            write_chunk("IDAT", d.data(), d.size(), nullptr, 0);
+        }
+    }
+    write_chunk("IEND", nullptr, 0, nullptr, 0);
+    return static_cast<bool>(out);
+}
+
+} // namespace detail
+
+} // namespace projectcode
@@ -0,0 +1,817 @@
+#pragma once
+
+#include "pixel.hpp"
+#include "pixel_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace projectcode {
+
+// Integer rectangle covering [x, x + w) x [y, y + h).
+struct Rect {
+    int x{0};
+    int y{0};
+    int w{0};
+    int h{0};
+
+    int right() const { return x + w; }
+    int bottom() const { return y + h; }
+    bool empty() const { return w <= 0 || h <= 0; }
+};
+
+inline Rect intersect(const Rect &a, const Rect &b) {
+    int x0 = std::max(a.x, b.x);
+    int y0 = std::max(a.y, b.y);
+    int x1 = std::min(a.right(), b.right());
+    int y1 = std::min(a.bottom(), b.bottom());
+    if (x1 <= x0 || y1 <= y0) return {};
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+inline Rect unite(const Rect &a, const Rect &b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    return {x0, y0, std::max(a.right(), b.right()) - x0, std::max(a.bottom(), b.bottom()) - y0};
+}
+
+struct Point {
+    double x{0.0};
+    double y{0.0};
+};
+
+// How overlapping or self-intersecting polygon regions are filled.
+enum class FillRule : std::uint8_t {
+    even_odd, // inside where an odd number of edges lie to the left
+    nonzero,  // inside where edge directions do not cancel out
+};
+
+// How wide strokes end and how consecutive wide strokes meet.
+enum class LineCap : std::uint8_t {
+    butt,  // flat, exactly at the endpoint
+    round, // a half disc past the endpoint
+};
+
+enum class LineJoin : std::uint8_t {
+    miter, // corners extended to a point, beveled past a miter length of 4 half-widths
+    round, // corners rounded off with the pen's radius
+    bevel, // corners cut straight across
+};
+
+namespace raster {
+
+namespace detail {
+inline long long floor_div(long long a, long long b) {
+    long long q = a / b;
+    if ((a % b) != 0 && ((a < 0) != (b < 0))) --q;
+    return q;
+}
+
+inline long long ceil_div(long long a, long long b) { return -floor_div(-a, b); }
+} // namespace detail
+
+// Bresenham's walk from (x0, y0) to (x1, y1) visits n + 1 pixels, n = max(|dx|, |dy|).
+// Step j moves the major axis j times and the minor axis floor((2*d*j + n) / (2*n)) times,
+// d being the minor delta. That closed form lets a segment be clipped once against a
+// rectangle and entered at its first visible pixel, with output identical to walking
+// every step and testing bounds per pixel. Coordinates must stay within +/-2^30.
+struct LineWalk {
+    long long first = 0; // first visible step
+    long long last = -1; // last visible step, inclusive; last < first when nothing is visible
+    int x = 0;           // pixel at step `first`
+    int y = 0;
+    int x_last = 0;      // pixel at step `last`
+    int y_last = 0;
+    int sx = 1;
+    int sy = 1;
+    bool x_major = true;
+    long long n = 0;   // major delta
+    long long d = 0;   // minor delta
+    long long rem = 0; // (2*d*first + n) mod 2n; the minor axis steps when it reaches 2n
+
+    bool empty() const { return last < first; }
+    long long count() const { return last - first + 1; }
+};
+
+inline LineWalk clip_line(const Rect &clip, int x0, int y0, int x1, int y1) {
+    LineWalk w;
+    if (clip.empty()) return w;
+    const long long adx = std::llabs(static_cast<long long>(x1) - x0);
+    const long long ady = std::llabs(static_cast<long long>(y1) - y0);
+    w.sx = x0 < x1 ? 1 : -1;
+    w.sy = y0 < y1 ? 1 : -1;
+    w.x_major = adx >= ady;
+    w.n = w.x_major ? adx : ady;
+    w.d = w.x_major ? ady : adx;
+
+    const long long p0 = w.x_major ? x0 : y0;
+    const long long q0 = w.x_major ? y0 : x0;
+    const int sp = w.x_major ? w.sx : w.sy;
+    const int sq = w.x_major ? w.sy : w.sx;
+    const long long plo = w.x_major ? clip.x : clip.y;
+    const long long phi = (w.x_major ? clip.right() : clip.bottom()) - 1;
+    const long long qlo = w.x_major ? clip.y : clip.x;
+    const long long qhi = (w.x_major ? clip.bottom() : clip.right()) - 1;
+
+    // Steps whose major coordinate lies inside the clip rectangle.
+    long long first = sp > 0 ? plo - p0 : p0 - phi;
+    long long last = sp > 0 ? phi - p0 : p0 - plo;
+    first = std::max(first, 0LL);
+    last = std::min(last, w.n);
+
+    // Minor offsets inside the clip rectangle, turned into step bounds.
+    long long mlo = sq > 0 ? qlo - q0 : q0 - qhi;
+    long long mhi = sq > 0 ? qhi - q0 : q0 - qlo;
+    mlo = std::max(mlo, 0LL);
+    mhi = std::min(mhi, w.d);
+    if (mlo > mhi) return w;
+    if (w.d > 0) {
+        first = std::max(first, detail::ceil_div(2 * w.n * mlo - w.n, 2 * w.d));
+        last = std::min(last, detail::ceil_div(2 * w.n * mhi + w.n, 2 * w.d) - 1);
+    }
+    if (last < first) return w;
+
+    w.first = first;
+    w.last = last;
+    long long minor = 0;
+    long long minor_last = 0;
+    if (w.n > 0) {
+        const long long num = 2 * w.d * first + w.n;
+        minor = num / (2 * w.n);
+        w.rem = num % (2 * w.n);
+        minor_last = (2 * w.d * last + w.n) / (2 * w.n);
+    }
+    const long long p = p0 + sp * first;
+    const long long q = q0 + sq * minor;
+    const long long p_last = p0 + sp * last;
+    const long long q_last = q0 + sq * minor_last;
+    w.x = static_cast<int>(w.x_major ? p : q);
+    w.y = static_cast<int>(w.x_major ? q : p);
+    w.x_last = static_cast<int>(w.x_major ? p_last : q_last);
+    w.y_last = static_cast<int>(w.x_major ? q_last : p_last);
+    return w;
+}
+
+// Write the visible part of a clipped line. `origin` points at pixel (0, 0) and `stride`
+// is the distance between rows in pixels.
+template <class Pixel>
+void walk_line(Pixel *origin, std::ptrdiff_t stride, const LineWalk &w, const Pixel &value) {
+    if (w.empty()) return;
+    std::ptrdiff_t count = static_cast<std::ptrdiff_t>(w.count());
+    Pixel *p = origin + static_cast<std::ptrdiff_t>(w.y) * stride + w.x;
+
+    if (w.d == 0 && w.x_major) { // horizontal: one span
+        Pixel *start = w.sx > 0 ? p : p - (count - 1);
+        kernels::fill(start, static_cast<std::size_t>(count), value);
+        return;
+    }
+
+    const std::ptrdiff_t major = w.x_major ? w.sx : w.sy * stride;
+    const std::ptrdiff_t minor = w.x_major ? w.sy * stride : w.sx;
+    if (w.d == 0 || w.d == w.n) { // vertical or 45 degrees: a fixed step per pixel
+        const std::ptrdiff_t step = w.d == 0 ? major : major + minor;
+        for (; count > 0; --count, p += step) *p = value;
+        return;
+    }
+
+    const long long two_d = 2 * w.d;
+    const long long two_n = 2 * w.n;
+    long long rem = w.rem;
+    while (true) {
+        *p = value;
+        if (--count == 0) break;
+        p += major;
+        rem += two_d;
+        if (rem >= two_n) {
+            rem -= two_n;
+            p += minor;
+        }
+    }
+}
+
+// Draw a 1-pixel Bresenham line into a pixel buffer; only pixels inside `clip` are written.
+template <class Pixel>
+void draw_line(Pixel *origin, std::ptrdiff_t stride, const Rect &clip, int x0, int y0, int x1, int y1,
+               const Pixel &value) {
+    walk_line(origin, stride, clip_line(clip, x0, y0, x1, y1), value);
+}
+
+// Call plot(pixel) on each pixel of a clipped line, in order from its first endpoint.
+template <class Pixel, class PlotFn>
+void visit_line(Pixel *origin, std::ptrdiff_t stride, const LineWalk &w, PlotFn plot) {
+    if (w.empty()) return;
+    std::ptrdiff_t count = static_cast<std::ptrdiff_t>(w.count());
+    Pixel *p = origin + static_cast<std::ptrdiff_t>(w.y) * stride + w.x;
+    const std::ptrdiff_t major = w.x_major ? w.sx : w.sy * stride;
+    const std::ptrdiff_t minor = w.x_major ? w.sy * stride : w.sx;
+    const long long two_d = 2 * w.d;
+    const long long two_n = 2 * w.n;
+    long long rem = w.rem;
+    while (true) {
+        plot(*p);
+        if (--count == 0) break;
+        p += major;
+        rem += two_d;
+        if (rem >= two_n) {
+            rem -= two_n;
+            p += minor;
+        }
+    }
+}
+
+// Call plot(x, y) on each pixel of a clipped line, in order from its first endpoint; for
+// targets that are not one flat buffer.
+template <class PlotFn>
+void visit_line_points(const LineWalk &w, PlotFn plot) {
+    if (w.empty()) return;
+    long long count = w.count();
+    int x = w.x;
+    int y = w.y;
+    int &major = w.x_major ? x : y;
+    int &minor = w.x_major ? y : x;
+    const int major_step = w.x_major ? w.sx : w.sy;
+    const int minor_step = w.x_major ? w.sy : w.sx;
+    const long long two_d = 2 * w.d;
+    const long long two_n = 2 * w.n;
+    long long rem = w.rem;
+    while (true) {
+        plot(x, y);
+        if (--count == 0) break;
+        major += major_step;
+        rem += two_d;
+        if (rem >= two_n) {
+            rem -= two_n;
+            minor += minor_step;
+        }
+    }
+}
+
+// Bresenham line drawn over the buffer at opacity `alpha` (see pixel_traits::blend).
+template <class Pixel>
+void blend_line(Pixel *origin, std::ptrdiff_t stride, const Rect &clip, int x0, int y0, int x1, int y1,
+                const Pixel &value, unsigned alpha) {
+    visit_line(origin, stride, clip_line(clip, x0, y0, x1, y1),
+               [&](Pixel &p) { pixel_traits<Pixel>::blend(p, value, alpha); });
+}
+
+// Anti-aliased lines take endpoints in 24.8 fixed point (1/256 pixel), with pixel centres
+// on whole numbers as for draw_line.
+inline std::int32_t to_subpixel(double v) {
+    constexpr double limit = 8388607.0; // largest 24.8 coordinate
+    return static_cast<std::int32_t>(std::lround(std::max(-limit, std::min(v, limit)) * 256.0));
+}
+
+// Pixel whose centre is nearest to a fixed-point coordinate (halves round up).
+inline int nearest_pixel(std::int32_t v) { return static_cast<int>(detail::floor_div(v + 128, 256)); }
+
+// Xiaolin Wu's line between fixed-point endpoints. Along the major axis each column gets
+// two pixels whose coverage (1-256) splits by the line's distance to their centres; the
+// end columns are scaled by how much of them the segment spans, so segments joined end
+// to end add up to full coverage. Stepping is integer only: the minor coordinate is a
+// 16.16 value advanced by a constant gradient. Only pixels inside `clip` are reported as
+// plot(x, y, coverage), and any clip reports exactly the full line's pixels inside it.
+template <class PlotFn>
+void wu_line(const Rect &clip, std::int32_t fx0, std::int32_t fy0, std::int32_t fx1, std::int32_t fy1, PlotFn plot) {
+    if (clip.empty()) return;
+    long long x0 = fx0, y0 = fy0, x1 = fx1, y1 = fy1;
+    const bool steep = std::llabs(y1 - y0) > std::llabs(x1 - x0);
+    if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    // Clip ranges along the major (u) and minor (v) axes.
+    const long long u_lo = steep ? clip.y : clip.x;
+    const long long u_hi = steep ? clip.bottom() : clip.right();
+    const long long v_lo = steep ? clip.x : clip.y;
+    const long long v_hi = steep ? clip.right() : clip.bottom();
+    auto put = [&](long long u, long long v, long long coverage) {
+        if (coverage <= 0 || u < u_lo || u >= u_hi || v < v_lo || v >= v_hi) return;
+        if (steep) {
+            plot(static_cast<int>(v), static_cast<int>(u), static_cast<int>(coverage));
+        } else {
+            plot(static_cast<int>(u), static_cast<int>(v), static_cast<int>(coverage));
+        }
+    };
+
+    const long long dx = x1 - x0;
+    const long long grad = dx == 0 ? 0 : (y1 - y0) * 65536 / dx; // 16.16 minor step per column
+    // Minor coordinate (16.16) of the line at the centre of column u.
+    auto minor_at = [&](long long u) { return y0 * 256 + detail::floor_div(grad * (u * 256 - x0), 256); };
+    auto column = [&](long long u, long long v, long long scale) {
+        const long long f = (v >> 8) & 255;
+        put(u, v >> 16, (256 - f) * scale >> 8);
+        put(u, (v >> 16) + 1, f * scale >> 8);
+    };
+
+    const long long u0 = nearest_pixel(static_cast<std::int32_t>(x0));
+    const long long u1 = nearest_pixel(static_cast<std::int32_t>(x1));
+    if (u0 == u1) { // the whole segment lies in one column
+        column(u0, minor_at(u0), dx);
+        return;
+    }
+    column(u0, minor_at(u0), 256 - ((x0 + 128) & 255));
+    column(u1, minor_at(u1), (x1 + 128) & 255);
+
+    const long long ub = std::max(u0 + 1, u_lo);
+    const long long ue = std::min(u1 - 1, u_hi - 1);
+    long long v = ub <= ue ? minor_at(ub) : 0;
+    for (long long u = ub; u <= ue; ++u, v += grad) column(u, v, 256);
+}
+
+// Anti-aliased line drawn over the buffer at opacity `alpha`. Returns the number of
+// pixels blended.
+template <class Pixel>
+std::size_t draw_line_aa(Pixel *origin, std::ptrdiff_t stride, const Rect &clip, std::int32_t fx0, std::int32_t fy0,
+                         std::int32_t fx1, std::int32_t fy1, const Pixel &value, unsigned alpha) {
+    std::size_t n = 0;
+    wu_line(clip, fx0, fy0, fx1, fy1, [&](int x, int y, int coverage) {
+        pixel_traits<Pixel>::blend(origin[static_cast<std::ptrdiff_t>(y) * stride + x], value,
+                                   (alpha * static_cast<unsigned>(coverage) + 128) >> 8);
+        ++n;
+    });
+    return n;
+}
+
+// Scanline polygon fill with an active edge table. Pixel (x, y) is inside when its
+// integer coordinate is, with left/top edges included and right/bottom edges excluded, so
+// polygons sharing an edge never overlap. Every span inside `clip` is reported as
+// span(y, x_begin, x_end) with x_end exclusive, top to bottom and left to right.
+// Edge crossings are computed per row from the edge's top vertex rather than accumulated,
+// so any clip rectangle yields exactly the spans of the full polygon that fall inside it.
+template <class SpanFn>
+void scan_polygon(const Rect &clip, const Point *pts, std::size_t count, FillRule rule, SpanFn span) {
+    if (clip.empty() || count < 3) return;
+
+    struct Edge {
+        double x_top;
+        double y_top;
+        double dxdy;
+        int first_row;
+        int last_row;
+        int dir;
+    };
+    struct Crossing {
+        double x;
+        int dir;
+    };
+
+    std::vector<Edge> edges;
+    edges.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Point &a = pts[i];
+        const Point &b = pts[(i + 1) % count];
+        if (a.y == b.y) continue;
+        const Point &top = a.y < b.y ? a : b;
+        const Point &bot = a.y < b.y ? b : a;
+        double first = std::max(std::ceil(top.y), static_cast<double>(clip.y));
+        double last = std::min(std::ceil(bot.y) - 1.0, static_cast<double>(clip.bottom() - 1));
+        if (last < first) continue;
+        edges.push_back({top.x, top.y, (bot.x - top.x) / (bot.y - top.y), static_cast<int>(first),
+                         static_cast<int>(last), a.y < b.y ? 1 : -1});
+    }
+    if (edges.empty()) return;
+    std::sort(edges.begin(), edges.end(), [](const Edge &l, const Edge &r) { return l.first_row < r.first_row; });
+
+    std::vector<const Edge *> active;
+    std::vector<Crossing> xs;
+    std::size_t next = 0;
+    for (int y = edges.front().first_row; y < clip.bottom(); ++y) {
+        active.erase(std::remove_if(active.begin(), active.end(), [y](const Edge *e) { return e->last_row < y; }),
+                     active.end());
+        while (next < edges.size() && edges[next].first_row == y) active.push_back(&edges[next++]);
+        if (active.empty()) {
+            if (next == edges.size()) break;
+            y = edges[next].first_row - 1;
+            continue;
+        }
+
+        xs.clear();
+        for (const Edge *e : active) xs.push_back({e->x_top + (y - e->y_top) * e->dxdy, e->dir});
+        // Crossings keep their order between rows except where edges cross, so insertion sort
+        // is close to linear here.
+        for (std::size_t i = 1; i < xs.size(); ++i) {
+            Crossing c = xs[i];
+            std::size_t j = i;
+            for (; j > 0 && xs[j - 1].x > c.x; --j) xs[j] = xs[j - 1];
+            xs[j] = c;
+        }
+
+        int winding = 0;
+        for (std::size_t i = 0; i + 1 < xs.size(); ++i) {
+            winding += rule == FillRule::even_odd ? 1 : xs[i].dir;
+            bool inside = rule == FillRule::even_odd ? (winding & 1) != 0 : winding != 0;
+            if (!inside) continue;
+            double xb = std::max(std::ceil(xs[i].x), static_cast<double>(clip.x));
+            double xe = std::min(std::ceil(xs[i + 1].x), static_cast<double>(clip.right()));
+            if (xb < xe) span(y, static_cast<int>(xb), static_cast<int>(xe));
+        }
+    }
+}
+
+// Fill a polygon into a pixel buffer (see draw_line for `origin`/`stride`), one
+// kernels::fill per span, or blended at opacity `alpha` below 255.
+template <class Pixel>
+void fill_polygon(Pixel *origin, std::ptrdiff_t stride, const Rect &clip, const Point *pts, std::size_t count,
+                  FillRule rule, const Pixel &value, unsigned alpha = 255) {
+    if (alpha == 0) return;
+    scan_polygon(clip, pts, count, rule, [&](int y, int x0, int x1) {
+        Pixel *row = origin + static_cast<std::ptrdiff_t>(y) * stride;
+        if (alpha >= 255) {
+            kernels::fill(row + x0, static_cast<std::size_t>(x1 - x0), value);
+        } else {
+            for (int x = x0; x < x1; ++x) pixel_traits<Pixel>::blend(row[x], value, alpha);
+        }
+    });
+}
+
+namespace detail {
+// Points on the circle of radius h around c from direction u, turning `angle` radians
+// towards v (u and v unit and perpendicular), at most a quarter pixel from the true arc.
+inline void append_arc(std::vector<Point> &out, Point c, double h, Point u, Point v, double angle) {
+    const double step = h > 0.25 ? 2.0 * std::acos(1.0 - 0.25 / h) : angle;
+    const int n = std::max(1, static_cast<int>(std::ceil(angle / step)));
+    for (int i = 0; i <= n; ++i) {
+        const double cs = std::cos(angle * i / n);
+        const double sn = std::sin(angle * i / n);
+        out.push_back({c.x + h * (u.x * cs + v.x * sn), c.y + h * (u.y * cs + v.y * sn)});
+    }
+}
+} // namespace detail
+
+// Outline of a path drawn with a wide pen, built a stroke at a time, as one polygon for
+// fill_polygon() with FillRule::nonzero. Each stroke adds its quad and, at its start,
+// either a cap or the join with the stroke before; the cap past the path's end is added
+// with add_cap(). The pieces overlap but fill as their union, so every pixel of the path
+// is written once, corners included.
+class StrokePath {
+public:
+    bool empty() const { return starts_.empty(); }
+    void clear() {
+        points_.clear();
+        starts_.clear();
+    }
+
+    // The stroke from a to b, `width` pixels wide. `from`, when given, is where the
+    // previous stroke started; it ended at a and the two are joined there. Otherwise a
+    // gets a cap.
+    void add(Point a, Point b, double width, LineCap cap, LineJoin join, const Point *from = nullptr) {
+        constexpr double pi = 3.14159265358979323846;
+        const double h = width / 2.0;
+        if (!(h > 0.0)) return;
+        const double len = std::hypot(b.x - a.x, b.y - a.y);
+        if (len == 0.0) {
+            if (!from) add_cap(a, b, width, cap);
+            return;
+        }
+        const Point d = {(b.x - a.x) / len, (b.y - a.y) / len};
+        const Point n = {-d.y, d.x};
+        contour_ = {{a.x + n.x * h, a.y + n.y * h}, {b.x + n.x * h, b.y + n.y * h},
+                    {b.x - n.x * h, b.y - n.y * h}, {a.x - n.x * h, a.y - n.y * h}};
+        push_contour();
+
+        const double from_len = from ? std::hypot(a.x - from->x, a.y - from->y) : 0.0;
+        if (from_len == 0.0) {
+            if (cap == LineCap::round) {
+                contour_.clear();
+                detail::append_arc(contour_, a, h, n, {-d.x, -d.y}, pi);
+                push_contour();
+            }
+            return;
+        }
+        const Point d0 = {(a.x - from->x) / from_len, (a.y - from->y) / from_len};
+        const double cross = d0.x * d.y - d0.y * d.x;
+        const double dot = d0.x * d.x + d0.y * d.y;
+        contour_.clear();
+        if (std::abs(cross) < 1e-12) {
+            // Straight on needs no join; turning straight back gets a round end at most.
+            if (dot < 0 && join == LineJoin::round) detail::append_arc(contour_, a, h, {-d0.y, d0.x}, d0, pi);
+            push_contour();
+            return;
+        }
+        // The gap opens on the side away from the turn.
+        const double side = cross > 0 ? -1.0 : 1.0;
+        const Point o0 = {-d0.y * side, d0.x * side};
+        const Point o1 = {-d.y * side, d.x * side};
+        const Point p0 = {a.x + o0.x * h, a.y + o0.y * h};
+        const Point p1 = {a.x + o1.x * h, a.y + o1.y * h};
+        const double cos_turn = o0.x * o1.x + o0.y * o1.y;
+        if (join == LineJoin::round) {
+            contour_.push_back(a);
+            detail::append_arc(contour_, a, h, o0, d0, std::acos(std::clamp(cos_turn, -1.0, 1.0)));
+        } else if (join == LineJoin::miter && cos_turn >= -7.0 / 8.0) { // miter length 2 / sqrt(2 + 2 cos) <= 4
+            const double k = h / (1.0 + cos_turn);
+            contour_ = {a, p0, {a.x + (o0.x + o1.x) * k, a.y + (o0.y + o1.y) * k}, p1};
+        } else {
+            contour_ = {a, p0, p1};
+        }
+        push_contour();
+    }
+
+    // The cap past b of the stroke from a to b; a round cap on a stroke of no length is a
+    // whole disc.
+    void add_cap(Point a, Point b, double width, LineCap cap) {
+        constexpr double pi = 3.14159265358979323846;
+        const double h = width / 2.0;
+        if (!(h > 0.0) || cap != LineCap::round) return;
+        contour_.clear();
+        const double len = std::hypot(b.x - a.x, b.y - a.y);
+        if (len == 0.0) {
+            detail::append_arc(contour_, b, h, {1.0, 0.0}, {0.0, 1.0}, 2.0 * pi);
+        } else {
+            const Point d = {(b.x - a.x) / len, (b.y - a.y) / len};
+            detail::append_arc(contour_, b, h, {-d.y, d.x}, d, pi);
+        }
+        push_contour();
+    }
+
+    // The contours as one polygon (`out` is replaced). Each contour is reached by an edge
+    // from the previous one's first point and those edges are walked back at the end, so
+    // they cancel without spanning the whole path however long it gets.
+    void outline(std::vector<Point> &out) const {
+        out.assign(points_.begin(), points_.end());
+        for (std::size_t i = starts_.size(); i > 1; --i) out.push_back(points_[starts_[i - 2]]);
+    }
+
+private:
+    std::vector<Point> points_; // contours oriented alike, each closed by repeating its first point
+    std::vector<std::size_t> starts_;
+    std::vector<Point> contour_;
+
+    void push_contour() {
+        if (contour_.size() < 3) return;
+        double area = 0.0;
+        for (std::size_t i = 0; i < contour_.size(); ++i) {
+            const Point &p = contour_[i];
+            const Point &q = contour_[(i + 1) % contour_.size()];
+            area += p.x * q.y - q.x * p.y;
+        }
+        if (area < 0) std::reverse(contour_.begin(), contour_.end());
+        starts_.push_back(points_.size());
+        points_.insert(points_.end(), contour_.begin(), contour_.end());
+        points_.push_back(contour_.front());
+    }
+};
+
+// Outline of a single segment from a to b drawn `width` pixels wide, for fill_polygon()
+// with FillRule::nonzero: the segment's quad, a cap past b and, at a, either a cap or,
+// when `from` is given, the join with the previous segment from `from` to a (see
+// StrokePath). `out` is replaced.
+inline void stroke_outline(std::vector<Point> &out, Point a, Point b, double width, LineCap cap, LineJoin join,
+                           const Point *from = nullptr) {
+    StrokePath path;
+    path.add(a, b, width, cap, join, from);
+    path.add_cap(a, b, width, cap);
+    path.outline(out);
+}
+
+// A row segment [x1, x2] waiting to be filled, reached from row y - dy.
+struct FloodSpan {
+    int x1;
+    int x2;
+    int y;
+    int dy;
+};
+
+// Scanline flood fill (Heckbert's seed fill) over any pixel store, from a seed inside
+// `clip` that still has the target value. The store is reached through three callbacks:
+// match(x, y, n) and match_back(x, y, n) count how many of the n pixels from (x, y)
+// rightwards, or from (x - 1, y) leftwards, hold the target, and fill(x0, x1, y) replaces
+// pixels [x0, x1) of row y. Pending spans live on `stack`, which the caller keeps to
+// reuse its capacity. Returns the number of pixels filled; `touched` receives their
+// bounding box.
+template <class MatchFn, class MatchBackFn, class FillFn>
+std::size_t seed_fill(const Rect &clip, int x, int y, std::vector<FloodSpan> &stack, MatchFn match,
+                      MatchBackFn match_back, FillFn fill_span, Rect *touched = nullptr) {
+    std::size_t filled = 0;
+    int x_min = x, x_max = x, y_min = y, y_max = y;
+    auto fill = [&](int y_row, int x0, int x1) { // [x0, x1)
+        fill_span(x0, x1, y_row);
+        filled += static_cast<std::size_t>(x1 - x0);
+        x_min = std::min(x_min, x0);
+        x_max = std::max(x_max, x1 - 1);
+        y_min = std::min(y_min, y_row);
+        y_max = std::max(y_max, y_row);
+    };
+
+    stack.clear();
+    stack.push_back({x, x, y, 1});
+    stack.push_back({x, x, y - 1, -1});
+    while (!stack.empty()) {
+        const FloodSpan s = stack.back();
+        stack.pop_back();
+        if (s.y < clip.y || s.y >= clip.bottom()) continue;
+        int x1 = s.x1;
+        int left = x1;
+        if (match(x1, s.y, 1) == 1) {
+            // The region may reach left of the span; the part past it leaks back up.
+            left = x1 - static_cast<int>(match_back(x1, s.y, x1 - clip.x));
+            if (left < x1) {
+                fill(s.y, left, x1);
+                stack.push_back({left, x1 - 1, s.y - s.dy, -s.dy});
+            }
+        }
+        while (x1 <= s.x2) {
+            const int start = x1;
+            x1 += static_cast<int>(match(x1, s.y, clip.right() - x1));
+            if (x1 > start) fill(s.y, start, x1);
+            if (x1 > left) stack.push_back({left, x1 - 1, s.y + s.dy, s.dy});
+            if (x1 - 1 > s.x2) stack.push_back({s.x2 + 1, x1 - 1, s.y - s.dy, -s.dy});
+            ++x1;
+            while (x1 < s.x2 && match(x1, s.y, 1) == 0) ++x1;
+            left = x1;
+        }
+    }
+    if (touched) *touched = {x_min, y_min, x_max - x_min + 1, y_max - y_min + 1};
+    return filled;
+}
+
+// seed_fill over a row-major buffer: replace the 4-connected region of pixels equal to
+// the one at (x, y) with `value`. Span ends are found with kernels::match a vector at a
+// time and spans are written with kernels::fill, so nothing is allocated per pixel and
+// deep regions cannot overflow the call stack.
+template <class Pixel>
+std::size_t flood_fill(Pixel *origin, std::ptrdiff_t stride, const Rect &clip, int x, int y, const Pixel &value,
+                       std::vector<FloodSpan> &stack, Rect *touched = nullptr) {
+    if (touched) *touched = {};
+    if (x < clip.x || x >= clip.right() || y < clip.y || y >= clip.bottom()) return 0;
+    const Pixel target = origin[static_cast<std::ptrdiff_t>(y) * stride + x];
+    if (kernels::match(&target, 1, value) == 1) return 0;
+    auto at = [&](int px, int py) { return origin + static_cast<std::ptrdiff_t>(py) * stride + px; };
+    return seed_fill(
+        clip, x, y, stack,
+        [&](int px, int py, int n) { return kernels::match(at(px, py), static_cast<std::size_t>(n), target); },
+        [&](int px, int py, int n) { return kernels::match_back(at(px, py), static_cast<std::size_t>(n), target); },
+        [&](int x0, int x1, int py) { kernels::fill(at(x0, py), static_cast<std::size_t>(x1 - x0), value); },
+        touched);
+}
+
+// Largest integer whose square does not exceed v (v >= 0).
+inline long long isqrt(long long v) {
+    long long r = static_cast<long long>(std::sqrt(static_cast<double>(v)));
+    while (r * r > v) --r;
+    while ((r + 1) * (r + 1) <= v) ++r;
+    return r;
+}
+
+// Filled disc: every pixel with dx*dx + dy*dy <= r*r around (cx, cy), reported row by row
+// as span(y, x_begin, x_end) like scan_polygon.
+template <class SpanFn>
+void scan_circle(const Rect &clip, int cx, int cy, int r, SpanFn span) {
+    if (r <= 0) return;
+    const long long r2 = static_cast<long long>(r) * r;
+    const int y0 = std::max(cy - r, clip.y);
+    const int y1 = std::min(cy + r, clip.bottom() - 1);
+    for (int y = y0; y <= y1; ++y) {
+        const long long dy = static_cast<long long>(y) - cy;
+        const long long half = isqrt(r2 - dy * dy);
+        const long long xb = std::max(static_cast<long long>(cx) - half, static_cast<long long>(clip.x));
+        const long long xe = std::min(static_cast<long long>(cx) + half + 1, static_cast<long long>(clip.right()));
+        if (xb < xe) span(y, static_cast<int>(xb), static_cast<int>(xe));
+    }
+}
+
+// Filled disc into a pixel buffer, one span per row. Returns the number of pixels written.
+template <class Pixel>
+std::size_t fill_circle(Pixel *origin, std::ptrdiff_t stride, const Rect &clip, int cx, int cy, int r,
+                        const Pixel &value) {
+    std::size_t n = 0;
+    scan_circle(clip, cx, cy, r, [&](int y, int x0, int x1) {
+        Pixel *row = origin + static_cast<std::ptrdiff_t>(y) * stride;
+        kernels::fill(row + x0, static_cast<std::size_t>(x1 - x0), value);
+        n += static_cast<std::size_t>(x1 - x0);
+    });
+    return n;
+}
+
+// Circle outline of radius r around (cx, cy) by the integer midpoint algorithm: one
+// octant is walked with an error term and mirrored, and plot(x, y) is called exactly once
+// for every outline pixel inside `clip`, so blended outlines have no double-hit pixels.
+template <class PlotFn>
+void visit_circle(const Rect &clip, int cx, int cy, int r, PlotFn plot) {
+    if (r < 0 || clip.empty()) return;
+    if (static_cast<long long>(cx) + r < clip.x || static_cast<long long>(cx) - r >= clip.right() ||
+        static_cast<long long>(cy) + r < clip.y || static_cast<long long>(cy) - r >= clip.bottom()) {
+        return;
+    }
+    auto put = [&](long long x, long long y) {
+        if (x >= clip.x && x < clip.right() && y >= clip.y && y < clip.bottom()) {
+            plot(static_cast<int>(x), static_cast<int>(y));
+        }
+    };
+    if (r == 0) {
+        put(cx, cy);
+        return;
+    }
+    long long x = r;
+    long long y = 0;
+    long long err = 1 - static_cast<long long>(r);
+    while (x >= y) {
+        if (y == 0) { // the four axis pixels
+            put(cx + x, cy);
+            put(cx - x, cy);
+            put(cx, cy + x);
+            put(cx, cy - x);
+        } else if (x == y) { // the four diagonal pixels
+            put(cx + x, cy + y);
+            put(cx - x, cy + y);
+            put(cx + x, cy - y);
+            put(cx - x, cy - y);
+        } else {
+            put(cx + x, cy + y);
+            put(cx - x, cy + y);
+            put(cx + x, cy - y);
+            put(cx - x, cy - y);
+            put(cx + y, cy + x);
+            put(cx - y, cy + x);
+            put(cx + y, cy - x);
+            put(cx - y, cy - x);
+        }
+        ++y;
+        if (err < 0) {
+            err += 2 * y + 1;
+        } else {
+            --x;
+            err += 2 * (y - x) + 1;
+        }
+    }
+}
+
+// Arc angles are whole 1/64 degrees, counterclockwise on screen from the +x axis (as in
+// X11's XDrawArc), so a recorded arc replays exactly.
+constexpr int arc_full_circle = 360 * 64;
+
+struct ArcAngles {
+    int start; // [0, arc_full_circle)
+    int sweep; // [0, arc_full_circle], counterclockwise
+};
+
+// Quantize an arc given in degrees; a negative sweep runs clockwise from `start`.
+inline ArcAngles to_arc_angles(double start_degrees, double sweep_degrees) {
+    if (sweep_degrees < 0) {
+        start_degrees += sweep_degrees;
+        sweep_degrees = -sweep_degrees;
+    }
+    const long long sweep = std::llround(std::min(sweep_degrees, 360.0) * 64.0);
+    long long start = std::llround(std::fmod(start_degrees, 360.0) * 64.0) % arc_full_circle;
+    if (start < 0) start += arc_full_circle;
+    return {static_cast<int>(start), static_cast<int>(sweep)};
+}
+
+// The outline pixels of visit_circle() whose direction from the centre lies within the
+// arc. A full sweep is the whole circle.
+template <class PlotFn>
+void visit_arc(const Rect &clip, int cx, int cy, int r, ArcAngles arc, PlotFn plot) {
+    if (arc.sweep >= arc_full_circle) {
+        visit_circle(clip, cx, cy, r, plot);
+        return;
+    }
+    if (arc.sweep <= 0) return;
+    constexpr double to_units = 180.0 * 64.0 / 3.14159265358979323846;
+    visit_circle(clip, cx, cy, r, [&](int x, int y) {
+        double a = std::atan2(static_cast<double>(cy - y), static_cast<double>(x - cx)) * to_units - arc.start;
+        if (a < 0) a += arc_full_circle;
+        if (a < 0) a += arc_full_circle;
+        if (a <= arc.sweep + 1e-6) plot(x, y);
+    });
+}
+
+// Arc outline into a pixel buffer, blended at opacity `alpha`. Returns the number of
+// pixels drawn.
+template <class Pixel>
+std::size_t draw_arc(Pixel *origin, std::ptrdiff_t stride, const Rect &clip, int cx, int cy, int r, ArcAngles arc,
+                     const Pixel &value, unsigned alpha) {
+    std::size_t n = 0;
+    visit_arc(clip, cx, cy, r, arc, [&](int x, int y) {
+        Pixel &p = origin[static_cast<std::ptrdiff_t>(y) * stride + x];
+        if (alpha >= 255) {
+            p = value;
+        } else {
+            pixel_traits<Pixel>::blend(p, value, alpha);
+        }
+        ++n;
+    });
+    return n;
+}
+
+// Pixels in the unclipped disc of radius r drawn by fill_circle().
+inline long long disc_pixels(int r) {
+    if (r <= 0) return 0;
+    const long long r2 = static_cast<long long>(r) * r;
+    long long n = 0;
+    for (long long dy = -r; dy <= r; ++dy) n += 2 * isqrt(r2 - dy * dy) + 1;
+    return n;
+}
+
+} // namespace raster
+
+} // namespace projectcode
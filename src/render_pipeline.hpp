@@ -0,0 +1,198 @@
+#pragma once
+
+#include "canvas_rgb.hpp"
+#include "display_list.hpp"
+#include "framebuffer.hpp"
+#include "spsc_ring.hpp"
+#include "turtle_rgb.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace projectcode {
+
+// Receives finished frames from a RenderPipeline. present() is called on the
+// pipeline's presenting thread with the canvas and the rectangles that changed since the
+// previous frame; returning false (e.g. the window was closed) stops the pipeline.
+class Presenter {
+public:
+    virtual ~Presenter() = default;
+    virtual bool present(const CanvasRGB &canvas, const std::vector<Rect> &dirty) = 0;
+};
+
+// Presenter without a window system: keeps the same framebuffer the Win32 presenter
+// blits from (see framebuffer.hpp) and updates it from each frame's dirty rectangles,
+// so pipelines can be run and load-tested anywhere.
+class HeadlessPresenter : public Presenter {
+public:
+    explicit HeadlessPresenter(const CanvasRGB &canvas) : fb_(detail::make_framebuffer(canvas)) {}
+
+    bool present(const CanvasRGB &canvas, const std::vector<Rect> &dirty) override {
+        for (const Rect &r : dirty) {
+            detail::update_framebuffer(fb_, canvas, r);
+            pixels_ += static_cast<std::uint64_t>(r.w) * static_cast<std::uint64_t>(r.h);
+        }
+        ++frames_;
+        return true;
+    }
+
+    const detail::Framebuffer &framebuffer() const { return fb_; }
+    std::uint64_t frames() const { return frames_; }
+    std::uint64_t presented_pixels() const { return pixels_; }
+
+private:
+    detail::Framebuffer fb_;
+    std::uint64_t frames_ = 0;
+    std::uint64_t pixels_ = 0;
+};
+
+struct PipelineOptions {
+    unsigned fps = 60;
+    std::size_t queue_capacity = 4096; // commands; fill vertices get a ring of the same size
+};
+
+struct PipelineStats {
+    std::uint64_t frames = 0;
+    std::uint64_t commands = 0;
+    std::uint64_t max_commands_per_frame = 0;
+    std::uint64_t producer_stalls = 0; // pushes that found the ring full
+};
+
+// Runs draw code and presentation concurrently. draw_fn (run_window's signature) runs on
+// a thread of its own with a turtle that only records: at every flush() the commands
+// recorded since the previous one are pushed into a lock-free SPSC ring, waiting while it
+// is full. The calling thread drains the ring, rasterizes into the canvas and presents
+// once per frame at `fps`, however many commands arrived meanwhile. flush() returns
+// false once the presenter has stopped.
+//
+// The canvas belongs to the presenting thread while run() is active: draw code receives
+// it for its size and must draw through the turtle only.
+class RenderPipeline {
+public:
+    RenderPipeline(CanvasRGB &canvas, Presenter &presenter, PipelineOptions opts = {})
+        : canvas_(canvas), presenter_(presenter), fps_(std::max(1u, opts.fps)), commands_(opts.queue_capacity),
+          vertices_(opts.queue_capacity) {}
+
+    template <class DrawFn>
+    PipelineStats run(DrawFn draw_fn) {
+        stats_ = {};
+        stopped_.store(false, std::memory_order_relaxed);
+        finished_.store(false, std::memory_order_relaxed);
+
+        std::thread producer([&]() {
+            TurtleRGB turtle(canvas_, 0, 0);
+            DisplayList pending;
+            turtle.record_to(&pending, false, true);
+            std::function<bool()> flush = [&]() {
+                turtle.finish_path();
+                return publish(pending);
+            };
+            draw_fn(canvas_, turtle, flush);
+            turtle.finish_path();
+            publish(pending);
+            finished_.store(true, std::memory_order_release);
+        });
+
+        const auto period = std::chrono::nanoseconds(1000000000 / fps_);
+        auto next = std::chrono::steady_clock::now();
+        for (;;) {
+            next += period;
+            // Sample before draining: everything published before `finished_` is then
+            // guaranteed to be drawn in this iteration.
+            const bool last = finished_.load(std::memory_order_acquire);
+            std::uint64_t drawn = 0;
+            {
+                PROJECTCODE_TRACE_SCOPE("pipeline", "drain");
+                drawn = drain(last ? std::chrono::steady_clock::time_point::max() : next);
+            }
+            stats_.commands += drawn;
+            stats_.max_commands_per_frame = std::max(stats_.max_commands_per_frame, drawn);
+            if (!canvas_.dirty().empty()) {
+                PROJECTCODE_TRACE_SCOPE("pipeline", "present");
+                if (!presenter_.present(canvas_, canvas_.dirty_rects())) stopped_.store(true, std::memory_order_relaxed);
+                canvas_.clear_dirty();
+                ++stats_.frames;
+            }
+            if (last || stopped_.load(std::memory_order_relaxed)) break;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (next < now) next = now; // running late: don't try to catch up with a burst
+        }
+        producer.join();
+        stats_.producer_stalls = stalls_;
+        stalls_ = 0;
+        return stats_;
+    }
+
+private:
+    CanvasRGB &canvas_;
+    Presenter &presenter_;
+    unsigned fps_;
+    SpscRing<DisplayList::Command> commands_;
+    SpscRing<Point> vertices_;
+    std::atomic<bool> stopped_{false};
+    std::atomic<bool> finished_{false};
+    std::uint64_t stalls_ = 0; // producer thread only
+    PipelineStats stats_;
+    std::vector<Point> points_; // presenting thread only
+
+    // Producer side. A fill's vertices follow its command, so a polygon larger than the
+    // vertex ring streams through it instead of deadlocking.
+    bool publish(DisplayList &pending) {
+        const auto &verts = pending.vertices();
+        for (const DisplayList::Command &cmd : pending.commands()) {
+            if (!push(commands_, cmd)) break;
+            if (cmd.op == DisplayList::Op::fill) {
+                for (std::int32_t k = 0; k < cmd.b; ++k) {
+                    if (!push(vertices_, verts[static_cast<std::size_t>(cmd.a + k)])) break;
+                }
+            }
+        }
+        pending.clear();
+        return !stopped_.load(std::memory_order_relaxed);
+    }
+
+    template <class T>
+    bool push(SpscRing<T> &ring, const T &value) {
+        if (ring.try_push(value)) return true;
+        ++stalls_;
+        while (!ring.try_push(value)) {
+            if (stopped_.load(std::memory_order_relaxed)) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // Consumer side: rasterize commands as they arrive until `deadline`, the next frame
+    // time, napping while the ring is empty. Returns early once the producer is done.
+    std::uint64_t drain(std::chrono::steady_clock::time_point deadline) {
+        using clock = std::chrono::steady_clock;
+        std::uint64_t n = 0;
+        DisplayList::Command cmd{};
+        for (;;) {
+            if (!commands_.try_pop(cmd)) {
+                if (deadline == clock::time_point::max() || finished_.load(std::memory_order_acquire)) return n;
+                const auto now = clock::now();
+                if (now >= deadline) return n;
+                std::this_thread::sleep_for(std::min<clock::duration>(deadline - now, std::chrono::microseconds(500)));
+                continue;
+            }
+            if (cmd.op == DisplayList::Op::fill) {
+                points_.resize(static_cast<std::size_t>(cmd.b));
+                for (Point &p : points_) {
+                    while (!vertices_.try_pop(p)) std::this_thread::yield(); // already being pushed
+                }
+            }
+            DisplayList::draw_command(canvas_, cmd, points_);
+            if (++n % 256 == 0 && clock::now() >= deadline) return n;
+        }
+    }
+};
+
+} // namespace projectcode
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "pixel_kernels.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace projectcode {
+
+// Box-filter reduction of packed RGB rows by an integer factor, fed one source row at a
+// time. Rows are summed into one row of 16-bit column totals (kernels::accumulate8); once
+// `factor` rows are in, each output pixel is the rounded mean of its factor x factor
+// block. Blocks cut off by the right or bottom edge average the pixels they hold. Memory
+// is a few rows whatever the image size, so thumbnails of huge canvases are cheap.
+class BoxDownscaler {
+public:
+    static constexpr unsigned max_factor = 255; // keeps column totals within 16 bits
+
+    BoxDownscaler(std::size_t src_width, std::size_t src_height, unsigned factor)
+        : src_width_(src_width), src_height_(src_height), factor_(factor),
+          width_((src_width + factor - 1) / factor), height_((src_height + factor - 1) / factor),
+          sums_(src_width * 3, 0), out_(width_ * 3) {
+        assert(factor >= 1 && factor <= max_factor && "downscale factor must be 1-255");
+    }
+
+    std::size_t width() const { return width_; }   // of the output
+    std::size_t height() const { return height_; } // of the output
+
+    // Add the next source row (src_width packed RGB pixels). Returns true when it completes
+    // an output row, which row() then holds until the next push.
+    bool push(const std::uint8_t *rgb) {
+        kernels::accumulate8(sums_.data(), rgb, sums_.size());
+        ++rows_;
+        ++src_y_;
+        if (rows_ < factor_ && src_y_ < src_height_) return false;
+        resolve();
+        std::fill(sums_.begin(), sums_.end(), std::uint16_t{0});
+        rows_ = 0;
+        return true;
+    }
+
+    const std::uint8_t *row() const { return out_.data(); }
+
+private:
+    std::size_t src_width_;
+    std::size_t src_height_;
+    unsigned factor_;
+    std::size_t width_;
+    std::size_t height_;
+    std::vector<std::uint16_t> sums_; // column totals of the rows pushed since the last output row
+    std::vector<std::uint8_t> out_;
+    unsigned rows_ = 0;
+    std::size_t src_y_ = 0;
+
+    // Rounded division by a block's pixel count as a multiply and shift. Totals stay below
+    // 2^24 and counts below 2^16, so the result is exact.
+    static std::uint64_t reciprocal(std::uint32_t count) { return (std::uint64_t{1} << 40) / count + 1; }
+    static std::uint8_t divide(std::uint32_t total, std::uint32_t count, std::uint64_t inverse) {
+        return static_cast<std::uint8_t>(((total + count / 2) * inverse) >> 40);
+    }
+
+    void resolve() {
+        const std::uint32_t full = factor_ * rows_;
+        const std::uint64_t full_inverse = reciprocal(full);
+        const std::uint16_t *s = sums_.data();
+        std::uint8_t *d = out_.data();
+        for (std::size_t x = 0; x < src_width_; x += factor_, d += 3) {
+            const std::size_t n = std::min<std::size_t>(factor_, src_width_ - x);
+            std::uint32_t r = 0, g = 0, b = 0;
+            for (std::size_t i = 0; i < n; ++i, s += 3) {
+                r += s[0];
+                g += s[1];
+                b += s[2];
+            }
+            const std::uint32_t count = static_cast<std::uint32_t>(n) * rows_;
+            const std::uint64_t inverse = count == full ? full_inverse : reciprocal(count);
+            d[0] = divide(r, count, inverse);
+            d[1] = divide(g, count, inverse);
+            d[2] = divide(b, count, inverse);
+        }
+    }
+};
+
+} // namespace projectcode
@@ -14,9 +14,11 @@ inline Color rgb(int r, int g, int b) {
     return Color{clampc(r), clampc(g), clampc(b)};
 }
 
-inline bool draw_polygon(TurtleRGB &t, int sides, double length, Color color,
-                         const std::function<bool()> &flush = nullptr) {
+template <class Canvas>
+bool draw_polygon(BasicTurtle<Canvas> &t, int sides, double length, typename Canvas::pixel_type color,
+                  const std::function<bool()> &flush = nullptr) {
     if (sides < 3) return true;
+    PROJECTCODE_TRACE_SCOPE("shapes", "draw_polygon");
     t.set_pen(color);
     double angle = 360.0 / static_cast<double>(sides);
     for (int i = 0; i < sides; ++i) {
@@ -27,9 +29,10 @@ inline bool draw_polygon(TurtleRGB &t, int sides, double length, Color color,
     return true;
 }
 
-inline bool draw_spiral(TurtleRGB &t, int steps, double increment, Color color,
-                        double turn_degrees = 18.0,
-                        const std::function<bool()> &flush = nullptr) {
+template <class Canvas>
+bool draw_spiral(BasicTurtle<Canvas> &t, int steps, double increment, typename Canvas::pixel_type color,
+                 double turn_degrees = 18.0, const std::function<bool()> &flush = nullptr) {
+    PROJECTCODE_TRACE_SCOPE("shapes", "draw_spiral");
     t.set_pen(color);
     double length = increment;
     for (int i = 0; i < steps; ++i) {
@@ -0,0 +1,473 @@
+#pragma once
+
+#include "basic_canvas.hpp"
+#include "basic_turtle.hpp"
+#include "image_writer.hpp"
+#include "instrument.hpp"
+#include "mapped_file.hpp"
+#include "pixel.hpp"
+#include "pixel_kernels.hpp"
+#include "png_writer.hpp"
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace projectcode {
+
+namespace detail {
+// Storage for equally sized pixel tiles, on the heap or in one memory-mapped file that
+// doubles as it fills. Tiles are numbered from 1 (0 means "none"); a mapped tile moves
+// when the file grows, so hold numbers rather than pointers across allocate().
+template <class Pixel>
+class TileStore {
+public:
+    explicit TileStore(std::size_t tile_pixels) : tile_pixels_(tile_pixels) {}
+
+    // Keep tiles in `path` from now on. Only possible while the store is empty.
+    bool map_to(const std::string &path) {
+        if (count_ != 0) return false;
+        file_ = MappedFile::create(path, initial_mapped_tiles * tile_bytes());
+        capacity_ = file_.is_open() ? initial_mapped_tiles : 0;
+        return file_.is_open();
+    }
+    bool mapped() const { return file_.is_open(); }
+
+    // A new tile filled with `value`. Throws std::bad_alloc when no memory or file space
+    // is left, like any other allocation.
+    std::uint32_t allocate(Pixel value) {
+        if (mapped()) {
+            if (count_ == capacity_) {
+                if (!file_.grow(2 * capacity_ * tile_bytes())) throw std::bad_alloc();
+                capacity_ *= 2;
+            }
+        } else {
+            heap_.emplace_back(tile_pixels_);
+        }
+        ++count_;
+        kernels::fill(tile(count_), tile_pixels_, value);
+        return count_;
+    }
+
+    Pixel *tile(std::uint32_t id) {
+        if (mapped()) return reinterpret_cast<Pixel *>(file_.data()) + (id - 1) * tile_pixels_;
+        return heap_[id - 1].data();
+    }
+    const Pixel *tile(std::uint32_t id) const {
+        if (mapped()) return reinterpret_cast<const Pixel *>(file_.data()) + (id - 1) * tile_pixels_;
+        return heap_[id - 1].data();
+    }
+
+    // Forget every tile. A mapped file keeps its size and is reused.
+    void clear() {
+        heap_.clear();
+        count_ = 0;
+    }
+
+    std::size_t count() const { return count_; }
+    std::size_t tile_bytes() const { return tile_pixels_ * sizeof(Pixel); }
+
+private:
+    static constexpr std::size_t initial_mapped_tiles = 64;
+
+    std::size_t tile_pixels_;
+    std::uint32_t count_ = 0;
+    std::vector<std::vector<Pixel, AlignedAllocator<Pixel, 64>>> heap_;
+    MappedFile file_;
+    std::size_t capacity_ = 0; // tiles the mapped file holds
+};
+} // namespace detail
+
+// A canvas for huge, mostly empty drawings (a 200000x200000 fractal, say). Pixels live in
+// 64x64 tiles that are allocated on first write; every untouched tile reads as one
+// shared background tile, so memory follows the drawn area rather than width * height.
+// Tiles can be kept in a memory-mapped file instead of on the heap (map_tiles_to), and
+// exports stream the image tile row by tile row without ever holding it whole.
+//
+// The drawing interface matches BasicCanvas, so BasicTurtle drives it unchanged
+// (SparseTurtleRGB). Dimensions may reach 2^30; anti-aliased lines are limited to the
+// 24.8 fixed-point range (about 8.3 million pixels). There is no dirty tracking.
+template <class Pixel>
+class BasicSparseCanvas {
+public:
+    using pixel_type = Pixel;
+    using traits = pixel_traits<Pixel>;
+
+    static constexpr int tile_shift = 6;
+    static constexpr int tile_size = 1 << tile_shift; // pixels per tile side
+
+    BasicSparseCanvas(std::size_t width, std::size_t height, Pixel background = traits::background())
+        : width_(width), height_(height), background_(background),
+          tiles_x_((width + tile_size - 1) >> tile_shift), tiles_y_((height + tile_size - 1) >> tile_shift),
+          pages_x_((tiles_x_ + page_size - 1) >> page_shift),
+          pages_(pages_x_ * ((tiles_y_ + page_size - 1) >> page_shift)),
+          background_tile_(tile_pixels, background), store_(tile_pixels) {
+        assert(width_ > 0 && height_ > 0 && "Canvas dimensions must be positive");
+        assert(width_ <= (std::size_t{1} << 30) && height_ <= (std::size_t{1} << 30) &&
+               "Sparse canvas dimensions are limited to 2^30");
+    }
+
+    // Keep tiles in a memory-mapped file at `path` (created or truncated) rather than on
+    // the heap; the file grows as tiles are drawn. Call before drawing anything.
+    bool map_tiles_to(const std::string &path) { return store_.map_to(path); }
+    bool mapped() const { return store_.mapped(); }
+
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+    Pixel background() const { return background_; }
+    Rect bounds() const { return {0, 0, static_cast<int>(width_), static_cast<int>(height_)}; }
+
+    std::size_t tiles_x() const { return tiles_x_; }
+    std::size_t tiles_y() const { return tiles_y_; }
+    std::size_t tile_count() const { return store_.count(); } // tiles allocated so far
+
+    // Bytes held for pixels and the tile directory (heap or file).
+    std::size_t memory_bytes() const {
+        std::size_t pages = 0;
+        for (const auto &p : pages_) pages += p ? 1 : 0;
+        return store_.count() * store_.tile_bytes() + background_tile_.size() * sizeof(Pixel) +
+               pages * page_size * page_size * sizeof(std::uint32_t) + pages_.size() * sizeof(pages_[0]);
+    }
+
+    void clear() { clear(background_); }
+
+    // Drop every tile; the whole canvas reads as `background` again.
+    void clear(Pixel background) {
+        background_ = background;
+        std::fill(background_tile_.begin(), background_tile_.end(), background);
+        for (auto &p : pages_) p.reset();
+        store_.clear();
+        cached_tile_ = nullptr;
+    }
+
+    void set_pixel(int x, int y, Pixel color) {
+        if (static_cast<std::size_t>(x) >= width_ || static_cast<std::size_t>(y) >= height_) {
+            counters_.add(instrument::Counter::pixels_clipped);
+            return;
+        }
+        pixel_for_write(x, y) = color;
+        counters_.add(instrument::Counter::pixels_written);
+    }
+
+    Pixel get_pixel(int x, int y) const {
+        if (static_cast<std::size_t>(x) >= width_ || static_cast<std::size_t>(y) >= height_) return Pixel{};
+        return tile_for_read(x >> tile_shift, y >> tile_shift)[offset(x, y)];
+    }
+
+    // Draw `color` over pixel (x, y) at opacity alpha (0-255).
+    void blend_pixel(int x, int y, Pixel color, std::uint8_t alpha) {
+        if (static_cast<std::size_t>(x) >= width_ || static_cast<std::size_t>(y) >= height_) {
+            counters_.add(instrument::Counter::pixels_clipped);
+            return;
+        }
+        traits::blend(pixel_for_write(x, y), color, alpha);
+        counters_.add(instrument::Counter::pixels_written);
+    }
+
+    // The same pixels as BasicCanvas::draw_line: clipped once, then walked tile by tile.
+    void draw_line(int x0, int y0, int x1, int y1, Pixel color) {
+        const raster::LineWalk walk = raster::clip_line(bounds(), x0, y0, x1, y1);
+        count_line(x0, y0, x1, y1, walk.empty() ? 0 : walk.count());
+        raster::visit_line_points(walk, [&](int x, int y) { pixel_for_write(x, y) = color; });
+    }
+
+    void draw_line(int x0, int y0, int x1, int y1, Pixel color, std::uint8_t alpha) {
+        if (alpha == 255) {
+            draw_line(x0, y0, x1, y1, color);
+            return;
+        }
+        const raster::LineWalk walk = raster::clip_line(bounds(), x0, y0, x1, y1);
+        count_line(x0, y0, x1, y1, walk.empty() || alpha == 0 ? 0 : walk.count());
+        if (alpha == 0) return;
+        raster::visit_line_points(walk, [&](int x, int y) { traits::blend(pixel_for_write(x, y), color, alpha); });
+    }
+
+    void draw_line_aa(double x0, double y0, double x1, double y1, Pixel color, std::uint8_t alpha = 255) {
+        const std::int32_t fx0 = raster::to_subpixel(x0);
+        const std::int32_t fy0 = raster::to_subpixel(y0);
+        const std::int32_t fx1 = raster::to_subpixel(x1);
+        const std::int32_t fy1 = raster::to_subpixel(y1);
+        std::size_t written = 0;
+        raster::wu_line(bounds(), fx0, fy0, fx1, fy1, [&](int x, int y, int coverage) {
+            traits::blend(pixel_for_write(x, y), color, (alpha * static_cast<unsigned>(coverage) + 128) >> 8);
+            ++written;
+        });
+        if constexpr (instrument::enabled) {
+            const int px0 = raster::nearest_pixel(fx0), py0 = raster::nearest_pixel(fy0);
+            const int px1 = raster::nearest_pixel(fx1), py1 = raster::nearest_pixel(fy1);
+            const Rect around = {-1, -1, static_cast<int>(width_) + 2, static_cast<int>(height_) + 2};
+            const raster::LineWalk walk = raster::clip_line(around, px0, py0, px1, py1);
+            const long long total = std::max(std::llabs(static_cast<long long>(px1) - px0),
+                                             std::llabs(static_cast<long long>(py1) - py0)) + 1;
+            counters_.add(instrument::Counter::segments);
+            counters_.add(instrument::Counter::pixels_written, written);
+            counters_.add(instrument::Counter::pixels_clipped,
+                          static_cast<std::uint64_t>(total - (walk.empty() ? 0 : walk.count())));
+        }
+    }
+
+    // Fill pixels [x0, x1) of row y with `color`, one kernels::fill per tile crossed.
+    void fill_span(int x0, int x1, int y, Pixel color) {
+        if (static_cast<std::size_t>(y) >= height_) return;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, static_cast<int>(width_));
+        if (x0 >= x1) return;
+        counters_.add(instrument::Counter::pixels_written, static_cast<std::uint64_t>(x1 - x0));
+        while (x0 < x1) {
+            const int end = std::min(x1, (x0 | (tile_size - 1)) + 1);
+            kernels::fill(&pixel_for_write(x0, y), static_cast<std::size_t>(end - x0), color);
+            x0 = end;
+        }
+    }
+
+    // Fill a polygon given by its vertices with a scanline algorithm, clipped to the canvas.
+    // Blended at opacity alpha (0-255) below 255.
+    void fill_polygon(const std::vector<Point> &points, Pixel color, FillRule rule = FillRule::even_odd,
+                      std::uint8_t alpha = 255) {
+        counters_.add(instrument::Counter::fills);
+        if (alpha == 0) return;
+        raster::scan_polygon(bounds(), points.data(), points.size(), rule, [&](int y, int x0, int x1) {
+            if (alpha == 255) {
+                fill_span(x0, x1, y, color);
+                return;
+            }
+            for (int x = x0; x < x1; ++x) traits::blend(pixel_for_write(x, y), color, alpha);
+            counters_.add(instrument::Counter::pixels_written, static_cast<std::uint64_t>(x1 - x0));
+        });
+    }
+
+    // Filled disc of radius r centred on (cx, cy).
+    void fill_circle(int cx, int cy, int r, Pixel color) {
+        if (r <= 0) return;
+        std::uint64_t written = 0;
+        raster::scan_circle(bounds(), cx, cy, r, [&](int y, int x0, int x1) {
+            fill_span(x0, x1, y, color);
+            if constexpr (instrument::enabled) written += static_cast<std::uint64_t>(x1 - x0);
+        });
+        if constexpr (instrument::enabled) {
+            counters_.add(instrument::Counter::stamps);
+            counters_.add(instrument::Counter::pixels_clipped,
+                          static_cast<std::uint64_t>(raster::disc_pixels(r)) - written);
+        }
+    }
+
+    // The outline BasicCanvas::draw_arc draws.
+    void draw_circle(int cx, int cy, int r, Pixel color, std::uint8_t alpha = 255) {
+        draw_arc(cx, cy, r, 0.0, 360.0, color, alpha);
+    }
+
+    void draw_arc(int cx, int cy, int r, double start_degrees, double sweep_degrees, Pixel color,
+                  std::uint8_t alpha = 255) {
+        if (r < 0) return;
+        counters_.add(instrument::Counter::segments);
+        if (alpha == 0) return;
+        std::uint64_t written = 0;
+        raster::visit_arc(bounds(), cx, cy, r, raster::to_arc_angles(start_degrees, sweep_degrees), [&](int x, int y) {
+            if (alpha == 255) {
+                pixel_for_write(x, y) = color;
+            } else {
+                traits::blend(pixel_for_write(x, y), color, alpha);
+            }
+            ++written;
+        });
+        counters_.add(instrument::Counter::pixels_written, written);
+    }
+
+    // The region BasicCanvas::flood_fill repaints, found with raster::seed_fill. Span ends
+    // are matched a tile row at a time; undrawn tiles are read from the background tile
+    // and only allocated once the fill reaches them.
+    std::size_t flood_fill(int x, int y, Pixel color) {
+        counters_.add(instrument::Counter::fills);
+        if (static_cast<std::size_t>(x) >= width_ || static_cast<std::size_t>(y) >= height_) return 0;
+        const Pixel target = get_pixel(x, y);
+        if (kernels::match(&target, 1, color) == 1) return 0;
+        auto match = [&](int px, int py, int n) {
+            int run = 0;
+            while (run < n) {
+                const int at = px + run;
+                const int len = std::min(n - run, tile_size - (at & (tile_size - 1)));
+                const Pixel *p = tile_for_read(at >> tile_shift, py >> tile_shift) + offset(at, py);
+                const int m = static_cast<int>(kernels::match(p, static_cast<std::size_t>(len), target));
+                run += m;
+                if (m < len) break;
+            }
+            return run;
+        };
+        auto match_back = [&](int px, int py, int n) {
+            int run = 0;
+            while (run < n) {
+                const int last = px - run - 1;
+                const int len = std::min(n - run, (last & (tile_size - 1)) + 1);
+                const Pixel *end = tile_for_read(last >> tile_shift, py >> tile_shift) + offset(last, py) + 1;
+                const int m = static_cast<int>(kernels::match_back(end, static_cast<std::size_t>(len), target));
+                run += m;
+                if (m < len) break;
+            }
+            return run;
+        };
+        return raster::seed_fill(bounds(), x, y, flood_stack_, match, match_back,
+                                 [&](int x0, int x1, int py) { fill_span(x0, x1, py, color); });
+    }
+
+    // Visit every tile in row-major tile order as fn(area, pixels, stride, drawn): `area`
+    // is the tile's part of the canvas, `pixels` its top-left pixel with rows `stride`
+    // pixels apart, and `drawn` false for tiles that still share the background tile.
+    template <class TileFn>
+    void for_each_tile(TileFn fn) const {
+        for (std::size_t ty = 0; ty < tiles_y_; ++ty) {
+            for (std::size_t tx = 0; tx < tiles_x_; ++tx) {
+                const std::uint32_t id = find_tile(static_cast<int>(tx), static_cast<int>(ty));
+                const Rect area = intersect({static_cast<int>(tx) << tile_shift, static_cast<int>(ty) << tile_shift,
+                                             tile_size, tile_size},
+                                            bounds());
+                fn(area, id ? store_.tile(id) : background_tile_.data(), static_cast<std::size_t>(tile_size), id != 0);
+            }
+        }
+    }
+
+    // Instrumentation counters, as on BasicCanvas.
+    const instrument::Counters &counters() const { return counters_; }
+    void reset_counters() { counters_.reset(); }
+
+    // The exporters assemble each output row from the tiles it crosses, one tile row at a
+    // time, so memory stays at a few rows whatever the canvas size.
+    bool save_ppm(const std::string &filename, WriteMode mode = WriteMode::buffered) const {
+        PROJECTCODE_TRACE_SCOPE("canvas", "export");
+        const std::string header = "P6\n" + std::to_string(width_) + " " + std::to_string(height_) + "\n255\n";
+        return count_export(detail::write_rows(
+            filename, reinterpret_cast<const std::uint8_t *>(header.data()), header.size(), width_ * 3, height_,
+            [&](std::size_t y, std::uint8_t *dst) { encode_row(y, dst, false); }, mode));
+    }
+
+    // Uncompressed 24-bit BMP; fails for images over the format's 4 GiB limit.
+    bool save_bmp(const std::string &filename, WriteMode mode = WriteMode::buffered) const {
+        PROJECTCODE_TRACE_SCOPE("canvas", "export");
+        std::uint8_t header[detail::bmp_header_size];
+        if (!detail::make_bmp_header(header, width_, height_)) return false;
+        const std::size_t row_stride = width_ * 3;
+        const std::size_t row_padded = (row_stride + 3u) & ~std::size_t{3};
+        return count_export(detail::write_rows(
+            filename, header, detail::bmp_header_size, row_padded, height_,
+            [&](std::size_t i, std::uint8_t *dst) {
+                encode_row(height_ - 1 - i, dst, true);
+                std::memset(dst + row_stride, 0, row_padded - row_stride);
+            },
+            mode));
+    }
+
+    // 24-bit PNG; only the compressed stream is held in memory.
+    bool save_png(const std::string &filename, ThreadPool *pool = nullptr) const {
+        PROJECTCODE_TRACE_SCOPE("canvas", "export");
+        return count_export(detail::write_png(
+            filename, width_, height_, [this](std::size_t y, std::uint8_t *dst) { encode_row(y, dst, false); }, pool));
+    }
+
+private:
+    // The tile directory is itself sparse: 64x64-tile pages of tile numbers, allocated
+    // when a tile in them is first drawn.
+    static constexpr int page_shift = 6;
+    static constexpr int page_size = 1 << page_shift;
+    static constexpr std::size_t tile_pixels = std::size_t{tile_size} * tile_size;
+
+    std::size_t width_;
+    std::size_t height_;
+    Pixel background_;
+    std::size_t tiles_x_;
+    std::size_t tiles_y_;
+    std::size_t pages_x_;
+    std::vector<std::unique_ptr<std::uint32_t[]>> pages_;
+    std::vector<Pixel, AlignedAllocator<Pixel, 64>> background_tile_; // stands in for every undrawn tile
+    detail::TileStore<Pixel> store_;
+    mutable instrument::Counters counters_;
+
+    // Most writes land in the tile of the previous one.
+    int cached_tx_ = -1;
+    int cached_ty_ = -1;
+    Pixel *cached_tile_ = nullptr;
+    std::vector<raster::FloodSpan> flood_stack_; // kept between flood fills
+
+    static std::size_t offset(int x, int y) {
+        return (static_cast<std::size_t>(y & (tile_size - 1)) << tile_shift) +
+               static_cast<std::size_t>(x & (tile_size - 1));
+    }
+
+    std::size_t page_index(int tx, int ty) const {
+        return static_cast<std::size_t>(ty >> page_shift) * pages_x_ + static_cast<std::size_t>(tx >> page_shift);
+    }
+    static std::size_t slot_index(int tx, int ty) {
+        return static_cast<std::size_t>(((ty & (page_size - 1)) << page_shift) + (tx & (page_size - 1)));
+    }
+
+    std::uint32_t find_tile(int tx, int ty) const {
+        const auto &page = pages_[page_index(tx, ty)];
+        return page ? page[slot_index(tx, ty)] : 0;
+    }
+
+    const Pixel *tile_for_read(int tx, int ty) const {
+        const std::uint32_t id = find_tile(tx, ty);
+        return id ? store_.tile(id) : background_tile_.data();
+    }
+
+    Pixel *tile_for_write(int tx, int ty) {
+        if (tx == cached_tx_ && ty == cached_ty_ && cached_tile_) return cached_tile_;
+        auto &page = pages_[page_index(tx, ty)];
+        if (!page) page.reset(new std::uint32_t[page_size * page_size]());
+        std::uint32_t &id = page[slot_index(tx, ty)];
+        if (id == 0) id = store_.allocate(background_); // may move mapped tiles: re-resolve below
+        cached_tx_ = tx;
+        cached_ty_ = ty;
+        cached_tile_ = store_.tile(id);
+        return cached_tile_;
+    }
+
+    // (x, y) must be inside the canvas.
+    Pixel &pixel_for_write(int x, int y) { return tile_for_write(x >> tile_shift, y >> tile_shift)[offset(x, y)]; }
+
+    void encode_row(std::size_t y, std::uint8_t *dst, bool bgr) const {
+        const int ty = static_cast<int>(y >> tile_shift);
+        const std::size_t row_in_tile = (y & (tile_size - 1)) << tile_shift;
+        for (std::size_t x = 0; x < width_; x += tile_size) {
+            const std::size_t n = std::min<std::size_t>(tile_size, width_ - x);
+            const Pixel *src = tile_for_read(static_cast<int>(x >> tile_shift), ty) + row_in_tile;
+            if (bgr) {
+                detail::pixels_to_bgr24(src, dst + x * 3, n);
+            } else {
+                detail::pixels_to_rgb24(src, dst + x * 3, n);
+            }
+        }
+    }
+
+    void count_line(int x0, int y0, int x1, int y1, long long written) {
+        if constexpr (instrument::enabled) {
+            const long long total = std::max(std::llabs(static_cast<long long>(x1) - x0),
+                                             std::llabs(static_cast<long long>(y1) - y0)) + 1;
+            counters_.add(instrument::Counter::segments);
+            counters_.add(instrument::Counter::pixels_written, static_cast<std::uint64_t>(written));
+            counters_.add(instrument::Counter::pixels_clipped, static_cast<std::uint64_t>(total - written));
+        } else {
+            (void)x0, (void)y0, (void)x1, (void)y1, (void)written;
+        }
+    }
+
+    // Exports are counted once the file is written; returns `written`.
+    bool count_export(bool written) const {
+        if (written) counters_.add(instrument::Counter::bytes_exported, width_ * height_ * 3);
+        return written;
+    }
+};
+
+using SparseCanvasRGB = BasicSparseCanvas<Color>;
+using SparseCanvasRGBA32 = BasicSparseCanvas<RGBA32>;
+
+// The regular turtle over a sparse canvas.
+using SparseTurtleRGB = BasicTurtle<SparseCanvasRGB>;
+
+} // namespace projectcode
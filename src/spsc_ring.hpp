@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace projectcode {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to a power of two. Each side keeps a cached copy of the other
+// side's index and only reloads it (one acquire load) when the ring looks full or empty,
+// so a steady stream costs one release store per element. The two ends live on separate
+// cache lines to keep the threads from invalidating each other's line on every push.
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity) : mask_(round_up(capacity) - 1), slots_(mask_ + 1) {}
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // Producer only. False when the ring is full.
+    bool try_push(const T &value) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) return false;
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. False when the ring is empty.
+    bool try_pop(T &out) {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either side; a snapshot that may be stale by the time it is used.
+    std::size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+private:
+    static constexpr std::size_t cache_line = 64;
+
+    // Consumer side.
+    alignas(cache_line) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_ = 0;
+    // Producer side.
+    alignas(cache_line) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_ = 0;
+
+    alignas(cache_line) const std::size_t mask_;
+    std::vector<T> slots_;
+
+    static std::size_t round_up(std::size_t n) {
+        std::size_t p = 2;
+        while (p < n) p *= 2;
+        return p;
+    }
+};
+
+} // namespace projectcode
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "basic_canvas.hpp"
+#include "display_list.hpp"
+#include "instrument.hpp"
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace projectcode {
+
+namespace detail {
+
+// Where the 1x coordinate v lands on a canvas `factor` times larger: pixel centres map to
+// the centres of their blocks, so the box filter puts everything back in place.
+inline double supersampled(double v, unsigned factor) { return v * factor + (factor - 1) * 0.5; }
+
+// Quad of a one-pixel line scaled up `factor` times, as a `factor` wide outline. `square`
+// extends both ends by half the width, as Bresenham lines cover their end pixels; Wu lines
+// end flush.
+inline void scaled_line_outline(std::vector<Point> &out, Point a, Point b, unsigned factor, bool square) {
+    const double h = factor / 2.0;
+    const double len = std::hypot(b.x - a.x, b.y - a.y);
+    out.clear();
+    if (len == 0.0) {
+        if (square) out = {{a.x - h, a.y - h}, {a.x + h, a.y - h}, {a.x + h, a.y + h}, {a.x - h, a.y + h}};
+        return;
+    }
+    const Point d = {(b.x - a.x) / len * h, (b.y - a.y) / len * h};
+    const Point n = {-d.y, d.x};
+    if (square) {
+        a = {a.x - d.x, a.y - d.y};
+        b = {b.x + d.x, b.y + d.y};
+    }
+    out = {{a.x + n.x, a.y + n.y}, {b.x + n.x, b.y + n.y}, {b.x - n.x, b.y - n.y}, {a.x - n.x, a.y - n.y}};
+}
+
+} // namespace detail
+
+// Draw one recorded command onto `big`, a canvas `factor` times the size it was recorded
+// at. Shapes scale with the canvas, and one-pixel lines and arcs become `factor` pixels
+// wide so they keep their weight once the canvas is filtered back down. `points` holds a
+// fill's vertices at 1x; `scratch` is reused between calls.
+template <class Pixel>
+void draw_supersampled(BasicCanvas<Pixel> &big, const typename BasicDisplayList<Pixel>::Command &cmd,
+                       const std::vector<Point> &points, unsigned factor, std::vector<Point> &scratch) {
+    using Op = typename BasicDisplayList<Pixel>::Op;
+    constexpr double pi = 3.14159265358979323846;
+    auto at = [factor](double x, double y) {
+        return Point{detail::supersampled(x, factor), detail::supersampled(y, factor)};
+    };
+    switch (cmd.op) {
+    case Op::line:
+    case Op::aa_line: {
+        const double k = cmd.op == Op::line ? 1.0 : 1.0 / 256.0;
+        detail::scaled_line_outline(scratch, at(cmd.a * k, cmd.b * k), at(cmd.c * k, cmd.d * k), factor,
+                                    cmd.op == Op::line);
+        big.fill_polygon(scratch, cmd.color, FillRule::nonzero, cmd.alpha);
+        break;
+    }
+    case Op::fill:
+        scratch.clear();
+        for (const Point &p : points) scratch.push_back(at(p.x, p.y));
+        big.fill_polygon(scratch, cmd.color, cmd.rule, cmd.alpha);
+        break;
+    case Op::stamp:
+        if (cmd.c <= 0) break;
+        scratch.clear();
+        // A disc of radius r covers the pixels whose centres lie within r, about r + 0.5.
+        raster::detail::append_arc(scratch, at(cmd.a, cmd.b), (cmd.c + 0.5) * factor, {1.0, 0.0}, {0.0, 1.0},
+                                   2.0 * pi);
+        big.fill_polygon(scratch, cmd.color, FillRule::nonzero);
+        break;
+    case Op::arc: {
+        // A ring sector `factor` pixels thick: the outer arc out, the inner one back.
+        const raster::ArcAngles arc = BasicDisplayList<Pixel>::unpack_arc(cmd.d);
+        if (arc.sweep <= 0) break;
+        const double start = arc.start / 64.0 * pi / 180.0;
+        const double sweep = std::min(arc.sweep / 64.0, 360.0) * pi / 180.0;
+        const Point c = at(cmd.a, cmd.b);
+        const double r = static_cast<double>(cmd.c) * factor;
+        const Point u = {std::cos(start), -std::sin(start)}; // counterclockwise on screen
+        const Point v = {-std::sin(start), -std::cos(start)};
+        scratch.clear();
+        raster::detail::append_arc(scratch, c, r + factor / 2.0, u, v, sweep);
+        const std::size_t outer = scratch.size();
+        raster::detail::append_arc(scratch, c, std::max(0.0, r - factor / 2.0), u, v, sweep);
+        std::reverse(scratch.begin() + static_cast<std::ptrdiff_t>(outer), scratch.end());
+        big.fill_polygon(scratch, cmd.color, FillRule::even_odd, cmd.alpha);
+        break;
+    }
+    case Op::flood: {
+        const Point seed = at(cmd.a, cmd.b);
+        big.flood_fill(static_cast<int>(std::lround(seed.x)), static_cast<int>(std::lround(seed.y)), cmd.color);
+        break;
+    }
+    }
+}
+
+// Render a program recorded on a width x height canvas at `factor` times the resolution
+// and box-filter it back down (BasicCanvas::downscale), for smooth edges on every shape.
+// The intermediate canvas holds factor^2 times the pixels; 2 to 4 is the usual range.
+template <class Pixel>
+BasicCanvas<Pixel> render_supersampled(const BasicDisplayList<Pixel> &list, std::size_t width, std::size_t height,
+                                       unsigned factor, Pixel background = pixel_traits<Pixel>::background()) {
+    PROJECTCODE_TRACE_SCOPE("display_list", "supersample");
+    if (factor <= 1) {
+        BasicCanvas<Pixel> canvas(width, height, background);
+        list.replay(canvas);
+        return canvas;
+    }
+    BasicCanvas<Pixel> big(width * factor, height * factor, background);
+    std::vector<Point> points;
+    std::vector<Point> scratch;
+    for (const auto &cmd : list.commands()) {
+        if (cmd.op == BasicDisplayList<Pixel>::Op::fill) {
+            points.assign(list.vertices().begin() + cmd.a, list.vertices().begin() + cmd.a + cmd.b);
+        }
+        draw_supersampled(big, cmd, points, factor, scratch);
+    }
+    return big.downscale(factor);
+}
+
+} // namespace projectcode
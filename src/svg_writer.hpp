@@ -0,0 +1,346 @@
+#pragma once
+
+#include "display_list.hpp"
+#include "instrument.hpp"
+#include "pixel.hpp"
+#include "raster.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace projectcode {
+
+namespace detail {
+
+// Streams a display list as SVG path elements. Consecutive commands of one style share a
+// <path>; lines that continue where the previous one ended extend its subpath, and a run
+// of collinear segments keeps only its end points. Nonzero fills are merged too, each
+// polygon turned the same way so that together they fill their union; this assumes each
+// polygon winds one way, as stroke outlines and turtle fills do. Even-odd fills would
+// cancel where they overlap and get a path each. Text is built in a reused buffer and
+// handed to the stream in large blocks, so writing is linear in the number of commands.
+class SvgPathWriter {
+public:
+    explicit SvgPathWriter(std::ostream &os) : os_(os) {}
+
+    // What a <path> element draws: a 1px Bresenham stroke (square caps, so end pixels and
+    // one-pixel segments are covered), an anti-aliased stroke (SVG's default butt caps, as
+    // Wu lines end), or a filled polygon.
+    enum class Kind { line, aa_line, fill };
+
+    struct Style {
+        Kind kind;
+        Color color;
+        std::uint8_t alpha;
+        FillRule rule;
+
+        bool operator==(const Style &o) const {
+            return kind == o.kind && color.r == o.color.r && color.g == o.color.g && color.b == o.color.b &&
+                   alpha == o.alpha && (kind != Kind::fill || rule == o.rule);
+        }
+    };
+
+    // Coordinates are in 1/256 pixel, as in raster::to_subpixel().
+    struct Fixed {
+        std::int64_t x;
+        std::int64_t y;
+        bool operator==(const Fixed &o) const { return x == o.x && y == o.y; }
+    };
+
+    void text(const char *s) { buf_ += s; }
+
+    // Switch to `style`, closing the current <path> if it had another one.
+    void use(const Style &style) {
+        const bool merge = style.kind != Kind::fill || style.rule == FillRule::nonzero;
+        if (open_ && merge && style == style_) return;
+        close_path();
+        style_ = style;
+        open_ = true;
+        buf_ += "<path";
+        if (style.kind == Kind::fill) {
+            append_attr(" fill=\"", style.color);
+            if (style.rule == FillRule::even_odd) buf_ += " fill-rule=\"evenodd\"";
+            if (style.alpha < 255) append_opacity(" fill-opacity=\"", style.alpha);
+        } else {
+            append_attr(" fill=\"none\" stroke=\"", style.color);
+            if (style.kind == Kind::line) buf_ += " stroke-linecap=\"square\""; // butt is SVG's default
+            if (style.alpha < 255) append_opacity(" stroke-opacity=\"", style.alpha);
+        }
+        buf_ += " d=\"";
+        ++elements_;
+    }
+
+    // A segment of the current stroke style; extends the open subpath when it starts where
+    // that one ends.
+    void segment(Fixed a, Fixed b) {
+        if (points_.empty() || !(points_.back() == a)) {
+            end_subpath();
+            points_.push_back(a);
+            points_.push_back(b);
+            return;
+        }
+        const std::size_t n = points_.size();
+        if (n == 2 && points_[0] == points_[1]) {
+            points_[1] = b;
+            return;
+        }
+        const Fixed p = points_[n - 2];
+        const Fixed q = points_[n - 1];
+        const std::int64_t ux = q.x - p.x, uy = q.y - p.y;
+        const std::int64_t vx = b.x - q.x, vy = b.y - q.y;
+        if (vx == 0 && vy == 0) return;
+        if (ux * vy - uy * vx == 0 && ux * vx + uy * vy > 0) {
+            points_[n - 1] = b; // collinear continuation
+        } else {
+            points_.push_back(b);
+        }
+    }
+
+    // A closed polygon of the current fill style, as its own subpath.
+    void polygon(const Point *pts, std::size_t count) {
+        end_subpath();
+        double area = 0.0;
+        for (std::size_t i = 0; i < count; ++i) {
+            const Point &p = pts[i];
+            const Point &q = pts[(i + 1) % count];
+            area += p.x * q.y - q.x * p.y;
+        }
+        const bool reverse = style_.rule == FillRule::nonzero && area < 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            const Point &p = pts[reverse ? count - 1 - i : i];
+            buf_ += i == 0 ? 'M' : (i == 1 ? 'L' : ' ');
+            append_point(p.x, p.y);
+        }
+        if (count > 0) buf_ += 'Z';
+        spill();
+    }
+
+    // The arc of a circle from `start` degrees counterclockwise through `sweep` degrees,
+    // as its own subpath of the current stroke style.
+    void arc(double cx, double cy, double r, double start, double sweep) {
+        end_subpath();
+        constexpr double to_radians = 3.14159265358979323846 / 180.0;
+        if (sweep >= 360.0) { // SVG arcs cannot close on themselves, so draw two halves
+            buf_ += 'M';
+            append_point(cx + r, cy);
+            append_arc_to(r, false, cx - r, cy);
+            append_arc_to(r, false, cx + r, cy);
+            buf_ += 'Z';
+        } else {
+            const double a0 = start * to_radians;
+            const double a1 = (start + sweep) * to_radians;
+            buf_ += 'M';
+            append_point(cx + r * std::cos(a0), cy - r * std::sin(a0));
+            append_arc_to(r, sweep > 180.0, cx + r * std::cos(a1), cy - r * std::sin(a1));
+        }
+        spill();
+    }
+
+    void circle(double cx, double cy, double r, Color color) {
+        close_path();
+        buf_ += "<circle cx=\"";
+        append_number(cx);
+        buf_ += "\" cy=\"";
+        append_number(cy);
+        buf_ += "\" r=\"";
+        append_number(r);
+        append_attr("\" fill=\"", color);
+        buf_ += "/>\n";
+        ++elements_;
+        spill();
+    }
+
+    void close_path() {
+        if (!open_) return;
+        end_subpath();
+        buf_ += "\"/>\n";
+        open_ = false;
+        spill();
+    }
+
+    void finish() {
+        close_path();
+        os_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+        buf_.clear();
+    }
+
+    std::size_t elements() const { return elements_; }
+
+    // Shortest decimal for `v` at 1/1000 pixel, the precision kept in the file.
+    void append_number(double v) {
+        long long m = std::llround(v * 1000.0);
+        if (m < 0) {
+            buf_ += '-';
+            m = -m;
+        }
+        append_integer(static_cast<unsigned long long>(m / 1000));
+        int frac = static_cast<int>(m % 1000);
+        if (frac == 0) return;
+        char digits[4] = {'.', static_cast<char>('0' + frac / 100), static_cast<char>('0' + frac / 10 % 10),
+                          static_cast<char>('0' + frac % 10)};
+        int len = 4;
+        while (digits[len - 1] == '0') --len;
+        buf_.append(digits, static_cast<std::size_t>(len));
+    }
+
+    void append_integer(unsigned long long v) {
+        char digits[20];
+        int n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        while (n > 0) buf_ += digits[--n];
+    }
+
+    void append_color(Color c) {
+        static const char hex[] = "0123456789abcdef";
+        buf_ += '#';
+        for (unsigned char v : {c.r, c.g, c.b}) {
+            buf_ += hex[v >> 4];
+            buf_ += hex[v & 15];
+        }
+    }
+
+private:
+    std::ostream &os_;
+    std::string buf_;
+    std::vector<Fixed> points_; // the open stroke subpath
+    Style style_{Kind::line, Color{0, 0, 0}, 255, FillRule::even_odd};
+    bool open_ = false;
+    std::size_t elements_ = 0;
+
+    void end_subpath() {
+        const std::size_t n = points_.size();
+        if (n == 0) return;
+        // Back where it started: close it so the last corner is joined like the others.
+        const bool closed = n > 3 && points_.front() == points_.back();
+        const std::size_t last = closed ? n - 1 : n;
+        for (std::size_t i = 0; i < last; ++i) {
+            buf_ += i == 0 ? 'M' : (i == 1 ? 'L' : ' ');
+            append_number(points_[i].x / 256.0);
+            buf_ += ' ';
+            append_number(points_[i].y / 256.0);
+        }
+        if (closed) buf_ += 'Z';
+        points_.clear();
+        spill();
+    }
+
+    void append_point(double x, double y) {
+        append_number(x);
+        buf_ += ' ';
+        append_number(y);
+    }
+
+    // Counterclockwise on screen, which is SVG's negative sweep direction (y points down).
+    void append_arc_to(double r, bool large, double x, double y) {
+        buf_ += 'A';
+        append_point(r, r);
+        buf_ += large ? " 0 1 0 " : " 0 0 0 ";
+        append_point(x, y);
+    }
+
+    void append_attr(const char *name, Color c) {
+        buf_ += name;
+        append_color(c);
+        buf_ += '"';
+    }
+
+    void append_opacity(const char *name, std::uint8_t alpha) {
+        buf_ += name;
+        append_number(alpha / 255.0);
+        buf_ += '"';
+    }
+
+    void spill() {
+        if (buf_.size() < (1u << 16)) return;
+        os_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+        buf_.clear();
+    }
+};
+
+} // namespace detail
+
+// Write a recorded turtle program (see BasicTurtle::record_to) as a width x height SVG
+// document over a `background` rectangle. Pixel centres sit on whole coordinates as on the
+// canvas, so the drawing lines up with a raster export of the same list at any zoom. One
+// pixel wide lines become strokes merged into paths per pen; wide strokes, filled shapes
+// and stamps become filled paths and circles. Flood fills depend on the pixels around
+// them and are left out. Returns the number of elements drawn.
+template <class Pixel>
+std::size_t write_svg(std::ostream &os, const BasicDisplayList<Pixel> &list, std::size_t width, std::size_t height,
+                      Pixel background = pixel_traits<Pixel>::background()) {
+    PROJECTCODE_TRACE_SCOPE("svg", "export");
+    using Cmd = typename BasicDisplayList<Pixel>::Command;
+    using Op = typename BasicDisplayList<Pixel>::Op;
+    using Writer = detail::SvgPathWriter;
+
+    Writer out(os);
+    out.text("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    out.append_integer(width);
+    out.text("\" height=\"");
+    out.append_integer(height);
+    out.text("\" viewBox=\"0 0 ");
+    out.append_integer(width);
+    out.text(" ");
+    out.append_integer(height);
+    out.text("\">\n<rect width=\"100%\" height=\"100%\" fill=\"");
+    out.append_color(pixel_traits<Pixel>::to_rgb(background));
+    out.text("\"/>\n<g transform=\"translate(0.5 0.5)\" stroke-linejoin=\"round\">\n");
+
+    const std::vector<Point> &vertices = list.vertices();
+    for (const Cmd &cmd : list.commands()) {
+        const Color color = pixel_traits<Pixel>::to_rgb(cmd.color);
+        switch (cmd.op) {
+        case Op::line:
+            out.use({Writer::Kind::line, color, cmd.alpha, cmd.rule});
+            out.segment({std::int64_t{cmd.a} * 256, std::int64_t{cmd.b} * 256},
+                        {std::int64_t{cmd.c} * 256, std::int64_t{cmd.d} * 256});
+            break;
+        case Op::aa_line:
+            out.use({Writer::Kind::aa_line, color, cmd.alpha, cmd.rule});
+            out.segment({cmd.a, cmd.b}, {cmd.c, cmd.d});
+            break;
+        case Op::fill:
+            if (cmd.b < 3) break;
+            out.use({Writer::Kind::fill, color, cmd.alpha, cmd.rule});
+            out.polygon(vertices.data() + cmd.a, static_cast<std::size_t>(cmd.b));
+            break;
+        case Op::stamp:
+            if (cmd.c > 0) out.circle(cmd.a, cmd.b, cmd.c + 0.5, color);
+            break;
+        case Op::arc: {
+            const raster::ArcAngles arc = BasicDisplayList<Pixel>::unpack_arc(cmd.d);
+            if (arc.sweep <= 0) break;
+            out.use({Writer::Kind::line, color, cmd.alpha, cmd.rule});
+            out.arc(cmd.a, cmd.b, cmd.c, arc.start / 64.0, arc.sweep / 64.0);
+            break;
+        }
+        case Op::flood:
+            break;
+        }
+    }
+    out.close_path();
+    out.text("</g>\n</svg>\n");
+    out.finish();
+    return out.elements();
+}
+
+// write_svg() into `filename`. Returns false if the file could not be written.
+template <class Pixel>
+bool save_svg(const std::string &filename, const BasicDisplayList<Pixel> &list, std::size_t width,
+              std::size_t height, Pixel background = pixel_traits<Pixel>::background()) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) return false;
+    write_svg(file, list, width, height, background);
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+} // namespace projectcode
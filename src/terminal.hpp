@@ -0,0 +1,189 @@
+#pragma once
+
+#include "canvas.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#endif
+
+namespace projectcode {
+
+// Live view of a Canvas in an ANSI (VT100) terminal, for animating the ASCII turtle.
+// present() compares the canvas with the frame shown last and sends only the cells that
+// changed, each run reached with a cursor-position sequence, so the bytes per frame grow
+// with what moved rather than with the canvas size. A frame is assembled in one buffer
+// and handed to the stream in a single write, which keeps it from tearing over SSH.
+// Glyphs can be given 256-color palette entries with set_color().
+class AnsiTerminal {
+public:
+    static constexpr int default_color = -1;
+
+    explicit AnsiTerminal(std::ostream &os = std::cout) : os_(os) {
+        palette_.fill(default_color);
+        enable_escape_sequences();
+    }
+    AnsiTerminal(const AnsiTerminal &) = delete;
+    AnsiTerminal &operator=(const AnsiTerminal &) = delete;
+    ~AnsiTerminal() { finish(); }
+
+    // Draw `glyph` in palette entry `color` (0-255), or default_color for the terminal's
+    // own foreground.
+    void set_color(char glyph, int color) {
+        palette_[static_cast<unsigned char>(glyph)] = color;
+        invalidate();
+    }
+
+    // Repaint everything on the next present(), e.g. after the terminal was cleared.
+    void invalidate() { shown_.clear(); }
+
+    // Show `canvas` at the top-left corner of the terminal. Returns the bytes sent.
+    std::size_t present(const Canvas &canvas) {
+        const std::size_t w = canvas.width();
+        const std::size_t h = canvas.height();
+        out_.clear();
+        changed_ = 0;
+        if (!active_) {
+            out_ += "\x1b[?25l"; // hide the cursor while drawing
+            active_ = true;
+        }
+        if (w != width_ || shown_.size() != w * h) {
+            // The screen starts out blank in the default color; only the rest is sent.
+            out_ += "\x1b[0m\x1b[H\x1b[2J";
+            width_ = w;
+            height_ = h;
+            shown_.assign(w * h, ' ');
+            color_ = default_color;
+            cursor_x_ = 0;
+            cursor_y_ = 0;
+        }
+        for (std::size_t y = 0; y < h; ++y) {
+            const char *cur = canvas.row(y);
+            char *old = shown_.data() + y * w;
+            if (std::memcmp(cur, old, w) == 0) continue;
+            for (std::size_t x = 0; x < w; ++x) {
+                if (cur[x] == old[x]) continue;
+                move_to(cur, x, y);
+                put(cur[x]);
+                ++changed_;
+            }
+            std::memcpy(old, cur, w);
+        }
+        if (!out_.empty()) {
+            os_.write(out_.data(), static_cast<std::streamsize>(out_.size()));
+            os_.flush();
+        }
+        return out_.size();
+    }
+
+    // Cells sent by the last present().
+    std::size_t changed_cells() const { return changed_; }
+
+    // Reset the colors, park the cursor below the picture and show it again. Called on
+    // destruction; a later present() carries on where this one left off.
+    void finish() {
+        if (!active_) return;
+        out_ = "\x1b[0m";
+        append_cursor(height_, 0);
+        out_ += "\x1b[?25h";
+        os_.write(out_.data(), static_cast<std::streamsize>(out_.size()));
+        os_.flush();
+        color_ = default_color;
+        cursor_x_ = 0;
+        cursor_y_ = height_;
+        active_ = false;
+    }
+
+private:
+    std::ostream &os_;
+    std::array<int, 256> palette_;
+    std::vector<char> shown_; // the cells on screen, row-major
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+    std::string out_; // the frame being assembled, reused
+    std::size_t changed_ = 0;
+    bool active_ = false;
+    int color_ = default_color; // current foreground
+    std::size_t cursor_x_ = 0;
+    std::size_t cursor_y_ = 0;
+
+    // Move to cell (x, y) of the row `cur`. A short hop to the right rewrites the cells in
+    // between, which is shorter than a cursor sequence when their colors allow it.
+    void move_to(const char *cur, std::size_t x, std::size_t y) {
+        if (y == cursor_y_ && x == cursor_x_) return;
+        if (y == cursor_y_ && x > cursor_x_ && x - cursor_x_ <= 4) {
+            bool plain = true;
+            for (std::size_t i = cursor_x_; i < x && plain; ++i) {
+                plain = cur[i] == ' ' || color_of(cur[i]) == color_;
+            }
+            if (plain) {
+                out_.append(cur + cursor_x_, x - cursor_x_);
+                cursor_x_ = x;
+                return;
+            }
+        }
+        append_cursor(y, x);
+        cursor_x_ = x;
+        cursor_y_ = y;
+    }
+
+    void put(char glyph) {
+        const int c = color_of(glyph);
+        if (glyph != ' ' && c != color_) { // spaces look the same in any foreground
+            if (c == default_color) {
+                out_ += "\x1b[39m";
+            } else {
+                out_ += "\x1b[38;5;";
+                append_number(static_cast<std::size_t>(c));
+                out_ += 'm';
+            }
+            color_ = c;
+        }
+        out_ += glyph;
+        ++cursor_x_;
+    }
+
+    int color_of(char glyph) const { return palette_[static_cast<unsigned char>(glyph)]; }
+
+    void append_cursor(std::size_t y, std::size_t x) {
+        out_ += "\x1b[";
+        append_number(y + 1);
+        out_ += ';';
+        append_number(x + 1);
+        out_ += 'H';
+    }
+
+    void append_number(std::size_t v) {
+        char digits[20];
+        int n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        while (n > 0) out_ += digits[--n];
+    }
+
+    static void enable_escape_sequences() {
+#ifdef _WIN32
+        HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (out != INVALID_HANDLE_VALUE && GetConsoleMode(out, &mode)) {
+            SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+#endif
+    }
+};
+
+} // namespace projectcode
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace projectcode {
+
+// Small work-stealing thread pool. Every worker owns a deque: it pops its own newest task
+// and, when that runs dry, steals the oldest task of another worker. Tasks submitted from
+// a worker land on that worker's deque; others are dealt round-robin. wait() blocks until
+// every submitted task has finished, running queued tasks itself meanwhile; it counts the
+// calling task too, so tasks must not call it. parallel_for waits for its own batch only
+// and may be nested inside tasks. An exception thrown by a submitted task is dropped; one
+// thrown inside parallel_for is rethrown to its caller once the whole batch has finished.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+        for (unsigned i = 0; i < threads; ++i) threads_.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~ThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto &t : threads_) t.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+    void submit(std::function<void()> task) {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        std::size_t q = current_worker() == this ? current_index()
+                                                  : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        {
+            // Count the task before it becomes visible, so a thief never sees it uncounted.
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            ++queued_;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+            queues_[q]->tasks.push_back(std::move(task));
+        }
+        wake_.notify_one();
+        done_.notify_all(); // waiters help with queued tasks
+    }
+
+    void wait() {
+        help_until([this] { return pending_.load(std::memory_order_acquire) == 0; });
+    }
+
+    // Run fn(i) for every i in [0, count) across the pool and wait for all of them, running
+    // queued tasks meanwhile. Safe to call from a task: the caller helps with the inner
+    // batch instead of blocking a worker.
+    template <class Fn>
+    void parallel_for(std::size_t count, Fn fn) {
+        std::atomic<std::size_t> left{count};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        for (std::size_t i = 0; i < count; ++i) {
+            submit([this, &fn, &left, &error_mutex, &error, i] {
+                BatchDone done{*this, left};
+                try {
+                    fn(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                }
+            });
+        }
+        help_until([&left] { return left.load(std::memory_order_acquire) == 0; });
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<std::size_t> pending_{0}; // submitted and not yet finished
+    std::atomic<std::size_t> next_queue_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::size_t queued_ = 0; // tasks sitting in deques, guarded by sleep_mutex_
+    bool stopping_ = false;
+
+    static ThreadPool *&current_worker() {
+        thread_local ThreadPool *pool = nullptr;
+        return pool;
+    }
+
+    static std::size_t &current_index() {
+        thread_local std::size_t index = 0;
+        return index;
+    }
+
+    bool take(std::size_t home, std::function<void()> &task) {
+        {
+            Queue &own = *queues_[home];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return claimed();
+            }
+        }
+        for (std::size_t k = 1; k < queues_.size(); ++k) {
+            Queue &victim = *queues_[(home + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return claimed();
+            }
+        }
+        return false;
+    }
+
+    // Counts one parallel_for task as finished, even if it throws, and wakes the caller
+    // after the last one.
+    struct BatchDone {
+        ThreadPool &pool;
+        std::atomic<std::size_t> &left;
+        ~BatchDone() {
+            if (left.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+            std::lock_guard<std::mutex> lock(pool.sleep_mutex_);
+            pool.done_.notify_all();
+        }
+    };
+
+    // Run queued tasks, or sleep until one is queued or a task finishes, until finished().
+    template <class Finished>
+    void help_until(Finished finished) {
+        while (!finished()) {
+            std::function<void()> task;
+            std::size_t home = current_worker() == this ? current_index() : 0;
+            if (take(home, task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            done_.wait(lock, [&] { return finished() || queued_ > 0; });
+        }
+    }
+
+    bool claimed() {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        --queued_;
+        return true;
+    }
+
+    void run(std::function<void()> &task) {
+        try {
+            task();
+        } catch (...) {
+            // Nobody is left to report it to; letting it escape would terminate the worker.
+        }
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            done_.notify_all();
+        }
+    }
+
+    void worker_loop(std::size_t index) {
+        current_worker() = this;
+        current_index() = index;
+        while (true) {
+            std::function<void()> task;
+            if (take(index, task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+            if (stopping_ && queued_ == 0) return;
+        }
+    }
+};
+
+} // namespace projectcode
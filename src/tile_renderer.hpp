@@ -0,0 +1,207 @@
+#pragma once
+
+#include "canvas_rgb.hpp"
+#include "display_list.hpp"
+#include "raster.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace projectcode {
+
+// Parallel replay of a DisplayList. Commands are binned into square screen tiles by the
+// area they can touch, then tiles are rasterized concurrently on a ThreadPool. Each tile
+// is written by exactly one task, clipped to its own rectangle, and replays its bin in
+// recording order, so no pixel needs a lock and overdraw resolves exactly as in
+// DisplayList::replay(). The rasterizers clip exactly (see raster.hpp), which makes the
+// result bit-identical to serial replay. Bins are kept between calls to avoid
+// reallocating them every frame. A flood fill can spread over any number of tiles and
+// depends on everything drawn before it, so lists with flood fills are replayed serially.
+class TileRenderer {
+public:
+    explicit TileRenderer(ThreadPool &pool, int tile_size = 256) : pool_(pool), tile_size_(std::max(16, tile_size)) {}
+
+    int tile_size() const { return tile_size_; }
+
+    template <class Pixel>
+    void render(const BasicDisplayList<Pixel> &list, BasicCanvas<Pixel> &canvas) {
+        PROJECTCODE_TRACE_SCOPE("tiles", "render");
+        if (list.has_floods()) {
+            list.replay(canvas);
+            return;
+        }
+        tiles_x_ = (static_cast<int>(canvas.width()) + tile_size_ - 1) / tile_size_;
+        tiles_y_ = (static_cast<int>(canvas.height()) + tile_size_ - 1) / tile_size_;
+        const std::size_t tiles = static_cast<std::size_t>(tiles_x_) * static_cast<std::size_t>(tiles_y_);
+        if (bins_.size() < tiles) bins_.resize(tiles);
+        for (std::size_t t = 0; t < tiles; ++t) bins_[t].clear();
+
+        bin(list, canvas.bounds());
+
+        Pixel *origin = canvas.data();
+        const std::ptrdiff_t stride = static_cast<std::ptrdiff_t>(canvas.stride());
+        const Rect bounds = canvas.bounds();
+        pool_.parallel_for(tiles, [&](std::size_t t) {
+            if (bins_[t].empty()) return;
+            const Rect clip = intersect(tile_rect(t), bounds);
+            render_tile(list, bins_[t], origin, stride, clip);
+        });
+
+        for (std::size_t t = 0; t < tiles; ++t) {
+            if (!bins_[t].empty()) canvas.mark_dirty(tile_rect(t));
+        }
+    }
+
+private:
+    ThreadPool &pool_;
+    int tile_size_;
+    int tiles_x_ = 0;
+    int tiles_y_ = 0;
+    std::vector<std::vector<std::uint32_t>> bins_;
+
+    Rect tile_rect(std::size_t t) const {
+        const int tx = static_cast<int>(t % static_cast<std::size_t>(tiles_x_));
+        const int ty = static_cast<int>(t / static_cast<std::size_t>(tiles_x_));
+        return {tx * tile_size_, ty * tile_size_, tile_size_, tile_size_};
+    }
+
+    // Append `cmd` to every tile overlapping [x0, x1) x [y0, y1), which must lie inside the
+    // canvas. A command may be offered to the same tile several times in a row; the
+    // back() check keeps a single entry.
+    void add(std::uint32_t cmd, long long x0, long long y0, long long x1, long long y1, const Rect &bounds) {
+        x0 = std::max<long long>(x0, bounds.x);
+        y0 = std::max<long long>(y0, bounds.y);
+        x1 = std::min<long long>(x1, bounds.right());
+        y1 = std::min<long long>(y1, bounds.bottom());
+        if (x0 >= x1 || y0 >= y1) return;
+        const int tx0 = static_cast<int>(x0 / tile_size_);
+        const int tx1 = static_cast<int>((x1 - 1) / tile_size_);
+        const int ty0 = static_cast<int>(y0 / tile_size_);
+        const int ty1 = static_cast<int>((y1 - 1) / tile_size_);
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                auto &b = bins_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(tiles_x_) +
+                                static_cast<std::size_t>(tx)];
+                if (b.empty() || b.back() != cmd) b.push_back(cmd);
+            }
+        }
+    }
+
+    // Add the visible part of a line as tile-sized pieces padded by `pad` pixels.
+    void add_line(std::uint32_t cmd, const raster::LineWalk &w, int pad, const Rect &bounds) {
+        const long long dx = static_cast<long long>(w.x_last) - w.x;
+        const long long dy = static_cast<long long>(w.y_last) - w.y;
+        const long long pieces = std::max(std::llabs(dx), std::llabs(dy)) / tile_size_ + 1;
+        long long px = w.x;
+        long long py = w.y;
+        for (long long k = 1; k <= pieces; ++k) {
+            const long long qx = w.x + dx * k / pieces;
+            const long long qy = w.y + dy * k / pieces;
+            add(cmd, std::min(px, qx) - pad, std::min(py, qy) - pad, std::max(px, qx) + pad + 1,
+                std::max(py, qy) + pad + 1, bounds);
+            px = qx;
+            py = qy;
+        }
+    }
+
+    template <class Pixel>
+    void bin(const BasicDisplayList<Pixel> &list, const Rect &bounds) {
+        using Op = typename BasicDisplayList<Pixel>::Op;
+        const auto &cmds = list.commands();
+        const auto &verts = list.vertices();
+        for (std::size_t i = 0; i < cmds.size(); ++i) {
+            const auto &c = cmds[i];
+            const auto idx = static_cast<std::uint32_t>(i);
+            switch (c.op) {
+            case Op::line: {
+                // Bin tile-sized pieces of the visible part, so a long diagonal only lands
+                // in the tiles it crosses.
+                const raster::LineWalk w = raster::clip_line(bounds, c.a, c.b, c.c, c.d);
+                if (!w.empty()) add_line(idx, w, 1, bounds);
+                break;
+            }
+            case Op::aa_line: {
+                // Wu pixels lie within a pixel of the Bresenham line between the rounded
+                // endpoints, which may run just outside the canvas; bin with extra padding.
+                const Rect around = {bounds.x - 1, bounds.y - 1, bounds.w + 2, bounds.h + 2};
+                const raster::LineWalk w = raster::clip_line(around, raster::nearest_pixel(c.a), raster::nearest_pixel(c.b),
+                                                             raster::nearest_pixel(c.c), raster::nearest_pixel(c.d));
+                if (!w.empty()) add_line(idx, w, 2, bounds);
+                break;
+            }
+            case Op::fill: {
+                if (c.b < 3) break;
+                double x0 = verts[static_cast<std::size_t>(c.a)].x, x1 = x0;
+                double y0 = verts[static_cast<std::size_t>(c.a)].y, y1 = y0;
+                for (std::int32_t k = 1; k < c.b; ++k) {
+                    const Point &p = verts[static_cast<std::size_t>(c.a + k)];
+                    x0 = std::min(x0, p.x);
+                    x1 = std::max(x1, p.x);
+                    y0 = std::min(y0, p.y);
+                    y1 = std::max(y1, p.y);
+                }
+                const double lim = 1e15;
+                add(idx, static_cast<long long>(std::floor(std::max(x0, -lim))),
+                    static_cast<long long>(std::floor(std::max(y0, -lim))),
+                    static_cast<long long>(std::ceil(std::min(x1, lim))) + 1,
+                    static_cast<long long>(std::ceil(std::min(y1, lim))) + 1, bounds);
+                break;
+            }
+            case Op::stamp:
+            case Op::arc:
+                // Discs and outlines stay within the circle's bounding square.
+                if (c.c < (c.op == Op::stamp ? 1 : 0)) break;
+                add(idx, static_cast<long long>(c.a) - c.c, static_cast<long long>(c.b) - c.c,
+                    static_cast<long long>(c.a) + c.c + 1, static_cast<long long>(c.b) + c.c + 1, bounds);
+                break;
+            case Op::flood:
+                break; // lists with floods are replayed serially
+            }
+        }
+    }
+
+    template <class Pixel>
+    static void render_tile(const BasicDisplayList<Pixel> &list, const std::vector<std::uint32_t> &bin, Pixel *origin,
+                            std::ptrdiff_t stride, const Rect &clip) {
+        using Op = typename BasicDisplayList<Pixel>::Op;
+        const auto &cmds = list.commands();
+        const auto &verts = list.vertices();
+        for (std::uint32_t i : bin) {
+            const auto &c = cmds[i];
+            switch (c.op) {
+            case Op::line:
+                if (c.alpha == 255) {
+                    raster::draw_line(origin, stride, clip, c.a, c.b, c.c, c.d, c.color);
+                } else {
+                    raster::blend_line(origin, stride, clip, c.a, c.b, c.c, c.d, c.color, c.alpha);
+                }
+                break;
+            case Op::aa_line:
+                raster::draw_line_aa(origin, stride, clip, c.a, c.b, c.c, c.d, c.color, c.alpha);
+                break;
+            case Op::fill:
+                raster::fill_polygon(origin, stride, clip, verts.data() + c.a, static_cast<std::size_t>(c.b), c.rule,
+                                     c.color, c.alpha);
+                break;
+            case Op::stamp:
+                raster::fill_circle(origin, stride, clip, c.a, c.b, c.c, c.color);
+                break;
+            case Op::arc:
+                if (c.alpha != 0) {
+                    raster::draw_arc(origin, stride, clip, c.a, c.b, c.c, BasicDisplayList<Pixel>::unpack_arc(c.d),
+                                     c.color, c.alpha);
+                }
+                break;
+            case Op::flood:
+                break;
+            }
+        }
+    }
+};
+
+} // namespace projectcode
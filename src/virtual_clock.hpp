@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+namespace projectcode {
+
+// A simulated timeline for headless runs. Turtles attached with set_clock() advance it by
+// their delay instead of sleeping, so an animation that would take minutes on screen runs
+// as fast as it can draw. With a frame rate set, on_tick() is called once for every frame
+// boundary the timeline passes; frame k falls at k / fps seconds, computed in integer
+// microseconds so long runs do not drift.
+class VirtualClock {
+public:
+    using TickFn = std::function<void(std::uint64_t frame)>;
+
+    explicit VirtualClock(unsigned fps = 0) : fps_(fps) {}
+
+    void on_tick(TickFn fn) { tick_ = std::move(fn); }
+
+    unsigned fps() const { return fps_; }
+    std::uint64_t now_us() const { return now_us_; }
+    double now_ms() const { return static_cast<double>(now_us_) / 1000.0; }
+    std::uint64_t frames() const { return frames_; } // ticks delivered so far
+
+    void advance_ms(unsigned ms) { advance_us(std::uint64_t{ms} * 1000); }
+
+    void advance_us(std::uint64_t us) {
+        now_us_ += us;
+        if (fps_ == 0) return;
+        while (frame_time(frames_ + 1) <= now_us_) {
+            const std::uint64_t frame = frames_++;
+            if (tick_) tick_(frame);
+        }
+    }
+
+private:
+    unsigned fps_;
+    std::uint64_t now_us_ = 0;
+    std::uint64_t frames_ = 0;
+    TickFn tick_;
+
+    std::uint64_t frame_time(std::uint64_t frame) const { return frame * 1000000 / fps_; }
+};
+
+} // namespace projectcode
@@ -4,11 +4,15 @@
 #include <windows.h>
 
 #include "canvas_rgb.hpp"
+#include "framebuffer.hpp"
+#include "render_pipeline.hpp"
 #include "turtle_rgb.hpp"
 
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace projectcode {
@@ -18,42 +22,27 @@ struct WindowOptions {
     int height = 600;
     Color background{240, 248, 255};
     std::wstring title = L"ProjectCODE";
+    // Run draw code on its own thread and present at `fps` (see RenderPipeline) instead
+    // of painting synchronously inside every flush().
+    bool pipelined = false;
+    unsigned fps = 60;
 };
 
 namespace detail {
-struct Framebuffer {
-    std::vector<std::uint8_t> bytes;
+// Copy one framebuffer rectangle (canvas coordinates) to the window.
+inline void blit_framebuffer(HDC hdc, const Framebuffer &fb, const Rect &r) {
     BITMAPINFO bmi{};
-};
-
-inline Framebuffer make_framebuffer(const CanvasRGB &canvas) {
-    const int width = static_cast<int>(canvas.width());
-    const int height = static_cast<int>(canvas.height());
-    const std::size_t row_stride = static_cast<std::size_t>(width) * 3;
-    const std::size_t row_padded = (row_stride + 3u) & ~3u; // 4-byte alignment
-    Framebuffer fb;
-    fb.bytes.resize(row_padded * static_cast<std::size_t>(height), 0);
-
-    fb.bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    fb.bmi.bmiHeader.biWidth = width;
-    fb.bmi.bmiHeader.biHeight = -height; // top-down to match canvas coords
-    fb.bmi.bmiHeader.biPlanes = 1;
-    fb.bmi.bmiHeader.biBitCount = 24;
-    fb.bmi.bmiHeader.biCompression = BI_RGB;
-    fb.bmi.bmiHeader.biSizeImage = static_cast<DWORD>(row_padded * static_cast<std::size_t>(height));
-
-    const auto &pixels = canvas.data();
-    for (int y = 0; y < height; ++y) {
-        std::uint8_t *row = fb.bytes.data() + static_cast<std::size_t>(y) * row_padded;
-        for (int x = 0; x < width; ++x) {
-            const Color &c = pixels[static_cast<std::size_t>(y) * canvas.width() + static_cast<std::size_t>(x)];
-            row[x * 3 + 0] = c.b;
-            row[x * 3 + 1] = c.g;
-            row[x * 3 + 2] = c.r;
-        }
-    }
-
-    return fb;
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = fb.width;
+    bmi.bmiHeader.biHeight = fb.height; // bottom-up
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = static_cast<WORD>(fb.pixel_bytes * 8);
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bmi.bmiHeader.biSizeImage = static_cast<DWORD>(fb.bytes.size());
+    StretchDIBits(hdc,
+                  r.x, r.y, r.w, r.h,
+                  r.x, fb.height - r.bottom(), r.w, r.h, // source y counts from the bottom row
+                  fb.bytes.data(), &bmi, DIB_RGB_COLORS, SRCCOPY);
 }
 
 inline bool pump_messages() {
@@ -66,6 +55,25 @@ inline bool pump_messages() {
     return true;
 }
 
+// Presents pipeline frames into the window and keeps its message queue pumped.
+class WindowPresenter : public Presenter {
+public:
+    WindowPresenter(HDC hdc, Framebuffer &fb) : hdc_(hdc), fb_(fb) {}
+
+    bool present(const CanvasRGB &canvas, const std::vector<Rect> &dirty) override {
+        PROJECTCODE_TRACE_SCOPE("window", "present");
+        for (const Rect &r : dirty) {
+            update_framebuffer(fb_, canvas, r);
+            blit_framebuffer(hdc_, fb_, r);
+        }
+        return pump_messages();
+    }
+
+private:
+    HDC hdc_;
+    Framebuffer &fb_;
+};
+
 inline LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     if (msg == WM_DESTROY) {
         PostQuitMessage(0);
@@ -78,6 +86,7 @@ inline LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
 // Run a user-provided draw routine inside a Win32 window.
 // draw_fn signature: void(CanvasRGB& canvas, TurtleRGB& turtle, std::function<bool()> flush)
 // flush() repaints the window with the current canvas and pumps messages; returns false if WM_QUIT.
+// With opts.pipelined, draw_fn runs on a worker thread and this thread presents frames.
 template <class DrawFn>
 int run_window(const WindowOptions &opts, DrawFn draw_fn) {
     HINSTANCE hInstance = GetModuleHandle(nullptr);
@@ -116,23 +125,41 @@ int run_window(const WindowOptions &opts, DrawFn draw_fn) {
     CanvasRGB canvas(static_cast<std::size_t>(opts.width), static_cast<std::size_t>(opts.height), opts.background);
     TurtleRGB turtle(canvas, 0, 0);
 
-    auto paint = [&](const CanvasRGB &c) {
-        detail::Framebuffer fb = detail::make_framebuffer(c);
-        StretchDIBits(hdc,
-                      0, 0, opts.width, opts.height,
-                      0, 0, opts.width, opts.height,
-                      fb.bytes.data(), &fb.bmi, DIB_RGB_COLORS, SRCCOPY);
+    // One framebuffer for the whole run; each paint converts and blits only what the
+    // canvas reports as dirty since the previous paint.
+    detail::Framebuffer fb = detail::make_framebuffer(canvas);
+    canvas.clear_dirty();
+    detail::blit_framebuffer(hdc, fb, canvas.bounds());
+
+    auto paint = [&]() {
+        if (canvas.dirty().empty()) return;
+        PROJECTCODE_TRACE_SCOPE("window", "present");
+        for (const Rect &r : canvas.dirty_rects()) {
+            detail::update_framebuffer(fb, canvas, r);
+            detail::blit_framebuffer(hdc, fb, r);
+        }
+        canvas.clear_dirty();
     };
 
     std::function<bool()> flush = [&]() {
-        paint(canvas);
+        PROJECTCODE_TRACE_SCOPE("window", "flush");
+        turtle.finish_path();
+        paint();
         return detail::pump_messages();
     };
 
-    draw_fn(canvas, turtle, flush);
+    if (opts.pipelined) {
+        detail::WindowPresenter presenter(hdc, fb);
+        PipelineOptions popts;
+        popts.fps = opts.fps;
+        RenderPipeline(canvas, presenter, popts).run(draw_fn);
+    } else {
+        draw_fn(canvas, turtle, flush);
+        turtle.finish_path();
+    }
 
     // Final paint.
-    paint(canvas);
+    paint();
 
     // Keep window open until closed.
     MSG msg;
@@ -0,0 +1,1078 @@
+// Regression checks run by ctest, one test per argument:
+//
+//   projectcode_tests draw_line|kernels|tile_renderer|thread_pool|svg_export|png_roundtrip|
+//                     sparse_canvas|flood_fill|image_compare|layer_stack|terminal|render_pipeline
+//
+// Each compares a fast path with a simple reference: canvas lines with a textbook
+// Bresenham walk, every SIMD kernel with its scalar version, TileRenderer with serial
+// DisplayList replay, nested parallel_for with a plain count, throwing pool tasks and
+// batch jobs with the failures they should report, SVG strokes with the pixels replay
+// draws, the PNG encoder's output, decoded here, with the PPM writer's, the sparse canvas
+// with the dense one, scanline flood fill with a pixel-by-pixel fill, PPM and BMP files
+// with the canvas saved to them, incremental layer composites with full ones, what the
+// terminal sends with the canvas it shows, and pipelined drawing with direct drawing.
+
+#include "batch_renderer.hpp"
+#include "canvas_rgb.hpp"
+#include "display_list.hpp"
+#include "image_compare.hpp"
+#include "layer_stack.hpp"
+#include "pixel_kernels.hpp"
+#include "png_writer.hpp"
+#include "render_pipeline.hpp"
+#include "sparse_canvas.hpp"
+#include "svg_writer.hpp"
+#include "terminal.hpp"
+#include "thread_pool.hpp"
+#include "tile_renderer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace projectcode;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);                              \
+            ++failures;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+bool same_pixels(const CanvasRGB &a, const CanvasRGB &b) {
+    if (a.width() != b.width() || a.height() != b.height()) return false;
+    for (std::size_t y = 0; y < a.height(); ++y) {
+        if (std::memcmp(a.row(y), b.row(y), a.width() * 3) != 0) return false;
+    }
+    return true;
+}
+
+Color random_color(std::mt19937 &rng) {
+    return {static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng())};
+}
+
+// --- draw_line ----------------------------------------------------------------------------
+
+// Bresenham with the error term starting at half a step, visiting every pixel from
+// (x0, y0) to (x1, y1) inclusive; set_pixel drops the ones off the canvas.
+void reference_line(CanvasRGB &canvas, int x0, int y0, int x1, int y1, Color color) {
+    const int dx = std::abs(x1 - x0);
+    const int dy = std::abs(y1 - y0);
+    const int sx = x0 < x1 ? 1 : -1;
+    const int sy = y0 < y1 ? 1 : -1;
+    const bool x_major = dx >= dy;
+    const int n = x_major ? dx : dy;
+    const int d = x_major ? dy : dx;
+    int x = x0;
+    int y = y0;
+    long long err = n;
+    for (int j = 0;; ++j) {
+        canvas.set_pixel(x, y, color);
+        if (j == n) break;
+        err += 2LL * d;
+        const bool minor = err >= 2LL * n;
+        if (minor) err -= 2LL * n;
+        if (x_major || minor) x += sx;
+        if (!x_major || minor) y += sy;
+    }
+}
+
+void test_draw_line() {
+    std::mt19937 rng(1);
+    const int w = 173;
+    const int h = 131;
+    for (int i = 0; i < 2000; ++i) {
+        // Endpoints up to a canvas size outside it on every side, so clipping is exercised.
+        auto coord = [&](int size) { return static_cast<int>(rng() % static_cast<unsigned>(3 * size)) - size; };
+        const int x0 = coord(w), y0 = coord(h), x1 = coord(w), y1 = coord(h);
+        CanvasRGB fast(w, h);
+        CanvasRGB slow(w, h);
+        fast.draw_line(x0, y0, x1, y1, Color{0, 0, 0});
+        reference_line(slow, x0, y0, x1, y1, Color{0, 0, 0});
+        if (!same_pixels(fast, slow)) {
+            std::fprintf(stderr, "line (%d, %d)-(%d, %d) differs\n", x0, y0, x1, y1);
+            ++failures;
+        }
+    }
+}
+
+// --- kernels ------------------------------------------------------------------------------
+
+std::vector<std::uint8_t> random_bytes(std::mt19937 &rng, std::size_t n) {
+    std::vector<std::uint8_t> v(n);
+    for (auto &b : v) b = static_cast<std::uint8_t>(rng());
+    return v;
+}
+
+// n pixels of `px` (bpp bytes) with one random byte changed at a random position, or
+// none at all, so match runs stop anywhere in a vector or not at all.
+std::vector<std::uint8_t> run_of(std::mt19937 &rng, std::size_t n, const std::uint8_t *px, std::size_t bpp) {
+    std::vector<std::uint8_t> v(n * bpp + 1);
+    for (std::size_t i = 0; i < n; ++i) std::memcpy(v.data() + i * bpp, px, bpp);
+    if (n && rng() % 4) v[rng() % (n * bpp)] ^= static_cast<std::uint8_t>(1 + rng() % 255);
+    return v;
+}
+
+// first and last only mean something when pixels differ.
+bool operator==(const kernels::Diff24 &a, const kernels::Diff24 &b) {
+    return a.differing == b.differing && a.max_delta == b.max_delta && a.sum_sq == b.sum_sq &&
+           (a.differing == 0 || (a.first == b.first && a.last == b.last));
+}
+
+// Run `fn` at the scalar level and at `level` and require equal results.
+template <class Fn>
+void same_at(SimdLevel level, const char *name, std::size_t n, Fn fn) {
+    kernels::set_level(SimdLevel::scalar);
+    const auto expected = fn();
+    kernels::set_level(level);
+    const auto actual = fn();
+    if (!(expected == actual)) {
+        std::fprintf(stderr, "%s differs from scalar at level %d, n = %zu\n", name, static_cast<int>(level), n);
+        ++failures;
+    }
+}
+
+void test_kernels() {
+    using Bytes = std::vector<std::uint8_t>;
+    std::mt19937 rng(2);
+    for (int l = static_cast<int>(SimdLevel::sse2); l <= static_cast<int>(kernels::detected_level()); ++l) {
+        const SimdLevel level = static_cast<SimdLevel>(l);
+        for (int i = 0; i < 300; ++i) {
+            const std::size_t n = rng() % 200;
+            const std::size_t skew = rng() % 4; // misalign the buffers
+            const Bytes a = random_bytes(rng, n * 4 + 4);
+            const Bytes b = random_bytes(rng, n * 4 + 4);
+            const Bytes px = random_bytes(rng, 4);
+            std::uint32_t v;
+            std::memcpy(&v, px.data(), 4);
+            const unsigned alpha = rng() % 256;
+            Bytes premultiplied = b; // some fully transparent, for over32_row's skip path
+            for (std::size_t k = 0; k + 4 <= premultiplied.size(); k += 4) {
+                if (rng() % 4 == 0) premultiplied[k + 3] = 0;
+                for (int c = 0; c < 3; ++c) {
+                    premultiplied[k + c] = static_cast<std::uint8_t>(premultiplied[k + c] * premultiplied[k + 3] / 255);
+                }
+            }
+            Bytes changed(a.begin(), a.begin() + static_cast<std::ptrdiff_t>(n * 3));
+            for (std::size_t k = rng() % 8; k < changed.size(); k += 1 + rng() % 40) {
+                changed[k] = static_cast<std::uint8_t>(rng());
+            }
+            const unsigned tolerance = rng() % 4 ? 0u : rng() % 64;
+            std::vector<std::uint16_t> sums(n * 4);
+            for (auto &x : sums) x = static_cast<std::uint16_t>(rng());
+
+            same_at(level, "fill24", n, [&] {
+                Bytes out(n * 3 + skew);
+                kernels::fill24(out.data() + skew, n, px.data());
+                return out;
+            });
+            same_at(level, "fill32", n, [&] {
+                Bytes out(n * 4 + skew);
+                kernels::fill32(out.data() + skew, n, v);
+                return out;
+            });
+            same_at(level, "swap_rb24", n, [&] {
+                Bytes out(n * 3);
+                kernels::swap_rb24(a.data() + skew, out.data(), n);
+                return out;
+            });
+            same_at(level, "swap_rb32", n, [&] {
+                Bytes out(n * 4);
+                kernels::swap_rb32(a.data() + skew, out.data(), n);
+                return out;
+            });
+            for (bool swap : {false, true}) {
+                same_at(level, "pack24", n, [&] {
+                    Bytes out(n * 3);
+                    kernels::pack24(a.data() + skew, out.data(), n, swap);
+                    return out;
+                });
+                same_at(level, "expand32", n, [&] {
+                    Bytes out(n * 4);
+                    kernels::expand32(a.data() + skew, out.data(), n, swap);
+                    return out;
+                });
+            }
+            same_at(level, "blend32", n, [&] {
+                Bytes out = a;
+                kernels::blend32(out.data() + skew, n, v);
+                return out;
+            });
+            same_at(level, "blend32_row", n, [&] {
+                Bytes out = a;
+                kernels::blend32_row(out.data(), b.data() + skew, n);
+                return out;
+            });
+            same_at(level, "over32_row", n, [&] {
+                Bytes out = a;
+                kernels::over32_row(out.data() + skew, premultiplied.data(), n, alpha);
+                return out;
+            });
+            const Bytes run24 = run_of(rng, n, px.data(), 3);
+            const Bytes run32 = run_of(rng, n, px.data(), 4);
+            same_at(level, "match24", n, [&] { return kernels::match24(run24.data(), n, px.data()); });
+            same_at(level, "match24_back", n,
+                    [&] { return kernels::match24_back(run24.data() + n * 3, n, px.data()); });
+            same_at(level, "match32", n, [&] { return kernels::match32(run32.data(), n, v); });
+            same_at(level, "match32_back", n, [&] { return kernels::match32_back(run32.data() + n * 4, n, v); });
+            same_at(level, "diff24", n, [&] { return kernels::diff24(a.data(), changed.data(), n, tolerance); });
+            same_at(level, "accumulate8", n, [&] {
+                std::vector<std::uint16_t> acc = sums;
+                kernels::accumulate8(acc.data(), a.data() + skew, n * 4);
+                return acc;
+            });
+        }
+    }
+    kernels::set_level(kernels::detected_level());
+}
+
+// --- tile_renderer ------------------------------------------------------------------------
+
+DisplayList random_list(std::mt19937 &rng, int w, int h, std::size_t commands, bool floods) {
+    DisplayList list;
+    auto x = [&] { return static_cast<int>(rng() % static_cast<unsigned>(w + 80)) - 40; };
+    auto y = [&] { return static_cast<int>(rng() % static_cast<unsigned>(h + 80)) - 40; };
+    auto alpha = [&] { return static_cast<std::uint8_t>(rng() % 3 ? 255 : rng() % 256); };
+    for (std::size_t i = 0; i < commands; ++i) {
+        const Color c = random_color(rng);
+        switch (rng() % (floods ? 6 : 5)) {
+        case 0: list.add_line(x(), y(), x(), y(), c, alpha()); break;
+        case 1:
+            list.add_aa_line(raster::to_subpixel(x() + (rng() % 256) / 256.0), raster::to_subpixel(y() + 0.5),
+                             raster::to_subpixel(x() + 0.25), raster::to_subpixel(y()), c, alpha());
+            break;
+        case 2: {
+            std::vector<Point> points(3 + rng() % 5);
+            for (auto &p : points) p = {static_cast<double>(x()), static_cast<double>(y())};
+            list.add_fill(points, c, rng() % 2 ? FillRule::nonzero : FillRule::even_odd, alpha());
+            break;
+        }
+        case 3: list.add_stamp(x(), y(), static_cast<int>(rng() % 30), c); break;
+        case 4:
+            list.add_arc(x(), y(), static_cast<int>(rng() % 80),
+                         raster::to_arc_angles(rng() % 360, static_cast<int>(rng() % 721) - 360), c, alpha());
+            break;
+        default: list.add_flood(x(), y(), c); break;
+        }
+    }
+    return list;
+}
+
+void test_tile_renderer() {
+    std::mt19937 rng(3);
+    ThreadPool pool(4);
+    TileRenderer renderer(pool, 64);
+    for (int i = 0; i < 40; ++i) {
+        const int w = 100 + static_cast<int>(rng() % 500);
+        const int h = 100 + static_cast<int>(rng() % 400);
+        const DisplayList list = random_list(rng, w, h, 1 + rng() % 400, i % 8 == 7);
+        CanvasRGB serial(w, h);
+        CanvasRGB tiled(w, h);
+        list.replay(serial);
+        renderer.render(list, tiled);
+        if (!same_pixels(serial, tiled)) {
+            std::fprintf(stderr, "list %d (%dx%d, %zu commands) renders differently in tiles\n", i, w, h, list.size());
+            ++failures;
+        }
+    }
+}
+
+// --- thread_pool --------------------------------------------------------------------------
+
+// parallel_for inside pool tasks, as a batch job rendering with a TileRenderer on its own
+// pool does. Each level has more tasks than the pool has threads, so a waiting caller
+// must run the inner tasks itself.
+void test_thread_pool() {
+    for (int round = 0; round < 50; ++round) {
+        ThreadPool pool(2);
+        std::atomic<int> count{0};
+        pool.parallel_for(3, [&](std::size_t) {
+            pool.parallel_for(4, [&](std::size_t) { pool.parallel_for(2, [&](std::size_t) { ++count; }); });
+        });
+        CHECK(count == 24);
+    }
+
+    std::mt19937 rng(5);
+    ThreadPool pool(2);
+    std::vector<DisplayList> lists;
+    for (int i = 0; i < 6; ++i) lists.push_back(random_list(rng, 300, 200, 100, false));
+    std::vector<int> same(lists.size(), 0);
+    pool.parallel_for(lists.size(), [&](std::size_t i) {
+        TileRenderer renderer(pool, 64);
+        CanvasRGB serial(300, 200);
+        CanvasRGB tiled(300, 200);
+        lists[i].replay(serial);
+        renderer.render(lists[i], tiled);
+        same[i] = same_pixels(serial, tiled);
+    });
+    for (int ok : same) CHECK(ok);
+
+    // A throwing task neither kills its worker nor leaves wait() hanging; parallel_for
+    // rethrows only after every task of its batch has run.
+    pool.submit([] { throw std::runtime_error("task"); });
+    pool.wait();
+    std::atomic<int> ran{0};
+    bool rethrown = false;
+    try {
+        pool.parallel_for(8, [&](std::size_t i) {
+            ++ran;
+            if (i % 3 == 0) throw std::runtime_error("batch");
+        });
+    } catch (const std::runtime_error &) {
+        rethrown = true;
+    }
+    CHECK(rethrown && ran == 8);
+
+    CanvasPool canvases;
+    BatchRenderer batch(pool, canvases);
+    std::vector<BatchJob> jobs(4);
+    for (auto &job : jobs) job.draw = [](CanvasRGB &canvas, TurtleRGB &) { canvas.draw_line(0, 0, 9, 9, Color{}); };
+    jobs[1].draw = [](CanvasRGB &, TurtleRGB &) { throw std::runtime_error("job"); };
+    jobs[2].output = "no_such_dir/out.ppm";
+    jobs[3].width = jobs[3].height = std::size_t{1} << 31; // more than a vector can hold
+    CHECK(batch.run(jobs).failed == 3);
+}
+
+// --- svg_export ---------------------------------------------------------------------------
+
+// Horizontal, vertical and one-pixel lines, whose SVG strokes (1 wide, pixel centres on
+// whole coordinates) must fully cover exactly the pixels replay draws, and an
+// anti-aliased line, which keeps SVG's default butt caps.
+void test_svg_export() {
+    DisplayList list;
+    list.add_line(2, 2, 10, 2, Color{255, 0, 0});
+    list.add_line(4, 12, 4, 5, Color{0, 255, 0});
+    list.add_line(7, 7, 7, 7, Color{0, 0, 255});
+    list.add_aa_line(raster::to_subpixel(1.0), raster::to_subpixel(14.0), raster::to_subpixel(13.5),
+                     raster::to_subpixel(10.0), Color{0, 0, 0});
+    CanvasRGB canvas(16, 16);
+    list.replay(canvas);
+    std::ostringstream svg;
+    write_svg(svg, list, canvas.width(), canvas.height());
+
+    std::istringstream lines(svg.str());
+    std::string line;
+    int strokes = 0;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 5, "<path") != 0) continue;
+        const bool square = line.find("stroke-linecap=\"square\"") != std::string::npos;
+        if (line.find("stroke=\"#000000\"") != std::string::npos) {
+            CHECK(line.find("stroke-linecap") == std::string::npos);
+            continue;
+        }
+        CHECK(square);
+        unsigned r = 0, g = 0, b = 0;
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        const std::size_t stroke = line.find("stroke=\"#");
+        const std::size_t d = line.find(" d=\"");
+        CHECK(stroke != std::string::npos && d != std::string::npos);
+        if (stroke == std::string::npos || d == std::string::npos) continue;
+        CHECK(std::sscanf(line.c_str() + stroke + 9, "%2x%2x%2x", &r, &g, &b) == 3);
+        CHECK(std::sscanf(line.c_str() + d + 4, "M%d %dL%d %d", &x0, &y0, &x1, &y1) == 4);
+        // The stroke is a 1 x length rectangle around the segment, longer by half a pixel
+        // at each square cap; pixel (x, y) is the unit square around (x, y).
+        const double ext = square ? 0.5 : 0.0;
+        for (int y = 0; y < 16; ++y) {
+            for (int x = 0; x < 16; ++x) {
+                const bool covered = std::min(x0, x1) - ext <= x - 0.5 && x + 0.5 <= std::max(x0, x1) + ext &&
+                                     std::min(y0, y1) - ext <= y - 0.5 && y + 0.5 <= std::max(y0, y1) + ext &&
+                                     (x0 == x1 ? x == x0 : true) && (y0 == y1 ? y == y0 : true);
+                const Color p = canvas.get_pixel(x, y);
+                const bool drawn = p.r == r && p.g == g && p.b == b;
+                if (covered != drawn) {
+                    std::fprintf(stderr, "svg stroke %s: pixel (%d, %d) %s\n", line.c_str() + d, x, y,
+                                 drawn ? "drawn but not covered" : "covered but not drawn");
+                    ++failures;
+                }
+            }
+        }
+        ++strokes;
+    }
+    CHECK(strokes == 3);
+}
+
+// --- png_roundtrip ------------------------------------------------------------------------
+
+// Inflate for the block types DeflateEncoder emits (stored and fixed Huffman). Returns
+// false on anything else or on a malformed stream.
+class Inflater {
+public:
+    Inflater(const std::uint8_t *p, std::size_t n) : p_(p), n_(n) {}
+
+    bool run(std::vector<std::uint8_t> &out) {
+        for (bool last = false; !last;) {
+            last = bits(1) != 0;
+            const unsigned type = bits(2);
+            if (type == 0) {
+                if (bit_) { // to the byte boundary
+                    bit_ = 0;
+                    ++pos_;
+                }
+                if (pos_ + 4 > n_) return false;
+                const unsigned len = p_[pos_] | p_[pos_ + 1] << 8;
+                const unsigned nlen = p_[pos_ + 2] | p_[pos_ + 3] << 8;
+                pos_ += 4;
+                if ((len ^ 0xFFFFu) != nlen || pos_ + len > n_) return false;
+                out.insert(out.end(), p_ + pos_, p_ + pos_ + len);
+                pos_ += len;
+            } else if (type == 1) {
+                if (!fixed_block(out)) return false;
+            } else {
+                return false;
+            }
+            if (overrun_) return false;
+        }
+        if (bit_) ++pos_;
+        rest_ = pos_;
+        return true;
+    }
+
+    std::size_t consumed() const { return rest_; }
+
+private:
+    const std::uint8_t *p_;
+    std::size_t n_;
+    std::size_t pos_ = 0;
+    unsigned bit_ = 0;
+    std::size_t rest_ = 0;
+    bool overrun_ = false;
+
+    unsigned bits(unsigned count) {
+        unsigned v = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            if (pos_ >= n_) {
+                overrun_ = true;
+                return 0;
+            }
+            v |= ((p_[pos_] >> bit_) & 1u) << i;
+            if (++bit_ == 8) {
+                bit_ = 0;
+                ++pos_;
+            }
+        }
+        return v;
+    }
+
+    // Huffman codes arrive most significant bit first.
+    unsigned code_bits(unsigned count) {
+        unsigned v = 0;
+        for (unsigned i = 0; i < count; ++i) v = (v << 1) | bits(1);
+        return v;
+    }
+
+    int fixed_symbol() {
+        unsigned code = code_bits(7);
+        if (code <= 0x17) return static_cast<int>(256 + code);
+        code = (code << 1) | bits(1);
+        if (code >= 0x30 && code <= 0xBF) return static_cast<int>(code - 0x30);
+        if (code >= 0xC0 && code <= 0xC7) return static_cast<int>(280 + code - 0xC0);
+        code = (code << 1) | bits(1);
+        return static_cast<int>(144 + code - 0x190);
+    }
+
+    bool fixed_block(std::vector<std::uint8_t> &out) {
+        static const unsigned len_base[] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                            31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const unsigned len_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const unsigned dist_base[] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                             33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                             1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const unsigned dist_extra[] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                              6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        for (;;) {
+            if (overrun_) return false;
+            const int sym = fixed_symbol();
+            if (sym < 256) {
+                out.push_back(static_cast<std::uint8_t>(sym));
+                continue;
+            }
+            if (sym == 256) return true;
+            if (sym > 285) return false;
+            const unsigned len = len_base[sym - 257] + bits(len_extra[sym - 257]);
+            const unsigned dcode = code_bits(5);
+            if (dcode > 29) return false;
+            const std::size_t dist = dist_base[dcode] + bits(dist_extra[dcode]);
+            if (dist > out.size()) return false;
+            for (unsigned k = 0; k < len; ++k) out.push_back(out[out.size() - dist]);
+        }
+    }
+};
+
+std::uint32_t load_u32be(const std::uint8_t *p) {
+    return static_cast<std::uint32_t>(p[0]) << 24 | static_cast<std::uint32_t>(p[1]) << 16 |
+           static_cast<std::uint32_t>(p[2]) << 8 | p[3];
+}
+
+std::vector<std::uint8_t> read_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+// Decode an 8-bit RGB PNG into packed rows, checking chunk CRCs and the zlib Adler-32.
+bool decode_png(const std::vector<std::uint8_t> &file, std::size_t &width, std::size_t &height,
+                std::vector<std::uint8_t> &rgb) {
+    static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (file.size() < 8 || std::memcmp(file.data(), signature, 8) != 0) return false;
+    std::vector<std::uint8_t> zlib;
+    bool ended = false;
+    for (std::size_t pos = 8; !ended;) {
+        if (pos + 12 > file.size()) return false;
+        const std::uint32_t len = load_u32be(file.data() + pos);
+        if (pos + 12 + len > file.size()) return false;
+        const std::uint8_t *type = file.data() + pos + 4;
+        const std::uint8_t *data = type + 4;
+        if (detail::crc32(0, type, len + 4) != load_u32be(data + len)) return false;
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (len != 13 || data[8] != 8 || data[9] != 2 || data[12] != 0) return false;
+            width = load_u32be(data);
+            height = load_u32be(data + 4);
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            zlib.insert(zlib.end(), data, data + len);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+        pos += 12 + len;
+    }
+    if (zlib.size() < 6 || (zlib[0] & 0x0F) != 8 || (zlib[0] << 8 | zlib[1]) % 31 != 0) return false;
+    std::vector<std::uint8_t> raw;
+    Inflater inflater(zlib.data() + 2, zlib.size() - 2);
+    if (!inflater.run(raw) || inflater.consumed() + 6 != zlib.size()) return false;
+    if (detail::adler32(1, raw.data(), raw.size()) != load_u32be(zlib.data() + zlib.size() - 4)) return false;
+
+    const std::size_t stride = width * 3;
+    if (raw.size() != height * (stride + 1)) return false;
+    rgb.assign(height * stride, 0);
+    for (std::size_t y = 0; y < height; ++y) {
+        const std::uint8_t *src = raw.data() + y * (stride + 1);
+        std::uint8_t *cur = rgb.data() + y * stride;
+        const std::uint8_t *prev = y ? cur - stride : nullptr;
+        for (std::size_t i = 0; i < stride; ++i) {
+            const int a = i >= 3 ? cur[i - 3] : 0;
+            const int b = prev ? prev[i] : 0;
+            const int c = prev && i >= 3 ? prev[i - 3] : 0;
+            int pred = 0;
+            switch (src[0]) {
+            case 0: break;
+            case 1: pred = a; break;
+            case 2: pred = b; break;
+            case 3: pred = (a + b) / 2; break;
+            case 4: pred = detail::paeth(a, b, c); break;
+            default: return false;
+            }
+            cur[i] = static_cast<std::uint8_t>(src[1 + i] + pred);
+        }
+    }
+    return true;
+}
+
+void test_png_roundtrip() {
+    std::mt19937 rng(4);
+    ThreadPool pool(3);
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string png = (dir / "projectcode_tests.png").string();
+    const std::string ppm = (dir / "projectcode_tests.ppm").string();
+    for (int i = 0; i < 12; ++i) {
+        // Flat shapes for long matches, plus noise for literals and every filter type.
+        const int w = 1 + static_cast<int>(rng() % 300);
+        const int h = 1 + static_cast<int>(rng() % 200);
+        CanvasRGB canvas(static_cast<std::size_t>(w), static_cast<std::size_t>(h), random_color(rng));
+        random_list(rng, w, h, 60, false).replay(canvas);
+        for (int k = 0; k < w * h / 20; ++k) {
+            canvas.set_pixel(static_cast<int>(rng() % static_cast<unsigned>(w)),
+                             static_cast<int>(rng() % static_cast<unsigned>(h)), random_color(rng));
+        }
+
+        CHECK(canvas.save_ppm(ppm));
+        CanvasRGB from_ppm(1, 1);
+        CHECK(from_ppm.load_ppm(ppm));
+        CHECK(same_pixels(canvas, from_ppm));
+
+        CHECK(canvas.save_png(png, i % 2 ? &pool : nullptr));
+        std::size_t pw = 0, ph = 0;
+        std::vector<std::uint8_t> rgb;
+        const bool decoded = decode_png(read_file(png), pw, ph, rgb);
+        CHECK(decoded);
+        if (!decoded) continue;
+        CHECK(pw == from_ppm.width() && ph == from_ppm.height());
+        bool equal = pw == from_ppm.width() && ph == from_ppm.height();
+        for (std::size_t y = 0; equal && y < ph; ++y) {
+            equal = std::memcmp(rgb.data() + y * pw * 3, from_ppm.row(y), pw * 3) == 0;
+        }
+        CHECK(equal);
+    }
+    std::filesystem::remove(png);
+    std::filesystem::remove(ppm);
+}
+
+// --- sparse_canvas ------------------------------------------------------------------------
+
+// The same random scene through the shared drawing interface, with flood fills reading
+// what was drawn before them. Arguments are drawn into locals first so both canvas types
+// see them in the same order.
+template <class C>
+void draw_scene(C &canvas, unsigned seed, int commands) {
+    std::mt19937 rng(seed);
+    const int w = static_cast<int>(canvas.width());
+    const int h = static_cast<int>(canvas.height());
+    auto x = [&] { return static_cast<int>(rng() % static_cast<unsigned>(w + 80)) - 40; };
+    auto y = [&] { return static_cast<int>(rng() % static_cast<unsigned>(h + 80)) - 40; };
+    for (int i = 0; i < commands; ++i) {
+        const Color c = random_color(rng);
+        const auto alpha = static_cast<std::uint8_t>(rng() % 3 ? 255 : rng() % 256);
+        const int x0 = x(), y0 = y(), x1 = x(), y1 = y();
+        switch (rng() % 7) {
+        case 0: canvas.draw_line(x0, y0, x1, y1, c, alpha); break;
+        case 1: canvas.draw_line_aa(x0 + (rng() % 256) / 256.0, y0 + 0.5, x1 + 0.25, y1, c, alpha); break;
+        case 2: {
+            std::vector<Point> points{{static_cast<double>(x0), static_cast<double>(y0)},
+                                      {static_cast<double>(x1), static_cast<double>(y1)}};
+            for (unsigned k = rng() % 5; k-- > 0;) {
+                const int px = x(), py = y();
+                points.push_back({static_cast<double>(px), static_cast<double>(py)});
+            }
+            canvas.fill_polygon(points, c, rng() % 2 ? FillRule::nonzero : FillRule::even_odd, alpha);
+            break;
+        }
+        case 3: canvas.fill_circle(x0, y0, static_cast<int>(rng() % 30), c); break;
+        case 4: {
+            const int r = static_cast<int>(rng() % 80);
+            const double start = rng() % 360;
+            const double sweep = static_cast<int>(rng() % 721) - 360;
+            canvas.draw_arc(x0, y0, r, start, sweep, c, alpha);
+            break;
+        }
+        case 5: canvas.set_pixel(x0, y0, c); break;
+        case 6: canvas.flood_fill(x0, y0, c); break;
+        }
+    }
+}
+
+// SparseCanvasRGB against CanvasRGB: every primitive, flood fills included, must leave
+// the same pixels, on canvases whose edges cut through tiles.
+void test_sparse_canvas() {
+    for (unsigned seed = 0; seed < 40; ++seed) {
+        const std::size_t w = 100 + seed * 7;
+        const std::size_t h = 70 + seed * 5;
+        CanvasRGB dense(w, h);
+        SparseCanvasRGB sparse(w, h);
+        draw_scene(dense, seed, 150);
+        draw_scene(sparse, seed, 150);
+        bool equal = true;
+        for (std::size_t py = 0; equal && py < h; ++py) {
+            for (std::size_t px = 0; equal && px < w; ++px) {
+                const Color a = dense.get_pixel(static_cast<int>(px), static_cast<int>(py));
+                const Color b = sparse.get_pixel(static_cast<int>(px), static_cast<int>(py));
+                equal = std::memcmp(&a, &b, sizeof a) == 0;
+            }
+        }
+        if (!equal) std::fprintf(stderr, "sparse scene %u differs\n", seed);
+        CHECK(equal);
+    }
+}
+
+// --- flood_fill ---------------------------------------------------------------------------
+
+// Pixel-by-pixel 4-connected fill with an explicit stack.
+std::size_t reference_fill(CanvasRGB &canvas, int x, int y, Color color) {
+    const int w = static_cast<int>(canvas.width());
+    const int h = static_cast<int>(canvas.height());
+    if (x < 0 || x >= w || y < 0 || y >= h) return 0;
+    const Color target = canvas.get_pixel(x, y);
+    auto same = [](Color a, Color b) { return a.r == b.r && a.g == b.g && a.b == b.b; };
+    if (same(target, color)) return 0;
+    std::size_t filled = 0;
+    std::vector<std::pair<int, int>> stack{{x, y}};
+    while (!stack.empty()) {
+        const auto [px, py] = stack.back();
+        stack.pop_back();
+        if (px < 0 || px >= w || py < 0 || py >= h || !same(canvas.get_pixel(px, py), target)) continue;
+        canvas.set_pixel(px, py, color);
+        ++filled;
+        stack.push_back({px + 1, py});
+        stack.push_back({px - 1, py});
+        stack.push_back({px, py + 1});
+        stack.push_back({px, py - 1});
+    }
+    return filled;
+}
+
+// The scanline fill against the pixel-by-pixel one, on random outlines that leave
+// winding regions, and on a few colors close to the target's.
+void test_flood_fill() {
+    std::mt19937 rng(6);
+    for (int i = 0; i < 60; ++i) {
+        const int w = 1 + static_cast<int>(rng() % 240);
+        const int h = 1 + static_cast<int>(rng() % 160);
+        CanvasRGB fast(static_cast<std::size_t>(w), static_cast<std::size_t>(h), Color{255, 255, 255});
+        for (int k = 0; k < 40; ++k) {
+            const int x0 = static_cast<int>(rng() % static_cast<unsigned>(w));
+            const int y0 = static_cast<int>(rng() % static_cast<unsigned>(h));
+            const int x1 = static_cast<int>(rng() % static_cast<unsigned>(w));
+            const int y1 = static_cast<int>(rng() % static_cast<unsigned>(h));
+            fast.draw_line(x0, y0, x1, y1, k % 2 ? random_color(rng) : Color{254, 255, 255}); // one off white
+        }
+        CanvasRGB slow = fast;
+        for (int k = 0; k < 8; ++k) {
+            const int x = static_cast<int>(rng() % static_cast<unsigned>(w + 4)) - 2;
+            const int y = static_cast<int>(rng() % static_cast<unsigned>(h + 4)) - 2;
+            const Color c = k % 4 ? random_color(rng) : Color{255, 255, 255};
+            const std::size_t expected = reference_fill(slow, x, y, c);
+            CHECK(fast.flood_fill(x, y, c) == expected);
+        }
+        CHECK(same_pixels(fast, slow));
+    }
+}
+
+// --- image_compare ------------------------------------------------------------------------
+
+// PPM and BMP files, mapped and read whole, compared with the canvas they were saved
+// from: equal as written, and one changed pixel fails the default exact comparison.
+void test_image_compare() {
+    std::mt19937 rng(7);
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string ppm = (dir / "projectcode_compare.ppm").string();
+    const std::string bmp = (dir / "projectcode_compare.bmp").string();
+    CanvasRGB canvas(157, 93, random_color(rng)); // odd width: BMP rows are padded
+    random_list(rng, 157, 93, 80, false).replay(canvas);
+    CHECK(canvas.save_ppm(ppm));
+    CHECK(canvas.save_bmp(bmp));
+
+    CanvasRGB from_bmp(1, 1);
+    CHECK(from_bmp.load_bmp(bmp));
+    CHECK(same_pixels(canvas, from_bmp));
+
+    const int x = 101;
+    const int y = 37;
+    Color changed = canvas.get_pixel(x, y);
+    changed.g = static_cast<unsigned char>(changed.g ^ 0x10);
+    CanvasRGB edited = canvas;
+    edited.set_pixel(x, y, changed);
+
+    for (const ReadMode mode : {ReadMode::mapped, ReadMode::buffered}) {
+        for (const std::string &path : {ppm, bmp}) {
+            const ImageFile file = ImageFile::open(path, mode);
+            CHECK(file.is_open());
+            if (!file.is_open()) continue;
+            CHECK(file.format() == (path == ppm ? ImageFormat::ppm : ImageFormat::bmp));
+
+            const ImageDiff same = compare_images(file.view(), canvas.view());
+            CHECK(same.passed() && same.differing == 0 && std::isinf(same.psnr));
+
+            const ImageDiff exact = compare_images(file.view(), edited.view());
+            CHECK(!exact.passed() && exact.exceeded && exact.differing == 1);
+            CHECK(exact.bounds.x == x && exact.bounds.y == y && exact.bounds.w == 1 && exact.bounds.h == 1);
+
+            CompareOptions one;
+            one.max_differing = 1;
+            const ImageDiff loose = compare_images(file.view(), edited.view(), one);
+            CHECK(loose.passed() && loose.differing == 1 && loose.max_delta == 0x10 && !std::isinf(loose.psnr));
+
+            CompareOptions tolerant;
+            tolerant.tolerance = 0x10;
+            CHECK(compare_images(file.view(), edited.view(), tolerant).differing == 0);
+        }
+    }
+
+    const CanvasRGB other(156, 93);
+    CHECK(!compare_images(canvas.view(), other.view()).passed());
+    std::filesystem::remove(ppm);
+    std::filesystem::remove(bmp);
+}
+
+// --- layer_stack --------------------------------------------------------------------------
+
+bool same_color(Color a, Color b) { return a.r == b.r && a.g == b.g && a.b == b.b; }
+
+// Straight-alpha colors drawn on a layer come out as source-over of that color, and
+// incremental composites, after any mix of drawing and layer changes, match a full one.
+void test_layer_stack() {
+    {
+        LayerStack stack(64, 48, Color{0, 0, 255});
+        const std::size_t l = stack.add_layer();
+        const RGBA32 red{255, 0, 0, 128};
+        stack.layer(l).fill_polygon({{4, 4}, {20, 4}, {20, 20}, {4, 20}}, red);
+        stack.layer(l).fill_circle(40, 12, 5, red);
+        stack.layer(l).set_pixel(10, 40, red);
+        stack.layer(l).draw_line(30, 40, 50, 40, red);
+        stack.composite();
+        const std::pair<int, int> covered[] = {{10, 10}, {40, 12}, {10, 40}, {40, 40}};
+        for (const auto &[x, y] : covered) CHECK(same_color(stack.output().get_pixel(x, y), Color{128, 0, 127}));
+        CHECK(same_color(stack.output().get_pixel(30, 30), Color{0, 0, 255}));
+    }
+
+    std::mt19937 rng(8);
+    LayerStack stack(200, 150, Color{20, 30, 40});
+    for (int i = 0; i < 4; ++i) stack.add_layer(static_cast<BlendMode>(i));
+    auto coord = [&](int size) { return static_cast<int>(rng() % static_cast<unsigned>(size + 40)) - 20; };
+    for (int step = 0; step < 300; ++step) {
+        const std::size_t l = rng() % stack.size();
+        const RGBA32 c{static_cast<std::uint8_t>(rng()), static_cast<std::uint8_t>(rng()),
+                       static_cast<std::uint8_t>(rng()), static_cast<std::uint8_t>(rng() % 2 ? 255 : rng())};
+        const int x0 = coord(200), y0 = coord(150), x1 = coord(200), y1 = coord(150);
+        switch (rng() % 8) {
+        case 0: stack.layer(l).draw_line(x0, y0, x1, y1, c); break;
+        case 1: stack.layer(l).fill_circle(x0, y0, static_cast<int>(rng() % 25), c); break;
+        case 2:
+            stack.layer(l).fill_polygon({{static_cast<double>(x0), static_cast<double>(y0)},
+                                         {static_cast<double>(x1), static_cast<double>(y0)},
+                                         {static_cast<double>(x1), static_cast<double>(y1)}},
+                                        c);
+            break;
+        case 3: stack.clear_layer(l); break;
+        case 4: stack.set_opacity(l, static_cast<std::uint8_t>(rng() % 3 ? 255 : rng())); break;
+        case 5: stack.set_visible(l, rng() % 4 != 0); break;
+        case 6: stack.move_layer(l, rng() % stack.size()); break;
+        case 7: stack.set_blend_mode(l, static_cast<BlendMode>(rng() % 4)); break;
+        }
+        if (rng() % 3) continue;
+        stack.composite();
+        const CanvasRGB incremental = stack.output();
+        stack.invalidate();
+        stack.composite();
+        if (!same_pixels(incremental, stack.output())) {
+            std::fprintf(stderr, "incremental composite differs at step %d\n", step);
+            ++failures;
+            return;
+        }
+    }
+}
+
+// --- terminal -----------------------------------------------------------------------------
+
+// Just enough of a VT100 to replay what AnsiTerminal sends: cursor positioning, erase
+// display, default and 256-color foregrounds, and printable characters.
+struct Screen {
+    std::size_t width;
+    std::size_t height;
+    std::vector<char> glyphs;
+    std::vector<int> colors;
+    std::size_t x = 0;
+    std::size_t y = 0;
+    int color = AnsiTerminal::default_color;
+
+    Screen(std::size_t w, std::size_t h) : width(w), height(h), glyphs(w * h, ' '), colors(w * h, color) {}
+
+    bool feed(const std::string &bytes) {
+        for (std::size_t i = 0; i < bytes.size(); ++i) {
+            if (bytes[i] != '\x1b') {
+                if (x >= width || y >= height) return false;
+                glyphs[y * width + x] = bytes[i];
+                colors[y * width + x] = color;
+                ++x;
+                continue;
+            }
+            if (i + 1 >= bytes.size() || bytes[i + 1] != '[') return false;
+            std::size_t end = i + 2;
+            while (end < bytes.size() && !std::isalpha(static_cast<unsigned char>(bytes[end]))) ++end;
+            if (end == bytes.size()) return false;
+            const std::string params = bytes.substr(i + 2, end - i - 2);
+            switch (bytes[end]) {
+            case 'H': {
+                std::size_t row = 1, col = 1;
+                if (!params.empty() && std::sscanf(params.c_str(), "%zu;%zu", &row, &col) != 2) return false;
+                y = row - 1;
+                x = col - 1;
+                break;
+            }
+            case 'J':
+                std::fill(glyphs.begin(), glyphs.end(), ' ');
+                std::fill(colors.begin(), colors.end(), color);
+                break;
+            case 'm':
+                if (params == "0" || params == "39") {
+                    color = AnsiTerminal::default_color;
+                } else if (params.compare(0, 5, "38;5;") == 0) {
+                    color = std::atoi(params.c_str() + 5);
+                } else {
+                    return false;
+                }
+                break;
+            case 'l':
+            case 'h':
+                if (params != "?25") return false;
+                break;
+            default: return false;
+            }
+            i = end;
+        }
+        return true;
+    }
+};
+
+// Random edits replayed through a terminal model must show every cell of the canvas in
+// its glyph's color, with each frame sending only the changed cells.
+void test_terminal() {
+    std::mt19937 rng(9);
+    std::ostringstream os;
+    const std::size_t w = 50;
+    const std::size_t h = 16;
+    Canvas canvas(w, h);
+    Screen screen(w, h + 1); // finish() parks the cursor on the row below
+    int palette[256];
+    std::fill(std::begin(palette), std::end(palette), AnsiTerminal::default_color);
+    {
+        AnsiTerminal terminal(os);
+        const char glyphs[] = " *#o.";
+        terminal.set_color('#', 196);
+        terminal.set_color('o', 46);
+        palette['#'] = 196;
+        palette['o'] = 46;
+        std::size_t sent = 0;
+        for (int frame = 0; frame < 200; ++frame) {
+            const Canvas before = canvas;
+            for (unsigned k = rng() % 12; k-- > 0;) {
+                canvas.set_pixel(static_cast<int>(rng() % w), static_cast<int>(rng() % h), glyphs[rng() % 5]);
+            }
+            if (frame == 120) {
+                terminal.set_color('.', 21); // repaints everything
+                palette['.'] = 21;
+            }
+            std::size_t changed = 0;
+            for (std::size_t py = 0; py < h; ++py) {
+                for (std::size_t px = 0; px < w; ++px) changed += canvas.row(py)[px] != before.row(py)[px];
+            }
+            const std::size_t bytes = terminal.present(canvas);
+            const std::string out = os.str().substr(sent);
+            sent = os.str().size();
+            CHECK(out.size() == bytes);
+            CHECK(screen.feed(out));
+            if (frame != 120) {
+                CHECK(terminal.changed_cells() == changed);
+                CHECK(bytes <= 24 * changed + 16);
+            }
+            bool shown = true;
+            for (std::size_t py = 0; py < h; ++py) {
+                for (std::size_t px = 0; px < w; ++px) {
+                    const char g = canvas.row(py)[px];
+                    shown = shown && screen.glyphs[py * w + px] == g &&
+                            (g == ' ' || screen.colors[py * w + px] == palette[static_cast<unsigned char>(g)]);
+                }
+            }
+            if (!shown) std::fprintf(stderr, "terminal frame %d differs\n", frame);
+            CHECK(shown);
+            if (frame == 60) { // a later present() carries on from finish()
+                terminal.finish();
+                CHECK(screen.feed(os.str().substr(sent)));
+                sent = os.str().size();
+            }
+        }
+    }
+}
+
+// --- render_pipeline ----------------------------------------------------------------------
+
+// Turtle drawing whose strokes overlap and whose fills have more vertices than the
+// pipeline's rings hold, flushed at irregular intervals.
+bool draw_turtle_scene(TurtleRGB &t, const std::function<bool()> &flush) {
+    std::mt19937 rng(10);
+    for (int i = 0; i < 400; ++i) {
+        t.set_pen(random_color(rng));
+        switch (rng() % 4) {
+        case 0: t.forward(static_cast<double>(rng() % 60)); break;
+        case 1: t.turn_left(static_cast<double>(rng() % 180)); break;
+        case 2: t.stamp_dot(static_cast<int>(rng() % 6), random_color(rng)); break;
+        case 3: {
+            t.set_fill(random_color(rng));
+            t.begin_fill();
+            for (int k = 0; k < 90; ++k) {
+                t.forward(4);
+                t.turn_left(4);
+            }
+            t.end_fill();
+            break;
+        }
+        }
+        if (t.x() < 0 || t.x() > 320 || t.y() < 0 || t.y() > 240) {
+            t.pen_up();
+            t.move_to(160, 120);
+            t.pen_down();
+        }
+        if (rng() % 7 == 0 && !flush()) return false;
+    }
+    return true;
+}
+
+// The pipeline must rasterize commands in the order they were drawn, whatever the ring
+// sizes and frame timing, and leave the presenter's framebuffer matching the canvas.
+void test_render_pipeline() {
+    CanvasRGB direct(320, 240);
+    TurtleRGB turtle(direct, 0, 0);
+    draw_turtle_scene(turtle, [&] {
+        turtle.finish_path(); // as the pipeline's flush does
+        return true;
+    });
+    turtle.finish_path();
+
+    for (const std::size_t capacity : {16, 4096}) {
+        CanvasRGB canvas(320, 240);
+        HeadlessPresenter presenter(canvas);
+        PipelineOptions opts;
+        opts.fps = 1000;
+        opts.queue_capacity = capacity;
+        RenderPipeline pipeline(canvas, presenter, opts);
+        const PipelineStats stats = pipeline.run(
+            [](CanvasRGB &, TurtleRGB &t, std::function<bool()> flush) { draw_turtle_scene(t, flush); });
+        CHECK(stats.frames > 0 && presenter.frames() == stats.frames);
+        CHECK(same_pixels(direct, canvas));
+
+        const detail::Framebuffer &fb = presenter.framebuffer();
+        const ImageView shown{fb.bytes.data() + static_cast<std::size_t>(fb.height - 1) * fb.row_padded,
+                              -static_cast<std::ptrdiff_t>(fb.row_padded), static_cast<std::size_t>(fb.width),
+                              static_cast<std::size_t>(fb.height), PixelLayout::bgr24};
+        CHECK(compare_images(shown, canvas.view()).passed());
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const struct {
+        const char *name;
+        void (*run)();
+    } tests[] = {{"draw_line", test_draw_line},
+                 {"kernels", test_kernels},
+                 {"tile_renderer", test_tile_renderer},
+                 {"thread_pool", test_thread_pool},
+                 {"svg_export", test_svg_export},
+                 {"png_roundtrip", test_png_roundtrip},
+                 {"sparse_canvas", test_sparse_canvas},
+                 {"flood_fill", test_flood_fill},
+                 {"image_compare", test_image_compare},
+                 {"layer_stack", test_layer_stack},
+                 {"terminal", test_terminal},
+                 {"render_pipeline", test_render_pipeline}};
+    bool ran = false;
+    for (const auto &t : tests) {
+        if (argc > 1 && std::strcmp(argv[1], t.name) != 0) continue;
+        const int before = failures;
+        t.run();
+        std::printf("%-14s %s\n", t.name, failures == before ? "ok" : "FAILED");
+        ran = true;
+    }
+    if (!ran) {
+        std::fprintf(stderr, "unknown test '%s'\n", argv[1]);
+        return 2;
+    }
+    return failures == 0 ? 0 : 1;
+}